@@ -7,6 +7,7 @@
 #define EDX_SSE_BIT 25
 #define EDX_SSE2_BIT 26
 #define ECX_SSE3_BIT 0
+#define ECX_PCLMUL_BIT 1
 #define ECX_SSSE3_BIT 9
 #define ECX_SSE41_BIT 19
 #define ECX_SSE42_BIT 20
@@ -46,6 +47,9 @@ uint64_t get_supported_flags()
     if (strcmp(comp_flag, "-msse4.2\0") == 0) {
       supp_comp_flgs |= (1 << ECX_SSE42_BIT);
     }
+    if (strcmp(comp_flag, "-mpclmul\0") == 0) {
+      supp_comp_flgs |= (1 << ECX_PCLMUL_BIT);
+    }
     if (strcmp(comp_flag, "-mavx\0") == 0) {
       supp_comp_flgs |= (1 << ECX_AVX_BIT);
     }
@@ -90,6 +94,9 @@ int main(int argc, char** argv)
   if (is_supported(feature_ecx, supp_comp_flgs, ECX_SSE42_BIT)) {
     fprintf(f, "-msse4.2 -DINTEL_SSE42 ");
   } 
+  if (is_supported(feature_ecx, supp_comp_flgs, ECX_PCLMUL_BIT)) {
+    fprintf(f, "-mpclmul -DINTEL_PCLMUL ");
+  } 
   if (is_supported(feature_ecx, supp_comp_flgs, ECX_AVX_BIT)) {
     if ((feature_ecx >> ECX_AVXOS_BIT) & 0x1) {
       fprintf(f, "-mavx -DINTEL_AVX ");
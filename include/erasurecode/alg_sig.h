@@ -25,39 +25,39 @@
 #ifndef _ALG_SIG_H
 #define _ALG_SIG_H
 
-typedef int (*galois_single_multiply_func)(int, int, int);
-typedef void (*galois_uninit_field_func)(int);
-
-struct jerasure_mult_routines {
-  galois_single_multiply_func galois_single_multiply;
-  galois_uninit_field_func galois_uninit_field;
-};
-
-#if defined(__MACOS__) || defined(__MACOSX__) || defined(__OSX__) || defined(__APPLE__)
-#define JERASURE_SONAME "libJerasure.dylib"
-#else
-#define JERASURE_SONAME "libJerasure.so"
-#endif
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of 8- or 16-bit lanes the signature kernels work on at once */
+#define ALG_SIG_LANES 16
 
+/*
+ * Algebraic signature: component c of the signature of d_0 .. d_(n-1) is
+ * sum(d_i * alpha^(c * i)) in GF(2^w), alpha = 2.  It is linear, so the
+ * signature of a parity fragment is the same combination of the data
+ * fragment signatures as the parity is of the data.
+ */
 typedef struct alg_sig_s
 {
   int gf_w;
   int sig_len;
-  struct jerasure_mult_routines mult_routines;
-  void *jerasure_sohandle;
-  int *tbl1_l;
-  int *tbl1_r;
-  int *tbl2_l;
-  int *tbl2_r;
-  int *tbl3_l;
-  int *tbl3_r;
+  /* multiply by alpha^c (c = 1..3): tbl_l[c-1][x >> w/2] ^ tbl_r[c-1][x & low] */
+  int tbl_l[3][256];
+  int tbl_r[3][256];
+  /* pshufb nibble tables for multiplying by alpha^(c * ALG_SIG_LANES) */
+  unsigned char vec_tbl[3][8][16];
 } alg_sig_t;
 
 alg_sig_t *init_alg_sig(int sig_len, int gf_w);
 void destroy_alg_sig(alg_sig_t* alg_sig_handle);
 
 int compute_alg_sig(alg_sig_t* alg_sig_handle, char *buf, int len, char *sig);
+
+/* 32-bit GF(2^8) signature of buf, as stored for CHKSUM_ALG_SIG */
+uint32_t liberasurecode_alg_sig32(const void *buf, int len);
+
 int liberasurecode_crc32_alt(int crc, const void *buf, int size);
+uint32_t liberasurecode_crc32(uint32_t crc, const void *buf, size_t size);
 
 #endif
 
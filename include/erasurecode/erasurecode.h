@@ -34,6 +34,16 @@
 
 #define EC_MAX_FRAGMENTS 128
 
+/*
+ * Jerasure RS Cauchy packet sizes, in bytes.  A packetsize of 0 selects
+ * EC_CAUCHY_DEFAULT_PACKETSIZE; EC_CAUCHY_PACKETSIZE_AUTO picks one per
+ * object so that padding stays under 1/EC_CAUCHY_AUTO_PADDING_DIVISOR of
+ * the object size where possible, never going above the default.
+ */
+#define EC_CAUCHY_DEFAULT_PACKETSIZE    (sizeof(long) * 128)
+#define EC_CAUCHY_PACKETSIZE_AUTO       ((uint64_t) -1)
+#define EC_CAUCHY_AUTO_PADDING_DIVISOR  16
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -60,9 +70,21 @@ typedef enum {
     CHKSUM_NONE                     = 1,
     CHKSUM_CRC32                    = 2,
     CHKSUM_MD5                      = 3,
+    CHKSUM_CRC32C                   = 4,
+    CHKSUM_XXH3                     = 5,
+    CHKSUM_ALG_SIG                  = 6,
+    CHKSUM_CRC32C_CHUNKED           = 7,
     CHKSUM_TYPES_MAX,
 } ec_checksum_type_t;
 
+/*
+ * CHKSUM_CRC32C_CHUNKED keeps the CRC32C of each chunk of payload in a
+ * table at the end of the fragment, after any backend metadata, so that a
+ * byte range can be verified without reading the whole fragment.  Entries
+ * are little-endian; chksum[0] is the CRC32C of the table itself.
+ */
+#define LIBERASURECODE_CHKSUM_CHUNK_SIZE (64 * 1024)
+
 /* =~=*=~==~=*=~== EC Arguments - Common and backend-specific =~=*=~==~=*=~== */
 
 /**
@@ -79,6 +101,11 @@ struct ec_args {
         struct {
             uint64_t arg1;  /* sample arg */
         } null_args;        /* args specific to the null codes */
+        struct {
+            uint64_t packetsize;  /* bytes, a multiple of sizeof(long);
+                                   * 0 for the default or
+                                   * EC_CAUCHY_PACKETSIZE_AUTO */
+        } jerasure_cauchy_args; /* args specific to jerasure_rs_cauchy */
         struct {
             uint64_t x, y;  /* reserved for future expansion */
             uint64_t z, a;  /* reserved for future expansion */
@@ -134,6 +161,32 @@ int liberasurecode_instance_create(const ec_backend_id_t id,
  */
 int liberasurecode_instance_destroy(int desc);
 
+/* Default for liberasurecode_instance_set_threads()'s min_split_size */
+#define LIBERASURECODE_MIN_SPLIT_SIZE (256 * 1024)
+
+/**
+ * Split large stripes over several threads
+ *
+ * Each stripe is cut into column ranges of at least min_split_size bytes
+ * per fragment, which a per-instance pool of threads encodes, decodes or
+ * reconstructs at the same time.  Stripes too small to give two ranges
+ * are handled inline.  Only backends that work column by column can be
+ * split; for the others this is accepted but has no effect.
+ *
+ * Not to be called while other calls are using desc.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_threads - threads to use per stripe, including the calling
+ *        one; 0 or 1 to go back to single-threaded
+ * @param min_split_size - smallest range per thread in bytes, or 0 for
+ *        LIBERASURECODE_MIN_SPLIT_SIZE
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_instance_set_threads(int desc, int num_threads,
+        int min_split_size);
+
 
 /**
  * Erasure encode a data buffer
@@ -156,6 +209,37 @@ int liberasurecode_encode(int desc,
         char ***encoded_data, char ***encoded_parity,   /* output */
         uint64_t *fragment_len);                        /* output */
 
+/* Length of the object digest from liberasurecode_encode_with_digest() */
+#define LIBERASURECODE_DIGEST_LEN 16
+
+/**
+ * Erasure encode a data buffer and return its MD5 digest
+ *
+ * Same as liberasurecode_encode(), but also computes the MD5 of orig_data
+ * (e.g. for an object ETag) piece by piece as it is copied into the data
+ * fragments, so the object is only read once.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ * @param digest - _output_ buffer of LIBERASURECODE_DIGEST_LEN bytes for
+ *        the MD5 of orig_data
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_with_digest(int desc,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len,                         /* output */
+        unsigned char *digest);                         /* output */
+
 /**
  * Cleanup structures allocated by librasurecode_encode
  *
@@ -175,6 +259,21 @@ int liberasurecode_encode(int desc,
 int liberasurecode_encode_cleanup(int desc, char **encoded_data,
         char **encoded_parity);
 
+/*
+ * Values for liberasurecode_decode()'s force_metadata_checks:
+ *
+ * NONE - trust the fragments as given
+ * ALL  - verify every fragment passed in before decoding; any other
+ *        non-zero value also means ALL
+ * LAZY - verify only the k fragments decode will use, preferring data
+ *        fragments, and check the surplus ones only if any of those fail
+ *        (or, for flat XOR codes, are not all data fragments).  Decoding
+ *        then uses verified fragments alone.
+ */
+#define LIBERASURECODE_METADATA_CHECKS_NONE 0
+#define LIBERASURECODE_METADATA_CHECKS_ALL  1
+#define LIBERASURECODE_METADATA_CHECKS_LAZY 2
+
 /**
  * Reconstruct original data from a set of k encoded fragments
  *
@@ -183,7 +282,8 @@ int liberasurecode_encode_cleanup(int desc, char **encoded_data,
  * @param fragments - erasure encoded fragments (> = k)
  * @param num_fragments - number of fragments being passed in
  * @param fragment_len - length of each fragment (assume they are the same)
- * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0),
+ *        see LIBERASURECODE_METADATA_CHECKS_* above
  * @param out_data - _output_ pointer to decoded data
  * @param out_data_len - _output_ length of decoded output
  *          (both output data pointers are allocated by liberasurecode,
@@ -232,6 +332,241 @@ int liberasurecode_reconstruct_fragment(int desc,
         int destination_idx,                            /* input */
         char* out_fragment);                            /* output */
 
+/**
+ * Update a stripe in place after one data fragment is overwritten
+ *
+ * Only the changed data fragment and the m parity fragments are needed:
+ * the parities are patched with the difference between the old and new
+ * payload, instead of re-encoding from all k data fragments.  The size of
+ * the original object does not change.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data_fragment - data fragment being overwritten; its payload,
+ *        checksum and header are updated in place
+ * @param new_data - new payload for data_fragment
+ * @param new_data_len - length of new_data, must equal the fragment
+ *        payload size
+ * @param parity_fragments - all m parity fragments of the stripe, in any
+ *        order; updated in place
+ * @param num_parity - number of fragments in parity_fragments
+ *
+ * @return 0 on success, -EECMETHODNOTIMPL if the backend cannot do
+ *         delta updates, -error code otherwise
+ */
+int liberasurecode_encode_update(int desc,
+        char *data_fragment,                            /* input/output */
+        const char *new_data, uint64_t new_data_len,    /* input */
+        char **parity_fragments, int num_parity);       /* input/output */
+
+/* Accumulating encoder state, see liberasurecode_encode_accumulate_init() */
+typedef struct ec_encode_accumulator *ec_encode_accumulator_t;
+
+/**
+ * Start an encode where the data fragments are supplied one at a time
+ *
+ * Data fragment i holds bytes [i * data_len_per_fragment,
+ * (i + 1) * data_len_per_fragment) of the object.  Fragments may be added
+ * in any order, and from different threads.  When the backend supports
+ * it, parity is accumulated as each fragment arrives; otherwise it is
+ * computed by liberasurecode_encode_accumulate_finalize().
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data_size - length of the whole object
+ * @param data_len_per_fragment - _output_ number of object bytes carried
+ *        by each data fragment
+ * @param acc - _output_ accumulator, released by
+ *        liberasurecode_encode_accumulate_finalize() or
+ *        liberasurecode_encode_accumulate_abort()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_accumulate_init(int desc,
+        uint64_t orig_data_size,                        /* input */
+        uint64_t *data_len_per_fragment,                /* output */
+        ec_encode_accumulator_t *acc);                  /* output */
+
+/**
+ * Add the object bytes of one data fragment to an accumulating encode
+ *
+ * @param acc - accumulator from liberasurecode_encode_accumulate_init()
+ * @param data_idx - index of the data fragment (0 <= data_idx < k)
+ * @param data - object bytes for this fragment
+ * @param data_len - length of data; data_len_per_fragment, except for
+ *        fragments at the end of the object, which carry what is left
+ *        (possibly nothing)
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_accumulate(ec_encode_accumulator_t acc,
+        int data_idx, const char *data, uint64_t data_len);
+
+/**
+ * Finish an accumulating encode once all k data fragments were added
+ *
+ * On success the accumulator is released and the fragments are returned
+ * as from liberasurecode_encode() (free them with
+ * liberasurecode_encode_cleanup()).  On failure the accumulator is left
+ * as it was.
+ *
+ * @param acc - accumulator from liberasurecode_encode_accumulate_init()
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment
+ *
+ * @return 0 on success, -EINSUFFFRAGS if data fragments are missing,
+ *         -error code otherwise
+ */
+int liberasurecode_encode_accumulate_finalize(ec_encode_accumulator_t acc,
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len);                        /* output */
+
+/**
+ * Release an accumulating encode without producing fragments
+ *
+ * @param acc - accumulator from liberasurecode_encode_accumulate_init()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_accumulate_abort(ec_encode_accumulator_t acc);
+
+/* Asynchronous requests, see liberasurecode_async_create() */
+typedef struct ec_async_queue *ec_async_queue_t;
+
+typedef enum {
+    EC_ASYNC_ENCODE         = 0,
+    EC_ASYNC_DECODE         = 1,
+    EC_ASYNC_RECONSTRUCT    = 2,
+} ec_async_op_t;
+
+/**
+ * One encode, decode or reconstruct for liberasurecode_async_submit()
+ *
+ * The fields mirror the arguments of liberasurecode_encode(),
+ * liberasurecode_decode() and liberasurecode_reconstruct_fragment();
+ * only those of the chosen op are looked at.  Outputs are allocated as by
+ * the synchronous calls and released the same way.  The request, and
+ * every buffer it points to, belongs to the library from submission
+ * until it completes.
+ */
+struct ec_async_request {
+    ec_async_op_t op;
+    void *user_data;                /* not touched by the library */
+
+    /* EC_ASYNC_ENCODE */
+    const char *orig_data;
+    uint64_t orig_data_size;
+    char **encoded_data;            /* output */
+    char **encoded_parity;          /* output */
+
+    /* EC_ASYNC_DECODE and EC_ASYNC_RECONSTRUCT */
+    char **available_fragments;
+    int num_fragments;
+    int force_metadata_checks;      /* decode only */
+    char *out_data;                 /* decode output */
+    uint64_t out_data_len;          /* decode output */
+    int destination_idx;            /* reconstruct only */
+    char *out_fragment;             /* reconstruct, caller's buffer */
+
+    /* Output for encode, input for decode and reconstruct */
+    uint64_t fragment_len;
+
+    int status;                     /* output, 0 or -error code */
+};
+
+/* Called on a worker thread as each request completes */
+typedef void (*ec_async_callback_fn)(struct ec_async_request *req,
+        void *callback_arg);
+
+#define LIBERASURECODE_ASYNC_MAX_WORKERS    64
+#define LIBERASURECODE_ASYNC_DEFAULT_DEPTH  128
+#define LIBERASURECODE_ASYNC_MAX_DEPTH      65536
+
+/**
+ * Create a queue of asynchronous requests against an instance
+ *
+ * Requests are run by num_workers threads of the queue's own, which take
+ * several queued requests at a time.  Completed requests are either handed
+ * to callback, or, with no callback, kept for liberasurecode_async_reap()
+ * and signalled on liberasurecode_async_get_eventfd().
+ *
+ * At most queue_depth requests may be outstanding: submitted and not yet
+ * reaped, or not yet handed to the callback.  Beyond that
+ * liberasurecode_async_submit() pushes back with -EAGAIN.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_workers - worker threads, 1 to LIBERASURECODE_ASYNC_MAX_WORKERS
+ * @param queue_depth - most outstanding requests, or 0 for
+ *        LIBERASURECODE_ASYNC_DEFAULT_DEPTH
+ * @param callback - completion callback, or NULL to reap completions
+ * @param callback_arg - passed to callback
+ * @param queue - _output_ queue, released by liberasurecode_async_destroy()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_async_create(int desc, int num_workers, int queue_depth,
+        ec_async_callback_fn callback, void *callback_arg,
+        ec_async_queue_t *queue);
+
+/**
+ * Finish every submitted request, then stop the workers and free the queue
+ *
+ * Completions that were not reaped are dropped; their outputs are still
+ * the caller's to release.  Not to be called from a callback.
+ *
+ * @param queue - queue from liberasurecode_async_create()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_async_destroy(ec_async_queue_t queue);
+
+/**
+ * Queue requests without waiting for them
+ *
+ * Requests are taken in order, up to the free room in the queue.
+ *
+ * @param queue - queue from liberasurecode_async_create()
+ * @param reqs - requests to submit
+ * @param num_reqs - number of requests in reqs
+ *
+ * @return number of requests queued, -EAGAIN if the queue is full,
+ *         -error code otherwise
+ */
+int liberasurecode_async_submit(ec_async_queue_t queue,
+        struct ec_async_request **reqs, int num_reqs);
+
+/**
+ * Descriptor that polls readable while completions are waiting to be reaped
+ *
+ * It is an eventfd where available, otherwise the read end of a pipe; it
+ * belongs to the queue and is cleared by liberasurecode_async_reap().
+ *
+ * @param queue - queue from liberasurecode_async_create() without a
+ *        callback
+ *
+ * @return file descriptor, -error code otherwise
+ */
+int liberasurecode_async_get_eventfd(ec_async_queue_t queue);
+
+/**
+ * Collect completed requests, oldest first
+ *
+ * @param queue - queue from liberasurecode_async_create() without a
+ *        callback
+ * @param reqs - _output_ array for up to max_reqs completed requests
+ * @param max_reqs - room in reqs
+ * @param min_reqs - completions to wait for; 0 to not block.  Returns
+ *        early once nothing else is outstanding.
+ *
+ * @return number of requests in reqs, -error code otherwise
+ */
+int liberasurecode_async_reap(ec_async_queue_t queue,
+        struct ec_async_request **reqs, int max_reqs, int min_reqs);
+
 /**
  * Return a list of lists with valid rebuild indexes given
  * a list of missing indexes.
@@ -297,6 +632,26 @@ int liberasurecode_get_fragment_metadata(char *fragment,
 */
 int is_invalid_fragment(int desc, char *fragment);
 
+/**
+ * Check a set of fragments as is_invalid_fragment() does, including their
+ * payload checksums, hashing the fragments on the instance's thread pool
+ * (see liberasurecode_instance_set_threads()) when there is enough payload
+ * to make it worthwhile
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - fragments to verify
+ * @param num_fragments - number of fragments
+ * @param invalid_bm - _output_ bitmap of (num_fragments + 63) / 64 words,
+ *        bit (i % 64) of word (i / 64) set if fragments[i] is invalid;
+ *        may be NULL if only the count is wanted
+ *
+ * @return number of invalid fragments, or -error code
+ */
+int liberasurecode_verify_fragments(int desc,
+        char **fragments, int num_fragments,            /* input */
+        uint64_t *invalid_bm);                          /* output */
+
 /**
  * Verify a subset of fragments generated by encode()
  *
@@ -310,6 +665,73 @@ int is_invalid_fragment(int desc, char *fragment);
 int liberasurecode_verify_stripe_metadata(int desc,
         char **fragments, int num_fragments);
 
+/**
+ * Work out what to read to verify part of a CHKSUM_CRC32C_CHUNKED fragment
+ *
+ * Offsets are relative to the start of the fragment payload, which is
+ * sizeof(fragment_header_t) bytes into the fragment.
+ *
+ * @param header - fragment header (the first sizeof(fragment_header_t)
+ *        bytes of the fragment)
+ * @param offset - start of the payload range the caller wants
+ * @param len - length of the payload range the caller wants
+ * @param read_offset - _output_ start of the range widened to whole chunks
+ * @param read_len - _output_ length of the range widened to whole chunks
+ * @param table_offset - _output_ offset of the checksum table
+ * @param table_len - _output_ length of the checksum table
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_get_fragment_read_range(char *header,
+        uint64_t offset, uint64_t len,                  /* input */
+        uint64_t *read_offset, uint64_t *read_len,      /* output */
+        uint64_t *table_offset, uint64_t *table_len);   /* output */
+
+/**
+ * Verify a range of a CHKSUM_CRC32C_CHUNKED fragment's payload against its
+ * checksum table, without the rest of the payload
+ *
+ * @param header - fragment header (the first sizeof(fragment_header_t)
+ *        bytes of the fragment)
+ * @param table - the checksum table, as located by
+ *        liberasurecode_get_fragment_read_range()
+ * @param offset - payload offset of data; a multiple of
+ *        LIBERASURECODE_CHKSUM_CHUNK_SIZE
+ * @param data - payload bytes starting at offset
+ * @param len - length of data; whole chunks, or up to the end of the payload
+ *
+ * @return 0 if the range is intact, -EBADCHKSUM if it (or the table) is
+ *         corrupt, -error code otherwise
+ */
+int liberasurecode_verify_fragment_range(char *header, const char *table,
+        uint64_t offset, const char *data, uint64_t len);
+
+/**
+ * Check that the parity of a complete stripe is consistent with its data
+ *
+ * The data fragments are re-encoded a piece at a time into a small scratch
+ * buffer and compared with the parity fragments; nothing object-sized is
+ * allocated.  With CHKSUM_ALG_SIG on a GF(2^8) backend (flat XOR, ISA-L,
+ * Jerasure RS Vand with w=8) the parity is instead checked from the
+ * fragment signatures alone.  When the parity disagrees, the fragment
+ * checksums (if any) are used to blame the right fragments; without
+ * checksums only the disagreeing parity fragments are reported.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - all k + m fragments of the stripe, in any order
+ * @param num_fragments - number of fragments, must be k + m
+ * @param bad_idxs - _output_ array of at least k + m entries for the
+ *        indexes of inconsistent fragments
+ * @param num_bad - _output_ number of entries set in bad_idxs
+ *
+ * @return 0 on success (even if fragments are bad), -EECMETHODNOTIMPL if
+ *         the backend is not linear, -error code otherwise
+ */
+int liberasurecode_scrub_stripe(int desc,
+        char **fragments, int num_fragments,            /* input */
+        int *bad_idxs, int *num_bad);                   /* output */
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
 /**
@@ -363,6 +785,20 @@ int liberasurecode_get_aligned_data_size(int desc, uint64_t data_len);
  */
 int liberasurecode_get_minimum_encode_size(int desc);
 
+/**
+ * This will return the packet size the backend uses to encode an
+ * object of data_len bytes.  With EC_CAUCHY_PACKETSIZE_AUTO this
+ * depends on the object size.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data_len - original data length in bytes
+ *
+ * @return packet size in bytes, or -error code on error
+ *         (-EINVALIDPARAMS if the backend does not use packets)
+ */
+int liberasurecode_get_packetsize(int desc, uint64_t data_len);
+
 /**
  * This will return the fragment size, which is each fragment data
  * length the backend will allocate when encoding.
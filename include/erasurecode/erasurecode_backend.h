@@ -66,6 +66,8 @@ struct ec_backend_args {
 #define ISCOMPATIBLEWITH    is_compatible_with
 #define GETMETADATASIZE     get_backend_metadata_size
 #define GETENCODEOFFSET     get_encode_offset
+#define ENCODEUPDATE        encode_update
+#define PREPAREDECODE       prepare_decode
 
 #define FN_NAME(s)      str(s)
 #define str(s)          #s
@@ -96,6 +98,21 @@ struct ec_backend_op_stubs {
 
     size_t (*GETMETADATASIZE)(void *desc, int blocksize);
     size_t (*GETENCODEOFFSET)(void *desc, int metadata_size);
+
+    /*
+     * Optional: parity ^= coefficient(data_idx) * delta, for each parity.
+     * Used to patch parity after an overwrite, and to accumulate parity
+     * one data fragment at a time (starting from zeroed parity).
+     */
+    int (*ENCODEUPDATE)(void *desc,
+            int data_idx, char *delta, char **parity, int blocksize);
+
+    /*
+     * Optional: build and cache what DECODE and RECONSTRUCT need for
+     * missing_idxs, before they are called on several column ranges of
+     * one stripe at once
+     */
+    int (*PREPAREDECODE)(void *desc, int *missing_idxs);
 };
 
 /* ==~=*=~==~=*=~==~=*=~= backend struct definitions =~=*=~==~=*=~==~=*==~== */
@@ -129,7 +146,9 @@ typedef struct ec_backend {
     int                         idesc;              /* liberasurecode instance handle */
     struct ec_backend_desc      desc;               /* EC backend instance handle */
 
-    SLIST_ENTRY(ec_backend)     link;
+    struct ec_thread_pool       *pool;              /* splits large stripes, if set */
+    int                         min_split_size;     /* smallest range given to a thread */
+    pthread_mutex_t             pool_lock;          /* guards pool and min_split_size */
 } *ec_backend_t;
 
 /* ~=*=~==~=*=~==~=*=~==~=*= frontend <-> backend API =*=~==~=*=~==~=*=~==~= */
@@ -158,10 +177,21 @@ ec_backend_t liberasurecode_backend_lookup_by_name(const char *name);
  * Look up a backend instance by descriptor
  *
  * Returns pointer to a registered liberasurecode instance
- * The caller must hold active_instances_rwlock
+ * No reference is taken: the caller must already hold one
  */
 ec_backend_t liberasurecode_backend_instance_get_by_desc(int desc);
 
+/**
+ * Look up a backend instance by descriptor and take a reference on it,
+ * which keeps liberasurecode_instance_destroy() from tearing it down
+ *
+ * Returns pointer to a registered liberasurecode instance, or NULL
+ */
+ec_backend_t liberasurecode_backend_instance_get(int desc);
+
+/* Drop a reference taken by liberasurecode_backend_instance_get() */
+void liberasurecode_backend_instance_put(ec_backend_t instance);
+
 /* Common function for backends */
 /**
  * A function to return 0 for generic usage on backends for get_encode_offset
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ERASURECODE_DECODE_CACHE_H_
+#define _ERASURECODE_DECODE_CACHE_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "list.h"
+
+/*
+ * A small LRU cache of whatever a backend derives from an erasure pattern
+ * to decode it (inverted matrices, expanded tables, schedules).  Entries
+ * are refcounted, so one evicted while a decode still uses it is freed
+ * by that decode when it is done.
+ *
+ * Backends make struct ec_decode_cache_entry the first member of their
+ * own entry type and supply the callbacks that build and free one.
+ */
+
+struct ec_decode_cache_entry {
+    SLIST_ENTRY(ec_decode_cache_entry) link;
+    uint64_t missing_bm;        /* fragments unavailable */
+    uint64_t target_bm;         /* fragments it recomputes, or 0 for all */
+    int refcount;               /* cache reference plus one per user */
+};
+
+/*
+ * Build an entry for missing_idxs (also given as missing_bm) recomputing
+ * the fragments in target_bm; returns NULL on error
+ */
+typedef struct ec_decode_cache_entry *(*ec_decode_cache_build_fn)(
+        void *desc, int *missing_idxs, uint64_t missing_bm,
+        uint64_t target_bm);
+
+/* Free an entry made by the build callback */
+typedef void (*ec_decode_cache_free_fn)(struct ec_decode_cache_entry *entry);
+
+SLIST_HEAD(ec_decode_cache_list, ec_decode_cache_entry);
+
+typedef struct ec_decode_cache {
+    pthread_mutex_t lock;
+    struct ec_decode_cache_list entries;    /* most recently used first */
+    int size;
+    int capacity;
+    ec_decode_cache_build_fn build_entry;
+    ec_decode_cache_free_fn free_entry;
+    void *desc;                             /* passed to build_entry */
+} ec_decode_cache_t;
+
+/*
+ * Set up an empty cache of up to capacity entries, built for the backend
+ * descriptor desc.  Returns 0 on success, -1 on error.
+ */
+int ec_decode_cache_init(ec_decode_cache_t *cache, int capacity,
+        ec_decode_cache_build_fn build_entry,
+        ec_decode_cache_free_fn free_entry, void *desc);
+
+/* Free every cached entry; none may still be in use */
+void ec_decode_cache_destroy(ec_decode_cache_t *cache);
+
+/*
+ * Return a referenced entry for (missing_idxs, target_bm), building it if
+ * it is not cached.  Entries are built outside the lock, so concurrent
+ * misses on the same pattern may both build; the loser uses the cached
+ * copy.  Returns NULL on error.
+ */
+struct ec_decode_cache_entry *ec_decode_cache_get(ec_decode_cache_t *cache,
+        int *missing_idxs, uint64_t target_bm);
+
+/* Drop a reference taken by ec_decode_cache_get() */
+void ec_decode_cache_put(ec_decode_cache_t *cache,
+        struct ec_decode_cache_entry *entry);
+
+#endif
@@ -47,6 +47,7 @@ void init_fragment_header(char *buf)
 char *alloc_fragment_buffer(int size);
 int free_fragment_buffer(char *buf);
 int get_aligned_data_size(ec_backend_t instance, int data_len);
+int get_cauchy_packetsize(uint64_t packetsize, int w, int blocksize);
 char *get_data_ptr_from_fragment(char *buf);
 int get_data_ptr_array_from_fragments(char **data_array, char **fragments,
         int num_fragments);
@@ -64,7 +65,15 @@ int get_fragment_backend_metadata_size(char *buf);
 int get_fragment_buffer_size(char *buf);
 int set_orig_data_size(char *buf, int orig_data_size);
 int get_orig_data_size(char *buf);
+int get_chksum_table_size(ec_checksum_type_t ct, int blocksize);
+int get_fragment_metadata_size(ec_backend_t instance, int blocksize);
 int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize);
+int set_checksums(ec_checksum_type_t ct, char **fragments, int num_fragments,
+        int blocksize);
+int is_incremental_checksum(ec_checksum_type_t ct);
+uint32_t update_checksum(ec_checksum_type_t ct, uint32_t chksum,
+        const char *buf, int len);
+int set_precomputed_checksum(ec_checksum_type_t ct, char *buf, uint32_t chksum);
 int get_checksum(char *buf);
 int set_libec_version(char *fragment);
 int get_libec_version(char *fragment, uint32_t *ver);
@@ -29,12 +29,22 @@
 #ifndef _ERASURECODE_PREPROCESSING_H_
 #define _ERASURECODE_PREPROCESSING_H_
 
+/*
+ * Fused encode + checksum works on pieces of this many bytes per fragment:
+ * one piece fits in L1 while it is copied and checksummed, and the k + m
+ * pieces of a stripe stay in L2 while parity is encoded and checksummed
+ */
+#ifndef ENCODE_CHKSUM_CHUNK_SIZE
+#define ENCODE_CHKSUM_CHUNK_SIZE (16 * 1024)
+#endif
+
+/* digest, if not NULL, is an MD5_CTX fed orig_data as it is copied */
 int prepare_fragments_for_encode(
         ec_backend_t instance,
         int k, int m,
         const char *orig_data, uint64_t orig_data_size, /* input */
         char **encoded_data, char **encoded_parity,     /* output */
-        int *blocksize);
+        int *blocksize, uint32_t *data_chksums, void *digest);
 
 int prepare_fragments_for_decode(
         int k, int m,
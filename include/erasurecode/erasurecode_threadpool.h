@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _ERASURECODE_THREADPOOL_H_
+#define _ERASURECODE_THREADPOOL_H_
+
+/*
+ * A fixed set of worker threads for splitting one operation into tasks.
+ * ec_thread_pool_run() hands out tasks 0..num_tasks-1 to the workers and
+ * the calling thread alike, and returns once all of them have run.
+ */
+
+/* Most threads a pool can have, including the caller of ec_thread_pool_run */
+#define EC_THREAD_POOL_MAX_THREADS 64
+
+typedef struct ec_thread_pool *ec_thread_pool_t;
+
+typedef void (*ec_thread_pool_task_fn)(void *arg, int task);
+
+/*
+ * Create a pool of num_threads threads, counting the caller of
+ * ec_thread_pool_run(), so num_threads - 1 workers are started.
+ * The pool starts with one reference.  Returns NULL on error.
+ */
+ec_thread_pool_t ec_thread_pool_create(int num_threads);
+
+/* Take another reference on the pool */
+void ec_thread_pool_ref(ec_thread_pool_t pool);
+
+/*
+ * Drop a reference; the last one stops the workers and frees the pool.
+ * A NULL pool is ignored.
+ */
+void ec_thread_pool_unref(ec_thread_pool_t pool);
+
+/* Number of threads that can work on one ec_thread_pool_run() */
+int ec_thread_pool_size(ec_thread_pool_t pool);
+
+/*
+ * Run fn(arg, task) for task = 0 .. num_tasks - 1 and wait for all of
+ * them.  With no pool, or while the pool is busy with another caller's
+ * tasks, everything runs on the calling thread instead.
+ */
+void ec_thread_pool_run(ec_thread_pool_t pool, int num_tasks,
+        ec_thread_pool_task_fn fn, void *arg);
+
+#endif
@@ -27,15 +27,32 @@
  * vi: set noai tw=79 ts=4 sw=4:
  */
 
+#include "erasurecode_decode_cache.h"
+
 #define ISA_L_W 8
 
 /* Forward declarations */
 typedef void (*ec_encode_data_func)(int, int, int, unsigned char*, unsigned char **, unsigned char **);
+typedef void (*ec_encode_data_update_func)(int, int, int, int, unsigned char*, unsigned char *, unsigned char **);
 typedef void (*ec_init_tables_func)(int, int, unsigned char*, unsigned char *);
 typedef void (*gf_gen_encoding_matrix_func)(unsigned char*, int, int);
 typedef int (*gf_invert_matrix_func)(unsigned char*, unsigned char*, const int);
 typedef unsigned char (*gf_mul_func)(unsigned char, unsigned char);
 
+/* Number of decode tables cached per descriptor */
+#define ISA_L_DECODE_CACHE_SIZE 32
+
+/*
+ * Decode tables for one set of missing fragments: the ec_init_tables()
+ * output for the rows of the missing data (in index order) followed by
+ * the rows of the missing parity (in index order)
+ */
+typedef struct isa_l_decode_tables {
+    struct ec_decode_cache_entry entry;     /* must come first */
+    int num_missing;
+    unsigned char *g_tbls;
+} isa_l_decode_tables_t;
+
 typedef struct {
     /* calls required for init */
     ec_init_tables_func ec_init_tables;
@@ -44,6 +61,9 @@ typedef struct {
     /* calls required for encode */
     ec_encode_data_func ec_encode_data;
 
+    /* optional, used for parity delta updates */
+    ec_encode_data_update_func ec_encode_data_update;
+
     /* calls required for decode and reconstruct */
     gf_invert_matrix_func gf_invert_matrix;
 
@@ -53,12 +73,19 @@ typedef struct {
     /* fields needed to hold state */
     unsigned char *matrix;
     unsigned char *encode_tables;
+
+    /* LRU cache of decode tables */
+    ec_decode_cache_t decode_cache;
+
     int k;
     int m;
     int w;
 } isa_l_descriptor;
 
 int isa_l_encode(void *desc, char **data, char **parity, int blocksize);
+int isa_l_encode_update(void *desc, int data_idx, char *delta, char **parity,
+        int blocksize);
+int isa_l_prepare_decode(void *desc, int *missing_idxs);
 int isa_l_decode(void *desc, char **data, char **parity, int *missing_idxs,
         int blocksize);
 int isa_l_reconstruct(void *desc, char **data, char **parity,
@@ -25,13 +25,32 @@
 #ifndef _XOR_CODE_H
 #define _XOR_CODE_H
 
-#define MAX_DATA 32
-#define MAX_PARITY MAX_DATA
+#include <stdint.h>
+
+/*
+ * Data membership of a parity is a 64-bit bitmap; parity membership of a
+ * data element (data_bms) is 32-bit.  Codes also keep k + m <= 64, so
+ * any set of fragments fits in a uint64_t.
+ */
+#define MAX_DATA 64
+#define MAX_PARITY 32
+#define MAX_FRAGMENTS 64
 
 #define MEM_ALIGN_SIZE 16
 
+/* Chunk size used to walk the fragments during encode (multiple of 64) */
+#define XOR_ENCODE_BLOCK_SIZE 4096
+
+/* fast_memcpy() uses non-temporal stores at or above this many bytes */
+#ifndef FAST_MEMCPY_NT_THRESHOLD
+#define FAST_MEMCPY_NT_THRESHOLD (1024 * 1024)
+#endif
+
 #define DECODED_MISSING_IDX MAX_DATA
 
+/* Precompute decode plans at init if there are at most this many patterns */
+#define XOR_MAX_DECODE_PLANS 4096
+
 typedef enum { FAIL_PATTERN_GE_HD, // Num failures greater than or equal to HD
                FAIL_PATTERN_0D_0P, 
                FAIL_PATTERN_1D_0P, 
@@ -47,6 +66,34 @@ typedef enum { FAIL_PATTERN_GE_HD, // Num failures greater than or equal to HD
 #define is_aligned(x) (((unsigned long)x & (MEM_ALIGN_SIZE-1)) == 0)
 #define num_unaligned_end(size) (size % MEM_ALIGN_SIZE)
 
+/*
+ * Encode schedule with shared partial sums.  Symbols 0..k-1 are the
+ * data fragments; symbol k+t is temp t, computed as the XOR of the two
+ * symbols in temps[t].  Parity j is the XOR of the num_srcs[j] symbols
+ * in srcs[j].
+ */
+typedef struct xor_schedule_s
+{
+  int num_temps;
+  int (*temps)[2];
+  int num_srcs[MAX_PARITY];
+  int *srcs[MAX_PARITY];
+} xor_schedule_t;
+
+/*
+ * Decode plan for one set of missing fragments.  ops is a flat list of
+ * num_ops XOR operations, each laid out as: dst, num_srcs, srcs...
+ * Fragment indexes are absolute (parity j is k+j).  Missing data are
+ * rebuilt from available fragments only; missing parities come last and
+ * may read the rebuilt data.
+ */
+typedef struct xor_decode_plan_s
+{
+  uint64_t missing_bm;
+  int num_ops;
+  int *ops;
+} xor_decode_plan_t;
+
 struct xor_code_s;
 
 typedef struct xor_code_s
@@ -54,22 +101,25 @@ typedef struct xor_code_s
   int k;
   int m;
   int hd;
-  unsigned int *parity_bms;
+  uint64_t *parity_bms;
   unsigned int *data_bms;
+  xor_schedule_t *encode_schedule;
+  int num_decode_plans;
+  xor_decode_plan_t *decode_plans;
   int (*decode)(struct xor_code_s *code_desc, char **data, char **parity, int *missing_idxs, int blocksize, int decode_parity);
   void (*encode)(struct xor_code_s *code_desc, char **data, char **parity, int blocksize);
   int (*fragments_needed)(struct xor_code_s *code_desc, int *missing_idxs, int *fragments_to_exclude, int *fragments_needed);
 } xor_code_t;
 
-int is_data_in_parity(int data_idx, unsigned int parity_bm);
+int is_data_in_parity(int data_idx, uint64_t parity_bm);
 
 int does_parity_have_data(int parity_idx, unsigned int data_bm);
 
-int parity_bit_lookup(xor_code_t *code_desc, int index);
+uint64_t parity_bit_lookup(xor_code_t *code_desc, int index);
 
-int data_bit_lookup(xor_code_t *code_desc, int index);
+uint64_t data_bit_lookup(xor_code_t *code_desc, int index);
 
-int missing_elements_bm(xor_code_t *code_desc, int *missing_elements, int (*bit_lookup_func)(xor_code_t *code_desc, int index));
+uint64_t missing_elements_bm(xor_code_t *code_desc, int *missing_elements, uint64_t (*bit_lookup_func)(xor_code_t *code_desc, int index));
 
 failure_pattern_t get_failure_pattern(xor_code_t *code_desc, int *missing_idxs);
 
@@ -77,10 +127,30 @@ void fast_memcpy(char *dst, char *src, int size);
 
 void xor_bufs_and_store(char *buf1, char *buf2, int blocksize);
 
+void xor_multi_bufs_and_store(char **bufs, int num_bufs, char *dst, int blocksize);
+
+xor_schedule_t* build_xor_schedule(xor_code_t *code_desc);
+
+void free_xor_schedule(xor_schedule_t *schedule);
+
 void xor_code_encode(xor_code_t *code_desc, char **data, char **parity, int blocksize);
 
+int build_xor_decode_plan(xor_code_t *code_desc, uint64_t missing_bm, xor_decode_plan_t *plan);
+
+int init_xor_decode_plans(xor_code_t *code_desc, int max_missing);
+
+xor_decode_plan_t* lookup_xor_decode_plan(xor_code_t *code_desc, uint64_t missing_bm);
+
+void run_xor_decode_plan(xor_code_t *code_desc, xor_decode_plan_t *plan, char **data, char **parity, int blocksize, int decode_parity);
+
+void free_xor_decode_plans(xor_code_t *code_desc);
+
+int xor_decode_plan_fragments_needed(xor_code_t *code_desc, xor_decode_plan_t *plan, uint64_t wanted_bm, int *fragments_needed);
+
 void selective_encode(xor_code_t *code_desc, char **data, char **parity, int *missing_parity, int blocksize);
 
+void xor_code_encode_update(xor_code_t *code_desc, int data_idx, char *delta, char **parity, int blocksize);
+
 int * get_missing_parity(xor_code_t *code_desc, int *missing_idxs);
 
 int * get_missing_data(xor_code_t *code_desc, int *missing_idxs);
@@ -97,4 +167,6 @@ void xor_reconstruct_one(xor_code_t *code_desc, char **data, char **parity, int
 
 xor_code_t* init_xor_hd_code(int k, int m, int hd);
 
+void free_xor_hd_code(xor_code_t *code_desc);
+
 #endif
@@ -0,0 +1,46 @@
+/*
+ * Generated by src/builtin/xor_codes/gen_xor_hd_code_defs.c; do not edit.
+ *
+ * g_hdH_mM_gen_data_bms lists the data_bms columns of the generated
+ * (k, M, H) codes; the code for a given k is the first k entries.
+ */
+
+#ifndef _XOR_HD_CODE_GEN_DEFS_H
+#define _XOR_HD_CODE_GEN_DEFS_H
+
+#define XOR_GEN_HD3_M5_MAX_K 26
+unsigned int g_hd3_m5_gen_data_bms[] = {
+  3, 12, 17, 6, 24, 5, 10, 18, 9, 20, 7, 25, 14, 19, 28, 11,
+  21, 22, 13, 26, 15, 23, 27, 29, 30, 31 };
+
+#define XOR_GEN_HD3_M6_MAX_K 57
+unsigned int g_hd3_m6_gen_data_bms[] = {
+  3, 12, 48, 5, 10, 17, 34, 20, 40, 6, 9, 18, 33, 24, 36, 7,
+  56, 11, 52, 13, 50, 14, 49, 19, 44, 21, 42, 22, 41, 25, 38, 26,
+  37, 28, 35, 15, 51, 60, 23, 43, 29, 46, 53, 58, 27, 39, 30, 45,
+  54, 57, 31, 47, 55, 59, 61, 62, 63 };
+
+#define XOR_GEN_HD3_M7_MAX_K 57
+unsigned int g_hd3_m7_gen_data_bms[] = {
+  3, 12, 48, 65, 6, 24, 96, 5, 10, 80, 33, 18, 36, 72, 9, 20,
+  34, 66, 17, 40, 68, 7, 56, 67, 28, 97, 14, 112, 11, 52, 69, 26,
+  98, 13, 49, 70, 88, 35, 44, 81, 22, 104, 19, 76, 37, 42, 82, 21,
+  41, 74, 84, 38, 25, 100, 50, 73, 15 };
+
+#define XOR_GEN_HD4_M5_MAX_K 11
+unsigned int g_hd4_m5_gen_data_bms[] = {
+  7, 25, 14, 19, 28, 11, 21, 22, 13, 26, 31 };
+
+#define XOR_GEN_HD4_M6_MAX_K 26
+unsigned int g_hd4_m6_gen_data_bms[] = {
+  7, 56, 11, 52, 13, 50, 14, 49, 19, 44, 21, 42, 22, 41, 25, 38,
+  26, 37, 28, 35, 31, 47, 55, 59, 61, 62 };
+
+#define XOR_GEN_HD4_M7_MAX_K 57
+unsigned int g_hd4_m7_gen_data_bms[] = {
+  7, 56, 67, 28, 97, 14, 112, 11, 52, 69, 26, 98, 13, 49, 70, 88,
+  35, 44, 81, 22, 104, 19, 76, 37, 42, 82, 21, 41, 74, 84, 38, 25,
+  100, 50, 73, 31, 103, 121, 62, 79, 115, 124, 47, 87, 122, 61, 91, 109,
+  118, 55, 93, 107, 94, 59, 110, 117, 127 };
+
+#endif
@@ -51,6 +51,26 @@ int isa_l_encode(void *desc, char **data, char **parity,
     return 0;
 }
 
+/*
+ * Apply a delta to data fragment data_idx to the parities; needs
+ * ec_encode_data_update from ISA-L
+ */
+int isa_l_encode_update(void *desc, int data_idx, char *delta, char **parity,
+        int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor*) desc;
+
+    if (NULL == isa_l_desc->ec_encode_data_update) {
+        return -EECMETHODNOTIMPL;
+    }
+
+    isa_l_desc->ec_encode_data_update(blocksize, isa_l_desc->k, isa_l_desc->m,
+                                      data_idx, isa_l_desc->encode_tables,
+                                      (unsigned char*)delta,
+                                      (unsigned char**)parity);
+    return 0;
+}
+
 static unsigned char* isa_l_get_decode_matrix(int k, int m, unsigned char *encode_matrix, int *missing_idxs)
 {
     int i = 0, j = 0, l = 0;
@@ -59,7 +79,7 @@ static unsigned char* isa_l_get_decode_matrix(int k, int m, unsigned char *encod
     uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
 
     while (i < k && l < n) {
-        if (((1 << l) & missing_bm) == 0) {
+        if (((1ULL << l) & missing_bm) == 0) {
             for (j = 0; j < k; j++) {
                 decode_matrix[(k * i) + j] = encode_matrix[(k * l) + j];
             }
@@ -129,7 +149,7 @@ static unsigned char* get_inverse_rows(int k,
      * Fill in rows for missing data
      */
     for (i = 0; i < k; i++) {
-        if ((1 << i) & missing_bm) {
+        if ((1ULL << i) & missing_bm) {
             for (j = 0; j < k; j++) {
                 inverse_rows[(l * k) + j] = decode_inverse[(i * k) + j];
             }
@@ -153,12 +173,12 @@ static unsigned char* get_inverse_rows(int k,
      */
     for (i = k; i < n; i++) {
         // Parity is missing
-        if ((1 << i) & missing_bm) {
+        if ((1ULL << i) & missing_bm) {
             int d_idx_avail = 0;
             int d_idx_unavail = 0;
             for (j = 0; j < k; j++) {
                 // This data is available, so we can use the encode matrix
-                if (((1 << j) & missing_bm) == 0) {
+                if (((1ULL << j) & missing_bm) == 0) {
                     inverse_rows[(l * k) + d_idx_avail] ^= encode_matrix[(i * k) + j];
                     d_idx_avail++;
                 } else {
@@ -176,25 +196,22 @@ static unsigned char* get_inverse_rows(int k,
     return inverse_rows;
 }
 
-int isa_l_decode(void *desc, char **data, char **parity,
-        int *missing_idxs, int blocksize)
+/*
+ * Compute the decode tables for the set of missing fragments: invert the
+ * matrix of the first k available rows, derive the rows for any missing
+ * parity and expand them with ec_init_tables()
+ */
+static struct ec_decode_cache_entry *build_decode_tables(void *desc,
+        int *missing_idxs, uint64_t missing_bm, uint64_t target_bm)
 {
     isa_l_descriptor *isa_l_desc = (isa_l_descriptor*)desc;
-
-    unsigned char *g_tbls = NULL;
+    isa_l_decode_tables_t *tables = NULL;
     unsigned char *decode_matrix = NULL;
     unsigned char *decode_inverse = NULL;
     unsigned char *inverse_rows = NULL;
-    unsigned char **decoded_elements = NULL;
-    unsigned char **available_fragments = NULL;
     int k = isa_l_desc->k;
     int m = isa_l_desc->m;
-    int n = k + m;
-    int ret = -1;
-    int i, j;
-
-    int num_missing_elements = get_num_missing_elements(missing_idxs);
-    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
+    int num_missing_elements = __builtin_popcountll(missing_bm);
 
     decode_matrix = isa_l_get_decode_matrix(k, m, isa_l_desc->matrix, missing_idxs);
 
@@ -213,15 +230,97 @@ int isa_l_decode(void *desc, char **data, char **parity,
         goto out;
     }
 
+    inverse_rows = get_inverse_rows(k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, isa_l_desc->gf_mul);
+    if (NULL == inverse_rows) {
+        goto out;
+    }
+
+    tables = (isa_l_decode_tables_t *)malloc(sizeof(isa_l_decode_tables_t));
+    if (NULL == tables) {
+        goto out;
+    }
+
     // Generate g_tbls from computed decode matrix (k x k) matrix
-    g_tbls = malloc(sizeof(unsigned char) * (k * m * 32));
-    if (NULL == g_tbls) {
+    tables->g_tbls = malloc(sizeof(unsigned char) * (k * num_missing_elements * 32));
+    if (NULL == tables->g_tbls) {
+        free(tables);
+        tables = NULL;
         goto out;
     }
 
-    inverse_rows = get_inverse_rows(k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, isa_l_desc->gf_mul);
+    isa_l_desc->ec_init_tables(k, num_missing_elements, inverse_rows, tables->g_tbls);
+
+    tables->num_missing = num_missing_elements;
+
+out:
+    free(decode_matrix);
+    free(decode_inverse);
+    free(inverse_rows);
+
+    return (struct ec_decode_cache_entry *)tables;
+}
+
+static void free_decode_tables(struct ec_decode_cache_entry *entry)
+{
+    isa_l_decode_tables_t *tables = (isa_l_decode_tables_t *)entry;
+
+    free(tables->g_tbls);
+    free(tables);
+}
+
+/* Drop a reference taken by get_decode_tables() */
+static void put_decode_tables(isa_l_descriptor *isa_l_desc,
+        isa_l_decode_tables_t *tables)
+{
+    ec_decode_cache_put(&isa_l_desc->decode_cache, &tables->entry);
+}
+
+/* Return referenced decode tables for missing_idxs, from the cache if possible */
+static isa_l_decode_tables_t *get_decode_tables(isa_l_descriptor *isa_l_desc,
+        int *missing_idxs)
+{
+    return (isa_l_decode_tables_t *)
+        ec_decode_cache_get(&isa_l_desc->decode_cache, missing_idxs, 0);
+}
 
-    decoded_elements = (unsigned char**)malloc(sizeof(unsigned char*)*num_missing_elements);
+/*
+ * Put the decode tables for missing_idxs in the cache, ahead of decode or
+ * reconstruct calls on several column ranges that then share them
+ */
+int isa_l_prepare_decode(void *desc, int *missing_idxs)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor*)desc;
+    isa_l_decode_tables_t *tables = get_decode_tables(isa_l_desc, missing_idxs);
+
+    if (NULL == tables) {
+        return -1;
+    }
+    put_decode_tables(isa_l_desc, tables);
+    return 0;
+}
+
+int isa_l_decode(void *desc, char **data, char **parity,
+        int *missing_idxs, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor*)desc;
+
+    isa_l_decode_tables_t *tables = NULL;
+    unsigned char **decoded_elements = NULL;
+    unsigned char **available_fragments = NULL;
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int n = k + m;
+    int ret = -1;
+    int i, j;
+
+    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
+
+    tables = get_decode_tables(isa_l_desc, missing_idxs);
+    if (NULL == tables) {
+        goto out;
+    }
+
+    decoded_elements = (unsigned char**)malloc(sizeof(unsigned char*)*tables->num_missing);
     if (NULL == decoded_elements) {
         goto out;
     }
@@ -233,7 +332,7 @@ int isa_l_decode(void *desc, char **data, char **parity,
 
     j = 0;
     for (i = 0; i < n; i++) {
-        if (missing_bm & (1 << i)) {
+        if (missing_bm & (1ULL << i)) {
             continue;
         }
         if (j == k) {
@@ -250,30 +349,27 @@ int isa_l_decode(void *desc, char **data, char **parity,
     // Grab pointers to memory needed for missing data fragments
     j = 0;
     for (i = 0; i < k; i++) {
-        if (missing_bm & (1 << i)) {
+        if (missing_bm & (1ULL << i)) {
             decoded_elements[j] = (unsigned char*)data[i];
             j++;
         }
     }
     for (i = k; i < n; i++) {
-        if (missing_bm & (1 << i)) {
+        if (missing_bm & (1ULL << i)) {
             decoded_elements[j] = (unsigned char*)parity[i - k];
             j++;
         }
     }
 
-    isa_l_desc->ec_init_tables(k, num_missing_elements, inverse_rows, g_tbls);
-
-    isa_l_desc->ec_encode_data(blocksize, k, num_missing_elements, g_tbls, (unsigned char**)available_fragments,
+    isa_l_desc->ec_encode_data(blocksize, k, tables->num_missing, tables->g_tbls, (unsigned char**)available_fragments,
                                (unsigned char**)decoded_elements);
 
     ret = 0;
 
 out:
-    free(g_tbls);
-    free(decode_matrix);
-    free(decode_inverse);
-    free(inverse_rows);
+    if (NULL != tables) {
+        put_decode_tables(isa_l_desc, tables);
+    }
     free(decoded_elements);
     free(available_fragments);
 
@@ -284,10 +380,7 @@ int isa_l_reconstruct(void *desc, char **data, char **parity,
         int *missing_idxs, int destination_idx, int blocksize)
 {
     isa_l_descriptor *isa_l_desc = (isa_l_descriptor*) desc;
-    unsigned char *g_tbls = NULL;
-    unsigned char *decode_matrix = NULL;
-    unsigned char *decode_inverse = NULL;
-    unsigned char *inverse_rows = NULL;
+    isa_l_decode_tables_t *tables = NULL;
     unsigned char *reconstruct_buf = NULL;
     unsigned char **available_fragments = NULL;
     int k = isa_l_desc->k;
@@ -299,34 +392,11 @@ int isa_l_reconstruct(void *desc, char **data, char **parity,
     int inverse_row = -1;
 
     /**
-     * Get available elements and compute the inverse of their
-     * corresponding rows.
-     */
-    decode_matrix = isa_l_get_decode_matrix(k, m, isa_l_desc->matrix, missing_idxs);
-
-    if (NULL == decode_matrix) {
-        goto out;
-    }
-
-    decode_inverse = (unsigned char*)malloc(sizeof(unsigned char) * k * k);
-
-    if (NULL == decode_inverse) {
-        goto out;
-    }
-
-    int im_ret = isa_l_desc->gf_invert_matrix(decode_matrix, decode_inverse, k);
-    if (im_ret < 0) {
-        goto out;
-    }
-
-    /**
-     * Get the row needed to reconstruct
+     * Get the decode tables for the missing elements; the tables for the
+     * row we need are a slice of them
      */
-    inverse_rows = get_inverse_rows(k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, isa_l_desc->gf_mul);
-
-    // Generate g_tbls from computed decode matrix (k x k) matrix
-    g_tbls = malloc(sizeof(unsigned char) * (k * m * 32));
-    if (NULL == g_tbls) {
+    tables = get_decode_tables(isa_l_desc, missing_idxs);
+    if (NULL == tables) {
         goto out;
     }
 
@@ -340,7 +410,7 @@ int isa_l_reconstruct(void *desc, char **data, char **parity,
 
     j = 0;
     for (i = 0; i < n; i++) {
-        if (missing_bm & (1 << i)) {
+        if (missing_bm & (1ULL << i)) {
             continue;
         }
         if (j == k) {
@@ -359,7 +429,7 @@ int isa_l_reconstruct(void *desc, char **data, char **parity,
      */
     j = 0;
     for (i = 0; i < n; i++) {
-        if (missing_bm & (1 << i)) {
+        if (missing_bm & (1ULL << i)) {
             if (i == destination_idx) {
                 if (i < k) {
                     reconstruct_buf = (unsigned char*)data[i];
@@ -373,20 +443,22 @@ int isa_l_reconstruct(void *desc, char **data, char **parity,
         }
     }
 
+    if (inverse_row < 0) {
+        goto out;
+    }
+
     /**
      * Do the reconstruction
      */
-    isa_l_desc->ec_init_tables(k, 1, &inverse_rows[inverse_row * k], g_tbls);
-
-    isa_l_desc->ec_encode_data(blocksize, k, 1, g_tbls, (unsigned char**)available_fragments,
+    isa_l_desc->ec_encode_data(blocksize, k, 1, &tables->g_tbls[inverse_row * k * 32],
+                               (unsigned char**)available_fragments,
                                (unsigned char**)&reconstruct_buf);
 
     ret = 0;
 out:
-    free(g_tbls);
-    free(decode_matrix);
-    free(decode_inverse);
-    free(inverse_rows);
+    if (NULL != tables) {
+        put_decode_tables(isa_l_desc, tables);
+    }
     free(available_fragments);
 
     return ret;
@@ -404,7 +476,7 @@ int isa_l_min_fragments(void *desc, int *missing_idxs,
     int ret = -1;
 
     for (i = 0; i < (isa_l_desc->k + isa_l_desc->m); i++) {
-        if (!(missing_bm & (1 << i))) {
+        if (!(missing_bm & (1ULL << i))) {
             fragments_needed[j] = i;
             j++;
         }
@@ -435,6 +507,8 @@ int isa_l_exit(void *desc)
 
     isa_l_desc = (isa_l_descriptor*) desc;
 
+    ec_decode_cache_destroy(&isa_l_desc->decode_cache);
+
     free(isa_l_desc->encode_tables);
     free(isa_l_desc->matrix);
     free(isa_l_desc);
@@ -474,6 +548,7 @@ void * isa_l_common_init(struct ec_backend_args *args, void *backend_sohandle,
      */
     union {
         ec_encode_data_func encodep;
+        ec_encode_data_update_func encode_updatep;
         ec_init_tables_func init_tablesp;
         gf_gen_encoding_matrix_func gen_matrixp;
         gf_invert_matrix_func invert_matrixp;
@@ -489,6 +564,11 @@ void * isa_l_common_init(struct ec_backend_args *args, void *backend_sohandle,
         goto error;
     }
 
+    /* Not required; liberasurecode falls back to a full encode of the delta */
+    func_handle.vptr = NULL;
+    func_handle.vptr = dlsym(backend_sohandle, "ec_encode_data_update");
+    desc->ec_encode_data_update = func_handle.encode_updatep;
+
     func_handle.vptr = NULL;
     func_handle.vptr = dlsym(backend_sohandle, "ec_init_tables");
     desc->ec_init_tables = func_handle.init_tablesp;
@@ -542,8 +622,16 @@ void * isa_l_common_init(struct ec_backend_args *args, void *backend_sohandle,
                          &desc->matrix[desc->k * desc->k],
                          desc->encode_tables);
 
+    if (ec_decode_cache_init(&desc->decode_cache, ISA_L_DECODE_CACHE_SIZE,
+                             build_decode_tables, free_decode_tables,
+                             desc) != 0) {
+        goto error_free_tables;
+    }
+
     return desc;
 
+error_free_tables:
+    free(desc->encode_tables);
 error_free:
     free(desc->matrix);
 error:
@@ -72,6 +72,8 @@ struct ec_backend_op_stubs isa_l_rs_vand_op_stubs = {
     .ISCOMPATIBLEWITH           = isa_l_rs_vand_is_compatible_with,
     .GETMETADATASIZE            = get_backend_metadata_size_zero,
     .GETENCODEOFFSET            = get_encode_offset_zero,
+    .ENCODEUPDATE               = isa_l_encode_update,
+    .PREPAREDECODE              = isa_l_prepare_decode,
 };
 
 struct ec_backend_common backend_isa_l_rs_vand = {
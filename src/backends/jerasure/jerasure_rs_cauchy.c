@@ -31,6 +31,7 @@
 
 #include "erasurecode.h"
 #include "erasurecode_backend.h"
+#include "erasurecode_decode_cache.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
 
@@ -56,20 +57,28 @@ typedef int** (*jerasure_smart_bitmatrix_to_schedule_func)
     (int, int, int, int *);
 typedef void (*jerasure_bitmatrix_encode_func)
     (int, int, int, int *, char **, char **, int, int);
-typedef int (*jerasure_bitmatrix_decode_func)
-    (int, int, int, int *, int, int *,char **, char **, int, int);
 typedef int * (*jerasure_erasures_to_erased_func)(int, int, int *);
 typedef int (*jerasure_make_decoding_bitmatrix_func)
     (int, int, int, int *, int *, int *, int *);
-typedef void (*jerasure_bitmatrix_dotprod_func)
-    (int, int, int *, int *, int,char **, char **, int, int);
+typedef void (*jerasure_schedule_encode_func)
+    (int, int, int, int **, char **, char **, int, int);
 typedef void (*galois_uninit_field_func)(int);
 
+/* Number of decoding schedules cached per descriptor */
+#define JERASURE_RS_CAUCHY_DECODE_CACHE_SIZE 32
+
 /*
- * ToDo (KMG): Should we make this a parameter, or is that
- * exposing too much b.s. to the client?
+ * Decoding schedule for one erasure pattern: computes the fragments in
+ * target_ids from the k survivors in src_ids, as a smart schedule over
+ * the combined (targets x survivors) decoding bitmatrix
  */
-#define PYECC_CAUCHY_PACKETSIZE sizeof(long) * 128
+struct jerasure_rs_cauchy_decode_sched {
+    struct ec_decode_cache_entry entry;     /* must come first */
+    int num_targets;
+    int *src_ids;
+    int *target_ids;
+    int **schedule;
+};
 
 struct jerasure_rs_cauchy_descriptor {
     /* calls required for init */
@@ -84,22 +93,22 @@ struct jerasure_rs_cauchy_descriptor {
     jerasure_bitmatrix_encode_func jerasure_bitmatrix_encode;
                             
     
-    /* calls required for decode */
-    jerasure_bitmatrix_decode_func jerasure_bitmatrix_decode;
-                            
-    
-    /* calls required for reconstruct */
+    /* calls required for decode and reconstruct */
     jerasure_erasures_to_erased_func jerasure_erasures_to_erased;
     jerasure_make_decoding_bitmatrix_func jerasure_make_decoding_bitmatrix;
-    jerasure_bitmatrix_dotprod_func jerasure_bitmatrix_dotprod;
+    jerasure_schedule_encode_func jerasure_schedule_encode;
 
     /* fields needed to hold state */
     int *matrix;
     int *bitmatrix;
     int **schedule;
+
+    /* LRU cache of decoding schedules */
+    ec_decode_cache_t decode_cache;
     int k;
     int m;
     int w;
+    uint64_t packetsize;    /* bytes, or EC_CAUCHY_PACKETSIZE_AUTO */
 };
 static void free_rs_cauchy_desc(
         struct jerasure_rs_cauchy_descriptor *jerasure_desc );
@@ -115,8 +124,193 @@ static int jerasure_rs_cauchy_encode(void *desc, char **data, char **parity,
     jerasure_desc->jerasure_bitmatrix_encode(jerasure_desc->k, jerasure_desc->m,
                                 jerasure_desc->w, jerasure_desc->bitmatrix,
                                 data, parity, blocksize,
-                                PYECC_CAUCHY_PACKETSIZE);
+                                get_cauchy_packetsize(jerasure_desc->packetsize,
+                                        jerasure_desc->w, blocksize));
+
+    return 0;
+}
+
+// NOTE, based on an inspection of the jerasure code used to build the
+// the schedule array, it appears that the sentinal used to signal the end
+// of the array is a value of -1 in the first int field in the dereferenced
+// value. We use this determine when to stop free-ing elements. See the
+// jerasure_smart_bitmatrix_to_schedule and
+// jerasure_dumb_bitmatrix_to_schedule functions in jerasure.c for the
+// details.
+static void free_schedule(int **schedule)
+{
+    int i = 0;
+    bool end_of_array = false;
+
+    if (schedule != NULL) {
+        while (!end_of_array) {
+            if (schedule[i] == NULL || schedule[i][0] == -1) {
+                end_of_array = true;
+            }
+            free(schedule[i]);
+            i++;
+        }
+    }
+
+    free(schedule);
+}
+
+static void free_decode_sched(struct ec_decode_cache_entry *entry)
+{
+    struct jerasure_rs_cauchy_decode_sched *sched =
+        (struct jerasure_rs_cauchy_decode_sched *)entry;
+
+    free_schedule(sched->schedule);
+    free(sched->src_ids);
+    free(sched->target_ids);
+    free(sched);
+}
+
+/*
+ * Build the schedule that recomputes the fragments in target_bm when the
+ * fragments in missing_idxs are unavailable.  Rows for missing data come
+ * straight from the inverse of the survivor bitmatrix; rows for parity
+ * are the coding bitmatrix rows multiplied by that inverse.
+ */
+static struct ec_decode_cache_entry *build_decode_sched(void *desc,
+        int *missing_idxs, uint64_t missing_bm, uint64_t target_bm)
+{
+    struct jerasure_rs_cauchy_descriptor *jerasure_desc =
+        (struct jerasure_rs_cauchy_descriptor*)desc;
+    struct jerasure_rs_cauchy_decode_sched *sched = NULL;
+    int k = jerasure_desc->k;
+    int m = jerasure_desc->m;
+    int w = jerasure_desc->w;
+    int kw = k * w;
+    int *erased = NULL;
+    int *decoding_matrix = NULL;
+    int *target_matrix = NULL;
+    int ret = -1;
+    int i, j, r, c;
+
+    sched = (struct jerasure_rs_cauchy_decode_sched *)
+        alloc_zeroed_buffer(sizeof(struct jerasure_rs_cauchy_decode_sched));
+    if (NULL == sched) {
+        goto out;
+    }
+    sched->num_targets = __builtin_popcountll(target_bm);
+
+    sched->src_ids = (int *) alloc_zeroed_buffer(sizeof(int) * k);
+    sched->target_ids = (int *) alloc_zeroed_buffer(sizeof(int) * sched->num_targets);
+    decoding_matrix = (int *) alloc_zeroed_buffer(sizeof(int) * kw * kw);
+    target_matrix = (int *) alloc_zeroed_buffer(sizeof(int) * sched->num_targets * w * kw);
+    erased = jerasure_desc->jerasure_erasures_to_erased(k, m, missing_idxs);
+    if (NULL == sched->src_ids || NULL == sched->target_ids ||
+        NULL == decoding_matrix || NULL == target_matrix || NULL == erased) {
+        goto out;
+    }
+
+    if (jerasure_desc->jerasure_make_decoding_bitmatrix(k, m, w,
+                jerasure_desc->bitmatrix, erased, decoding_matrix,
+                sched->src_ids) < 0) {
+        goto out;
+    }
+
+    for (i = 0, j = 0; i < k + m; i++) {
+        int *rows;
+
+        if (!(target_bm & (1ULL << i))) {
+            continue;
+        }
+        sched->target_ids[j] = i;
+        rows = target_matrix + (j * w * kw);
+        if (i < k) {
+            memcpy(rows, decoding_matrix + (i * w * kw), sizeof(int) * w * kw);
+        } else {
+            int *coding_rows = jerasure_desc->bitmatrix + ((i - k) * w * kw);
+            for (r = 0; r < w; r++) {
+                for (c = 0; c < kw; c++) {
+                    if (coding_rows[(r * kw) + c]) {
+                        int x;
+                        for (x = 0; x < kw; x++) {
+                            rows[(r * kw) + x] ^= decoding_matrix[(c * kw) + x];
+                        }
+                    }
+                }
+            }
+        }
+        j++;
+    }
+
+    sched->schedule = jerasure_desc->jerasure_smart_bitmatrix_to_schedule(k,
+            sched->num_targets, w, target_matrix);
+    if (NULL == sched->schedule) {
+        goto out;
+    }
+
+    ret = 0;
+
+out:
+    if (ret < 0 && NULL != sched) {
+        free_decode_sched(&sched->entry);
+        sched = NULL;
+    }
+    free(erased);
+    free(decoding_matrix);
+    free(target_matrix);
+
+    return (struct ec_decode_cache_entry *)sched;
+}
+
+static void put_decode_sched(struct jerasure_rs_cauchy_descriptor *jerasure_desc,
+        struct jerasure_rs_cauchy_decode_sched *sched)
+{
+    ec_decode_cache_put(&jerasure_desc->decode_cache, &sched->entry);
+}
+
+/*
+ * Return a referenced decoding schedule for (missing_idxs, target_bm),
+ * from the cache if possible; release it with put_decode_sched()
+ */
+static struct jerasure_rs_cauchy_decode_sched *get_decode_sched(
+        struct jerasure_rs_cauchy_descriptor *jerasure_desc,
+        int *missing_idxs, uint64_t target_bm)
+{
+    return (struct jerasure_rs_cauchy_decode_sched *)
+        ec_decode_cache_get(&jerasure_desc->decode_cache, missing_idxs,
+                            target_bm);
+}
+
+static int run_decode_sched(struct jerasure_rs_cauchy_descriptor *jerasure_desc,
+        struct jerasure_rs_cauchy_decode_sched *sched,
+        char **data, char **parity, int blocksize)
+{
+    int k = jerasure_desc->k;
+    char **srcs = NULL;
+    char **targets = NULL;
+    int i;
+
+    srcs = (char **) alloc_zeroed_buffer(sizeof(char *) * k);
+    targets = (char **) alloc_zeroed_buffer(sizeof(char *) * sched->num_targets);
+    if (NULL == srcs || NULL == targets) {
+        free(srcs);
+        free(targets);
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < k; i++) {
+        int id = sched->src_ids[i];
+        srcs[i] = (id < k) ? data[id] : parity[id - k];
+    }
+    for (i = 0; i < sched->num_targets; i++) {
+        int id = sched->target_ids[i];
+        targets[i] = (id < k) ? data[id] : parity[id - k];
+    }
+
+    jerasure_desc->jerasure_schedule_encode(k, sched->num_targets,
+                                            jerasure_desc->w, sched->schedule,
+                                            srcs, targets, blocksize,
+                                            get_cauchy_packetsize(
+                                                jerasure_desc->packetsize,
+                                                jerasure_desc->w, blocksize));
 
+    free(srcs);
+    free(targets);
     return 0;
 }
 
@@ -125,82 +319,48 @@ static int jerasure_rs_cauchy_decode(void *desc, char **data, char **parity,
 {
     struct jerasure_rs_cauchy_descriptor *jerasure_desc = 
         (struct jerasure_rs_cauchy_descriptor*)desc;
+    struct jerasure_rs_cauchy_decode_sched *sched = NULL;
+    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
+    int ret;
 
-    return jerasure_desc->jerasure_bitmatrix_decode(jerasure_desc->k, 
-                                             jerasure_desc->m, 
-                                             jerasure_desc->w, 
-                                             jerasure_desc->bitmatrix, 
-                                             0, 
-                                             missing_idxs,
-                                             data, 
-                                             parity, 
-                                             blocksize, 
-                                             PYECC_CAUCHY_PACKETSIZE); 
+    if (0 == missing_bm) {
+        return 0;
+    }
+
+    sched = get_decode_sched(jerasure_desc, missing_idxs, missing_bm);
+    if (NULL == sched) {
+        return -1;
+    }
+
+    ret = run_decode_sched(jerasure_desc, sched, data, parity, blocksize);
+    put_decode_sched(jerasure_desc, sched);
+
+    return ret;
 }
 
 static int jerasure_rs_cauchy_reconstruct(void *desc, char **data, char **parity,
         int *missing_idxs, int destination_idx, int blocksize)
 {
-    int k, m, w;                  /* erasure code paramters */
-    int ret = 0;                  /* return code */
-    int *decoding_row = NULL;     /* decoding matrix row for decode */
-    int *erased = NULL;           /* k+m length list of erased frag ids */
-    int *dm_ids = NULL;           /* k length list of fragment ids */
-    int *decoding_matrix = NULL;  /* matrix for decoding */
-
     struct jerasure_rs_cauchy_descriptor *jerasure_desc = 
         (struct jerasure_rs_cauchy_descriptor*) desc;
-    k = jerasure_desc->k;
-    m = jerasure_desc->m;
-    w = jerasure_desc->w;
-
-    if (destination_idx < k) {
-        dm_ids = (int *) alloc_zeroed_buffer(sizeof(int) * k);
-        decoding_matrix = (int *) alloc_zeroed_buffer(sizeof(int *) * k * k * w * w);
-        erased = jerasure_desc->jerasure_erasures_to_erased(k, m, missing_idxs);
-        if (NULL == decoding_matrix || NULL == dm_ids || NULL == erased) {
-            goto out;
-        }
+    struct jerasure_rs_cauchy_decode_sched *sched = NULL;
+    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
+    int ret;
 
-        ret = jerasure_desc->jerasure_make_decoding_bitmatrix(k, m, w, 
-                                               jerasure_desc->bitmatrix,
-                                               erased, decoding_matrix, dm_ids);
-        if (ret == 0) {
-            decoding_row = decoding_matrix + (destination_idx * k * w * w);
-   
-            jerasure_desc->jerasure_bitmatrix_dotprod(jerasure_desc->k, jerasure_desc->w, 
-                                   decoding_row, dm_ids, destination_idx,
-                                   data, parity, blocksize, PYECC_CAUCHY_PACKETSIZE);
-        } else {
-           /*
-            * ToDo (KMG) I know this is not needed, but keeping to prevent future 
-            * memory leaks, as this function will be better optimized for decoding 
-            * missing parity 
-            */
-            goto out;
-        }
-    } else {
-        /*
-         * If it is parity we are reconstructing, then just call decode.
-         * ToDo (KMG): We can do better than this, but this should perform just
-         * fine for most cases.  We can adjust the decoding matrix like we
-         * did with ISA-L.
-         */
-        jerasure_desc->jerasure_bitmatrix_decode(k, m, w,
-                                             jerasure_desc->bitmatrix, 
-                                             0, 
-                                             missing_idxs,
-                                             data, 
-                                             parity, 
-                                             blocksize, 
-                                             PYECC_CAUCHY_PACKETSIZE); 
+    /* destination_idx must be one of the missing fragments */
+    if (destination_idx < 0 || !(missing_bm & (1ULL << destination_idx))) {
+        return -1;
     }
 
-out:
-    free(erased);
-    free(decoding_matrix);
-    free(dm_ids);
-    
+    /* Only the destination row is needed, for data and parity alike */
+    sched = get_decode_sched(jerasure_desc, missing_idxs, 1ULL << destination_idx);
+    if (NULL == sched) {
+        return -1;
+    }
+
+    ret = run_decode_sched(jerasure_desc, sched, data, parity, blocksize);
+    put_decode_sched(jerasure_desc, sched);
+
     return ret;
 }
 
@@ -220,7 +380,7 @@ static int jerasure_rs_cauchy_min_fragments(void *desc, int *missing_idxs,
     int ret = -1;
 
     for (i = 0; i < (jerasure_desc->k + jerasure_desc->m); i++) {
-        if (!(missing_bm & (1 << i))) {
+        if (!(missing_bm & (1ULL << i))) {
             fragments_needed[j] = i;
             j++;
         }
@@ -240,6 +400,7 @@ static void * jerasure_rs_cauchy_init(struct ec_backend_args *args,
 {
     struct jerasure_rs_cauchy_descriptor *desc = NULL;
     int k, m, w;
+    uint64_t packetsize;
     
     desc = (struct jerasure_rs_cauchy_descriptor *)
            malloc(sizeof(struct jerasure_rs_cauchy_descriptor));
@@ -253,11 +414,16 @@ static void * jerasure_rs_cauchy_init(struct ec_backend_args *args,
     if (args->uargs.w <= 0)
         args->uargs.w = DEFAULT_W;
     w = args->uargs.w;
+    if (0 == args->uargs.priv_args1.jerasure_cauchy_args.packetsize)
+        args->uargs.priv_args1.jerasure_cauchy_args.packetsize =
+            EC_CAUCHY_DEFAULT_PACKETSIZE;
+    packetsize = args->uargs.priv_args1.jerasure_cauchy_args.packetsize;
 
     /* store the base EC arguments in the descriptor */
     desc->k = k;
     desc->m = m;
     desc->w = w;
+    desc->packetsize = packetsize;
 
     /* validate EC arguments */
     {
@@ -268,6 +434,13 @@ static void * jerasure_rs_cauchy_init(struct ec_backend_args *args,
         }
     }
 
+    /* jerasure XORs whole longs, and k * w packets must fit an int */
+    if (EC_CAUCHY_PACKETSIZE_AUTO != packetsize &&
+        (packetsize % sizeof(long) != 0 ||
+         (k > 0 && packetsize > (uint64_t) (INT_MAX / (k * w))))) {
+        goto error;
+    }
+
     /*
      * ISO C forbids casting a void* to a function pointer.
      * Since dlsym return returns a void*, we use this union to
@@ -279,10 +452,9 @@ static void * jerasure_rs_cauchy_init(struct ec_backend_args *args,
         jerasure_smart_bitmatrix_to_schedule_func matrixschedulep;
         galois_uninit_field_func uninitp;
         jerasure_bitmatrix_encode_func encodep;
-        jerasure_bitmatrix_decode_func decodep;
         jerasure_erasures_to_erased_func erasedp; 
         jerasure_make_decoding_bitmatrix_func decodematrixp;
-        jerasure_bitmatrix_dotprod_func dotprodp;
+        jerasure_schedule_encode_func schedencodep;
         void *vptr;
     } func_handle = {.vptr = NULL};
     
@@ -294,13 +466,6 @@ static void * jerasure_rs_cauchy_init(struct ec_backend_args *args,
         goto error; 
     }
   
-    func_handle.vptr = NULL;
-    func_handle.vptr = dlsym(backend_sohandle, "jerasure_bitmatrix_decode");
-    desc->jerasure_bitmatrix_decode = func_handle.decodep;
-    if (NULL == desc->jerasure_bitmatrix_decode) {
-        goto error; 
-    }
-  
     func_handle.vptr = NULL;
     func_handle.vptr = dlsym(backend_sohandle, "cauchy_original_coding_matrix");
     desc->cauchy_original_coding_matrix = func_handle.initp;
@@ -330,9 +495,9 @@ static void * jerasure_rs_cauchy_init(struct ec_backend_args *args,
     }
     
     func_handle.vptr = NULL;
-    func_handle.vptr = dlsym(backend_sohandle, "jerasure_bitmatrix_dotprod");
-    desc->jerasure_bitmatrix_dotprod = func_handle.dotprodp;
-    if (NULL == desc->jerasure_bitmatrix_dotprod) {
+    func_handle.vptr = dlsym(backend_sohandle, "jerasure_schedule_encode");
+    desc->jerasure_schedule_encode = func_handle.schedencodep;
+    if (NULL == desc->jerasure_schedule_encode) {
         goto error; 
     }
   
@@ -364,6 +529,14 @@ static void * jerasure_rs_cauchy_init(struct ec_backend_args *args,
         goto schedule_error;
     }
 
+    if (ec_decode_cache_init(&desc->decode_cache,
+                             JERASURE_RS_CAUCHY_DECODE_CACHE_SIZE,
+                             build_decode_sched, free_decode_sched,
+                             desc) != 0) {
+        free_schedule(desc->schedule);
+        goto schedule_error;
+    }
+
     return desc;
 
 schedule_error:
@@ -387,20 +560,23 @@ jerasure_rs_cauchy_element_size(void* desc)
     struct jerasure_rs_cauchy_descriptor *jerasure_desc = 
         (struct jerasure_rs_cauchy_descriptor*)desc;
 
-    return jerasure_desc->w * PYECC_CAUCHY_PACKETSIZE * 8;
+    /* in auto mode the packetsize varies per object; report the smallest */
+    if (EC_CAUCHY_PACKETSIZE_AUTO == jerasure_desc->packetsize) {
+        return jerasure_desc->w * sizeof(long) * 8;
+    }
+
+    return jerasure_desc->w * jerasure_desc->packetsize * 8;
 }
 
 static void free_rs_cauchy_desc(
         struct jerasure_rs_cauchy_descriptor *jerasure_desc )
 {
-    int i = 0;
-    int **schedule = NULL;
-    bool end_of_array = false;
-
     if (jerasure_desc == NULL) {
         return;
     }
 
+    ec_decode_cache_destroy(&jerasure_desc->decode_cache);
+
     /*
      * jerasure allocates some internal data structures for caching
      * fields. It will allocate one for w, and if we do anything that
@@ -412,26 +588,7 @@ static void free_rs_cauchy_desc(
     jerasure_desc->galois_uninit_field(32);
     free(jerasure_desc->matrix);
     free(jerasure_desc->bitmatrix);
-
-    // NOTE, based on an inspection of the jerasure code used to build the
-    // the schedule array, it appears that the sentinal used to signal the end
-    // of the array is a value of -1 in the first int field in the dereferenced
-    // value. We use this determine when to stop free-ing elements. See the
-    // jerasure_smart_bitmatrix_to_schedule and 
-    // jerasure_dumb_bitmatrix_to_schedule functions in jerasure.c for the
-    // details.
-    schedule = jerasure_desc->schedule;
-    if (schedule != NULL) {
-        while (!end_of_array) {
-            if (schedule[i] == NULL || schedule[i][0] == -1) {
-                end_of_array = true;
-            }
-            free(schedule[i]);
-            i++;
-        }
-    }
-
-    free(schedule);
+    free_schedule(jerasure_desc->schedule);
     free(jerasure_desc);
 }
 
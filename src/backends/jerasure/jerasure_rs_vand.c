@@ -31,6 +31,7 @@
 
 #include "erasurecode.h"
 #include "erasurecode_backend.h"
+#include "erasurecode_decode_cache.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
 
@@ -52,12 +53,22 @@ struct ec_backend_common backend_jerasure_rs_vand;
 
 typedef int* (*reed_sol_vandermonde_coding_matrix_func)(int, int, int);
 typedef void (*jerasure_matrix_encode_func)(int, int, int, int*, char **, char **, int); 
-typedef int (*jerasure_matrix_decode_func)(int, int, int, int *, int, int*, char **, char **, int);
 typedef int (*jerasure_make_decoding_matrix_func)(int, int, int, int *, int *, int *, int *);
 typedef int * (*jerasure_erasures_to_erased_func)(int, int, int *);
 typedef void (*jerasure_matrix_dotprod_func)(int, int, int *,int *, int,char **, char **, int);
 typedef void (*galois_uninit_field_func)(int);
 
+/* Number of decoding matrices cached per descriptor */
+#define JERASURE_RS_VAND_DECODE_CACHE_SIZE 32
+
+/* Decoding matrix for one erasure pattern */
+struct jerasure_rs_vand_decode_matrix {
+    struct ec_decode_cache_entry entry;     /* must come first */
+    int *erased;                /* k+m flags, 1 for each missing fragment */
+    int *dm_ids;                /* the k fragments the matrix decodes from */
+    int *decoding_matrix;       /* k x k */
+};
+
 struct jerasure_rs_vand_descriptor {
     /* calls required for init */
     reed_sol_vandermonde_coding_matrix_func reed_sol_vandermonde_coding_matrix;
@@ -68,16 +79,17 @@ struct jerasure_rs_vand_descriptor {
     /* calls required for encode */
     jerasure_matrix_encode_func jerasure_matrix_encode;
     
-    /* calls required for decode */
-    jerasure_matrix_decode_func jerasure_matrix_decode;
-    
-    /* calls required for reconstruct */
+    /* calls required for decode and reconstruct */
     jerasure_make_decoding_matrix_func jerasure_make_decoding_matrix;
     jerasure_erasures_to_erased_func jerasure_erasures_to_erased;
     jerasure_matrix_dotprod_func jerasure_matrix_dotprod;
 
     /* fields needed to hold state */
     int *matrix;
+
+    /* LRU cache of decoding matrices */
+    ec_decode_cache_t decode_cache;
+
     int k;
     int m;
     int w;
@@ -96,16 +108,116 @@ static int jerasure_rs_vand_encode(void *desc, char **data, char **parity,
     return 0;
 }
 
+static void free_decode_matrix(struct ec_decode_cache_entry *entry)
+{
+    struct jerasure_rs_vand_decode_matrix *dm =
+        (struct jerasure_rs_vand_decode_matrix *)entry;
+
+    free(dm->erased);
+    free(dm->dm_ids);
+    free(dm->decoding_matrix);
+    free(dm);
+}
+
+static struct ec_decode_cache_entry *build_decode_matrix(void *desc,
+        int *missing_idxs, uint64_t missing_bm, uint64_t target_bm)
+{
+    struct jerasure_rs_vand_descriptor *jerasure_desc =
+        (struct jerasure_rs_vand_descriptor*)desc;
+    struct jerasure_rs_vand_decode_matrix *dm = NULL;
+    int k = jerasure_desc->k;
+
+    dm = (struct jerasure_rs_vand_decode_matrix *)
+        alloc_zeroed_buffer(sizeof(struct jerasure_rs_vand_decode_matrix));
+    if (NULL == dm) {
+        return NULL;
+    }
+
+    dm->dm_ids = (int *) alloc_zeroed_buffer(sizeof(int) * k);
+    dm->decoding_matrix = (int *) alloc_zeroed_buffer(sizeof(int) * k * k);
+    dm->erased = jerasure_desc->jerasure_erasures_to_erased(k,
+            jerasure_desc->m, missing_idxs);
+    if (NULL == dm->dm_ids || NULL == dm->decoding_matrix || NULL == dm->erased) {
+        free_decode_matrix(&dm->entry);
+        return NULL;
+    }
+
+    if (jerasure_desc->jerasure_make_decoding_matrix(k, jerasure_desc->m,
+                jerasure_desc->w, jerasure_desc->matrix, dm->erased,
+                dm->decoding_matrix, dm->dm_ids) < 0) {
+        free_decode_matrix(&dm->entry);
+        return NULL;
+    }
+
+    return &dm->entry;
+}
+
+static void put_decode_matrix(struct jerasure_rs_vand_descriptor *jerasure_desc,
+        struct jerasure_rs_vand_decode_matrix *dm)
+{
+    ec_decode_cache_put(&jerasure_desc->decode_cache, &dm->entry);
+}
+
+/*
+ * Return a referenced decoding matrix for missing_idxs, from the cache if
+ * possible; release it with put_decode_matrix()
+ */
+static struct jerasure_rs_vand_decode_matrix *get_decode_matrix(
+        struct jerasure_rs_vand_descriptor *jerasure_desc, int *missing_idxs)
+{
+    return (struct jerasure_rs_vand_decode_matrix *)
+        ec_decode_cache_get(&jerasure_desc->decode_cache, missing_idxs, 0);
+}
+
+/*
+ * Put the decoding matrix for missing_idxs in the cache, ahead of decode
+ * or reconstruct calls on several column ranges that then share it
+ */
+static int jerasure_rs_vand_prepare_decode(void *desc, int *missing_idxs)
+{
+    struct jerasure_rs_vand_descriptor *jerasure_desc =
+        (struct jerasure_rs_vand_descriptor*)desc;
+    struct jerasure_rs_vand_decode_matrix *dm;
+
+    dm = get_decode_matrix(jerasure_desc, missing_idxs);
+    if (NULL == dm) {
+        return -1;
+    }
+    put_decode_matrix(jerasure_desc, dm);
+    return 0;
+}
+
 static int jerasure_rs_vand_decode(void *desc, char **data, char **parity,
         int *missing_idxs, int blocksize)
 {
     struct jerasure_rs_vand_descriptor *jerasure_desc = 
         (struct jerasure_rs_vand_descriptor*)desc;
+    struct jerasure_rs_vand_decode_matrix *dm = NULL;
+    int k = jerasure_desc->k;
+    int i;
+
+    dm = get_decode_matrix(jerasure_desc, missing_idxs);
+    if (NULL == dm) {
+        return -1;
+    }
+
+    /* Same steps as jerasure_matrix_decode: data first, then parity */
+    for (i = 0; i < k; i++) {
+        if (dm->erased[i]) {
+            jerasure_desc->jerasure_matrix_dotprod(k, jerasure_desc->w,
+                    dm->decoding_matrix + (i * k), dm->dm_ids, i,
+                    data, parity, blocksize);
+        }
+    }
+    for (i = 0; i < jerasure_desc->m; i++) {
+        if (dm->erased[k + i]) {
+            jerasure_desc->jerasure_matrix_dotprod(k, jerasure_desc->w,
+                    jerasure_desc->matrix + (i * k), NULL, k + i,
+                    data, parity, blocksize);
+        }
+    }
 
-    /* FIXME - make jerasure_matrix_decode return a value */
-    jerasure_desc->jerasure_matrix_decode(jerasure_desc->k,
-            jerasure_desc->m, jerasure_desc->w,
-            jerasure_desc->matrix, 1, missing_idxs, data, parity, blocksize);
+    put_decode_matrix(jerasure_desc, dm);
 
     return 0;
 }
@@ -113,63 +225,33 @@ static int jerasure_rs_vand_decode(void *desc, char **data, char **parity,
 static int jerasure_rs_vand_reconstruct(void *desc, char **data, char **parity,
         int *missing_idxs, int destination_idx, int blocksize)
 {
-    int ret = 0;                  /* return code */
-    int *decoding_row;            /* decoding matrix row for decode */
-    int *erased = NULL;           /* k+m length list of erased frag ids */
-    int *dm_ids = NULL;           /* k length list of frag ids */
-    int *decoding_matrix = NULL;  /* matrix for decoding */
-
     struct jerasure_rs_vand_descriptor *jerasure_desc = 
         (struct jerasure_rs_vand_descriptor*) desc;
-    
-    if (destination_idx < jerasure_desc->k) {
-        dm_ids = (int *) alloc_zeroed_buffer(sizeof(int) * jerasure_desc->k);
-        decoding_matrix = (int *)
-            alloc_zeroed_buffer(sizeof(int*) * jerasure_desc->k * jerasure_desc->k);
-        erased = jerasure_desc->jerasure_erasures_to_erased(jerasure_desc->k,
-                jerasure_desc->m, missing_idxs);
-        if (NULL == decoding_matrix || NULL == dm_ids || NULL == erased) {
-            goto out;
-        }
+    struct jerasure_rs_vand_decode_matrix *dm = NULL;
 
-        ret = jerasure_desc->jerasure_make_decoding_matrix(jerasure_desc->k,
-                jerasure_desc->m, jerasure_desc->w, jerasure_desc->matrix,
-                erased, decoding_matrix, dm_ids);
-
-        decoding_row = decoding_matrix + (destination_idx * jerasure_desc->k);
-    
-        if (ret == 0) {
-            jerasure_desc->jerasure_matrix_dotprod(jerasure_desc->k,
-                    jerasure_desc->w, decoding_row, dm_ids, destination_idx,
-                    data, parity, blocksize);
-        } else {
-            /*
-             * ToDo (KMG) I know this is not needed, but keeping to prevent future 
-             *  memory leaks, as this function will be better optimized for decoding 
-             * missing parity 
-             */
-            goto out;
-        }
-    } else {
+    if (destination_idx >= jerasure_desc->k) {
         /*
          * If it is parity we are reconstructing, then just call decode.
          * ToDo (KMG): We can do better than this, but this should perform just
          * fine for most cases.  We can adjust the decoding matrix like we
          * did with ISA-L.
          */
-        jerasure_desc->jerasure_matrix_decode(jerasure_desc->k,
-                        jerasure_desc->m, jerasure_desc->w,
-                        jerasure_desc->matrix, 1, missing_idxs, data, parity, blocksize);
-        goto parity_reconstr_out;
+        return jerasure_rs_vand_decode(desc, data, parity, missing_idxs,
+                                       blocksize);
     }
 
-out:
-    free(erased);
-    free(decoding_matrix);
-    free(dm_ids);
+    dm = get_decode_matrix(jerasure_desc, missing_idxs);
+    if (NULL == dm) {
+        return -1;
+    }
 
-parity_reconstr_out:
-    return ret;
+    jerasure_desc->jerasure_matrix_dotprod(jerasure_desc->k,
+            jerasure_desc->w, dm->decoding_matrix + (destination_idx * jerasure_desc->k),
+            dm->dm_ids, destination_idx, data, parity, blocksize);
+
+    put_decode_matrix(jerasure_desc, dm);
+
+    return 0;
 }
 
 static int jerasure_rs_vand_min_fragments(void *desc, int *missing_idxs,
@@ -185,7 +267,7 @@ static int jerasure_rs_vand_min_fragments(void *desc, int *missing_idxs,
     int ret = -1;
 
     for (i = 0; i < (jerasure_desc->k + jerasure_desc->m); i++) {
-        if (!(missing_bm & (1 << i))) {
+        if (!(missing_bm & (1ULL << i))) {
             fragments_needed[j] = i;
             j++;
         }
@@ -241,7 +323,6 @@ static void * jerasure_rs_vand_init(struct ec_backend_args *args,
         reed_sol_vandermonde_coding_matrix_func initp;
         galois_uninit_field_func uninitp;
         jerasure_matrix_encode_func encodep;
-        jerasure_matrix_decode_func decodep;
         jerasure_make_decoding_matrix_func decodematrixp;
         jerasure_erasures_to_erased_func erasep;
         jerasure_matrix_dotprod_func dotprodp;
@@ -257,13 +338,6 @@ static void * jerasure_rs_vand_init(struct ec_backend_args *args,
         goto error; 
     }
   
-    func_handle.vptr = NULL;
-    func_handle.vptr = dlsym(backend_sohandle, "jerasure_matrix_decode");
-    desc->jerasure_matrix_decode = func_handle.decodep;
-    if (NULL == desc->jerasure_matrix_decode) {
-        goto error; 
-    }
-  
     func_handle.vptr = NULL;
     func_handle.vptr = dlsym(backend_sohandle, "jerasure_make_decoding_matrix");
     desc->jerasure_make_decoding_matrix = func_handle.decodematrixp;
@@ -305,6 +379,14 @@ static void * jerasure_rs_vand_init(struct ec_backend_args *args,
         goto error; 
     }
 
+    if (ec_decode_cache_init(&desc->decode_cache,
+                             JERASURE_RS_VAND_DECODE_CACHE_SIZE,
+                             build_decode_matrix, free_decode_matrix,
+                             desc) != 0) {
+        free(desc->matrix);
+        goto error;
+    }
+
     return desc;
 
 error:
@@ -326,7 +408,7 @@ jerasure_rs_vand_element_size(void* desc)
     struct jerasure_rs_vand_descriptor *jerasure_desc = 
         (struct jerasure_rs_vand_descriptor*)desc;
 
-    /* Note that cauchy will return pyeclib_handle->w * PYECC_CAUCHY_PACKETSIZE * 8 */
+    /* Note that cauchy will return jerasure_desc->w * packetsize * 8 */
     return jerasure_desc->w;
 }
 
@@ -336,6 +418,8 @@ static int jerasure_rs_vand_exit(void *desc)
     
     jerasure_desc = (struct jerasure_rs_vand_descriptor*) desc;
 
+    ec_decode_cache_destroy(&jerasure_desc->decode_cache);
+
     /*
      * jerasure allocates some internal data structures for caching
      * fields. It will allocate one for w, and if we do anything that
@@ -370,6 +454,7 @@ struct ec_backend_op_stubs jerasure_rs_vand_op_stubs = {
     .ISCOMPATIBLEWITH           = jerasure_rs_vand_is_compatible_with,
     .GETMETADATASIZE            = get_backend_metadata_size_zero,
     .GETENCODEOFFSET            = get_encode_offset_zero,
+    .PREPAREDECODE              = jerasure_rs_vand_prepare_decode,
 };
 
 struct ec_backend_common backend_jerasure_rs_vand = {
@@ -74,6 +74,17 @@ static int flat_xor_hd_encode(void *desc,
     return 0;
 }
 
+static int flat_xor_hd_encode_update(void *desc, int data_idx,
+                                     char *delta, char **parity, int blocksize)
+{
+    struct flat_xor_hd_descriptor *xdesc =
+        (struct flat_xor_hd_descriptor *) desc;
+
+    xor_code_t *xor_desc = (xor_code_t *) xdesc->xor_desc;
+    xor_code_encode_update(xor_desc, data_idx, delta, parity, blocksize);
+    return 0;
+}
+
 static int flat_xor_hd_decode(void *desc,
                               char **data, char **parity, int *missing_idxs,
                               int blocksize)
@@ -142,7 +153,7 @@ static void * flat_xor_hd_init(struct ec_backend_args *args, void *sohandle)
     bdesc = (struct flat_xor_hd_descriptor *)
         malloc(sizeof(struct flat_xor_hd_descriptor));
     if (NULL == bdesc) {
-        free (xor_desc);
+        free_xor_hd_code(xor_desc);
         return NULL;
     }
 
@@ -156,7 +167,7 @@ static int flat_xor_hd_exit(void *desc)
     struct flat_xor_hd_descriptor *bdesc =
         (struct flat_xor_hd_descriptor *) desc;
 
-    free (bdesc->xor_desc);
+    free_xor_hd_code(bdesc->xor_desc);
     free (bdesc);
     return 0;
 }
@@ -180,6 +191,7 @@ struct ec_backend_op_stubs flat_xor_hd_op_stubs = {
     .ISCOMPATIBLEWITH           = flat_xor_is_compatible_with,
     .GETMETADATASIZE            = get_backend_metadata_size_zero,
     .GETENCODEOFFSET            = get_encode_offset_zero,
+    .ENCODEUPDATE               = flat_xor_hd_encode_update,
 };
 
 struct ec_backend_common backend_flat_xor_hd = {
@@ -31,6 +31,7 @@
 // like Jerasure with GF-Complete will give users the ability to tune to their
 // architecture (Intel or ARM), CPU and memory (lots of options).
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -45,13 +46,25 @@ int *log_table = NULL;
 int *ilog_table = NULL;
 int *ilog_table_begin = NULL;
 
+// The tables are shared by every instance, so only the first init builds
+// them and only the last deinit frees them
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static int tables_users = 0;
+
 void rs_galois_init_tables()
 {
-  log_table = (int*)malloc(sizeof(int)*FIELD_SIZE);
-  ilog_table_begin = (int*)malloc(sizeof(int)*FIELD_SIZE*3);
   int i = 0;
   int x = 1;
 
+  pthread_mutex_lock(&tables_lock);
+  if (tables_users++ > 0) {
+    pthread_mutex_unlock(&tables_lock);
+    return;
+  }
+
+  log_table = (int*)malloc(sizeof(int)*FIELD_SIZE);
+  ilog_table_begin = (int*)malloc(sizeof(int)*FIELD_SIZE*3);
+
   for (i = 0; i < GROUP_SIZE; i++) {
     log_table[x] = i;
     ilog_table_begin[i] = x;
@@ -63,12 +76,20 @@ void rs_galois_init_tables()
     }
   }
   ilog_table = &ilog_table_begin[GROUP_SIZE];
+  pthread_mutex_unlock(&tables_lock);
 }
 
 void rs_galois_deinit_tables()
 {
-  free(log_table);
-  free(ilog_table_begin);
+  pthread_mutex_lock(&tables_lock);
+  if (tables_users > 0 && --tables_users == 0) {
+    free(log_table);
+    free(ilog_table_begin);
+    log_table = NULL;
+    ilog_table = NULL;
+    ilog_table_begin = NULL;
+  }
+  pthread_mutex_unlock(&tables_lock);
 }
 
 int rs_galois_mult(int x, int y)
@@ -0,0 +1,189 @@
+/* * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Generator for the flat XOR HD code tables in xor_hd_code_gen_defs.h:
+ *
+ *   ./gen_xor_hd_code_defs > include/xor_codes/xor_hd_code_gen_defs.h
+ *
+ * A flat XOR code is described by one m-bit column per data element (its
+ * data_bms entry: the parities it is XORed into).  In parity-check form the
+ * parities are the unit columns, so:
+ *
+ *   HD 3: every column must be distinct with weight >= 2
+ *   HD 4: additionally, no three columns may XOR to zero; odd-weight
+ *         columns (weight >= 3) guarantee this
+ *
+ * Columns are picked greedily: lowest weight first (fewest XORs per data
+ * element), then whichever keeps the parities most evenly loaded.  Each
+ * list is a prefix code, so the (k, m, hd) code is its first k entries and
+ * tables never change for a k that was already shipped.
+ *
+ * Lists are capped at k + m <= 64 so that every fragment fits in a 64-bit
+ * bitmap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_GEN_FRAGMENTS 64
+
+static int popcount(unsigned int x)
+{
+  int n = 0;
+  while (x) {
+    n += x & 1;
+    x >>= 1;
+  }
+  return n;
+}
+
+static int is_candidate(unsigned int col, int hd)
+{
+  int w = popcount(col);
+
+  if (hd == 3) {
+    return w >= 2;
+  }
+  return w >= 3 && (w & 1);
+}
+
+/*
+ * Brute-force check that no hd-1 columns of the parity-check matrix
+ * (data columns plus unit parity columns) are dependent
+ */
+static int verify_code(unsigned int *cols, int k, int m, int hd)
+{
+  unsigned int h[MAX_GEN_FRAGMENTS];
+  int n = k + m;
+  int a, b, c;
+
+  for (a=0; a < k; a++) {
+    h[a] = cols[a];
+  }
+  for (a=0; a < m; a++) {
+    h[k + a] = 1U << a;
+  }
+
+  for (a=0; a < n; a++) {
+    if (h[a] == 0) {
+      return -1;
+    }
+    for (b=a+1; b < n; b++) {
+      if (h[a] == h[b]) {
+        return -1;
+      }
+      if (hd < 4) {
+        continue;
+      }
+      for (c=b+1; c < n; c++) {
+        if ((h[a] ^ h[b] ^ h[c]) == 0) {
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static int generate_code(int m, int hd, unsigned int *cols)
+{
+  int load[32] = { 0 };
+  int used[1 << 8] = { 0 };
+  int max_k = MAX_GEN_FRAGMENTS - m;
+  int k = 0;
+  int i, j;
+
+  while (k < max_k) {
+    int best = -1, best_w = 0, best_max = 0, best_sq = 0;
+
+    for (i=1; i < (1 << m); i++) {
+      int w, mx = 0, sq = 0;
+      if (used[i] || !is_candidate(i, hd)) {
+        continue;
+      }
+      w = popcount(i);
+      for (j=0; j < m; j++) {
+        int l = load[j] + ((i >> j) & 1);
+        if (l > mx) {
+          mx = l;
+        }
+        sq += l * l;
+      }
+      if (best < 0 || w < best_w ||
+          (w == best_w && (mx < best_max || (mx == best_max && sq < best_sq)))) {
+        best = i;
+        best_w = w;
+        best_max = mx;
+        best_sq = sq;
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+    used[best] = 1;
+    for (j=0; j < m; j++) {
+      load[j] += (best >> j) & 1;
+    }
+    cols[k++] = best;
+  }
+
+  return k;
+}
+
+int main(void)
+{
+  unsigned int cols[MAX_GEN_FRAGMENTS];
+  int hd, m, k, i;
+
+  printf("/*\n");
+  printf(" * Generated by src/builtin/xor_codes/gen_xor_hd_code_defs.c; do not edit.\n");
+  printf(" *\n");
+  printf(" * g_hdH_mM_gen_data_bms lists the data_bms columns of the generated\n");
+  printf(" * (k, M, H) codes; the code for a given k is the first k entries.\n");
+  printf(" */\n\n");
+  printf("#ifndef _XOR_HD_CODE_GEN_DEFS_H\n");
+  printf("#define _XOR_HD_CODE_GEN_DEFS_H\n\n");
+
+  for (hd=3; hd <= 4; hd++) {
+    for (m=5; m <= 7; m++) {
+      k = generate_code(m, hd, cols);
+      for (i=1; i <= k; i++) {
+        if (verify_code(cols, i, m, hd) < 0) {
+          fprintf(stderr, "Generated (%d, %d, %d) code is not HD %d!\n", i, m, hd, hd);
+          return 1;
+        }
+      }
+      printf("#define XOR_GEN_HD%d_M%d_MAX_K %d\n", hd, m, k);
+      printf("unsigned int g_hd%d_m%d_gen_data_bms[] = {", hd, m);
+      for (i=0; i < k; i++) {
+        printf("%s%s%u", i ? "," : "", (i % 16) ? " " : "\n  ", cols[i]);
+      }
+      printf(" };\n\n");
+    }
+  }
+
+  printf("#endif\n");
+  return 0;
+}
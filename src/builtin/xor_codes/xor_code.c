@@ -40,9 +40,9 @@ const int g_bit_lookup[] = {0x1, 0x2, 0x4, 0x8,
                                  0x1000000, 0x2000000, 0x4000000, 0x8000000,
                                  0x10000000, 0x20000000, 0x40000000, 0x80000000};
 
-int is_data_in_parity(int data_idx, unsigned int parity_bm)
+int is_data_in_parity(int data_idx, uint64_t parity_bm)
 {
-  return ((g_bit_lookup[data_idx] & parity_bm) == g_bit_lookup[data_idx]);
+  return (parity_bm >> data_idx) & 1;
 }
 
 int does_parity_have_data(int parity_idx, unsigned int data_bm)
@@ -50,20 +50,20 @@ int does_parity_have_data(int parity_idx, unsigned int data_bm)
   return ((g_bit_lookup[parity_idx] & data_bm) == g_bit_lookup[parity_idx]);
 }
 
-int parity_bit_lookup(xor_code_t *code_desc, int index)
+uint64_t parity_bit_lookup(xor_code_t *code_desc, int index)
 {
-  return g_bit_lookup[code_desc->k - index];
+  return (uint64_t)1 << (index - code_desc->k);
 }
 
-int data_bit_lookup(xor_code_t *code_desc, int index)
+uint64_t data_bit_lookup(xor_code_t *code_desc, int index)
 {
-  return g_bit_lookup[index];
+  return (uint64_t)1 << index;
 }
 
-int missing_elements_bm(xor_code_t *code_desc, int *missing_elements, int (*bit_lookup_func)(xor_code_t *code_desc, int index))
+uint64_t missing_elements_bm(xor_code_t *code_desc, int *missing_elements, uint64_t (*bit_lookup_func)(xor_code_t *code_desc, int index))
 {
   int i = 0;
-  int bm = 0;
+  uint64_t bm = 0;
 
   while (missing_elements[i] > -1) {
     bm |= bit_lookup_func(code_desc, missing_elements[i]);
@@ -127,10 +127,57 @@ failure_pattern_t get_failure_pattern(xor_code_t *code_desc, int *missing_idxs)
   return pattern; 
 }
 
+/*
+ * Copy with non-temporal stores, so the destination does not evict
+ * the working set from the cache.  The head is copied normally up to the
+ * first 16-byte aligned destination address; the source may be unaligned.
+ */
+static void stream_memcpy(char *dst, char *src, size_t size)
+{
+#ifdef INTEL_SSE2
+  size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+  size_t i;
+
+  if (head > size) {
+    head = size;
+  }
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  size -= head;
+
+  for (i = 0; i + 64 <= size; i += 64) {
+    __m128i a = _mm_loadu_si128((__m128i *)(src + i));
+    __m128i b = _mm_loadu_si128((__m128i *)(src + i + 16));
+    __m128i c = _mm_loadu_si128((__m128i *)(src + i + 32));
+    __m128i d = _mm_loadu_si128((__m128i *)(src + i + 48));
+    _mm_stream_si128((__m128i *)(dst + i), a);
+    _mm_stream_si128((__m128i *)(dst + i + 16), b);
+    _mm_stream_si128((__m128i *)(dst + i + 32), c);
+    _mm_stream_si128((__m128i *)(dst + i + 48), d);
+  }
+  for (; i + 16 <= size; i += 16) {
+    _mm_stream_si128((__m128i *)(dst + i), _mm_loadu_si128((__m128i *)(src + i)));
+  }
+  _mm_sfence();
+  memcpy(dst + i, src + i, size - i);
+#else
+  memcpy(dst, src, size);
+#endif
+}
+
+/*
+ * Copy a buffer the caller will not read back soon (reconstructed
+ * fragments, reassembled payloads).  Small copies use memcpy; large ones
+ * bypass the cache.
+ */
 void fast_memcpy(char *dst, char *src, int size)
 {
-    // Use _mm_stream_si128((__m128i*) _buf2, sum);
+  if (size < FAST_MEMCPY_NT_THRESHOLD) {
     memcpy(dst, src, size);
+  } else {
+    stream_memcpy(dst, src, size);
+  }
 }
 
 /*
@@ -177,17 +224,589 @@ void xor_bufs_and_store(char *buf1, char *buf2, int blocksize)
   }
 }
 
-void xor_code_encode(xor_code_t *code_desc, char **data, char **parity, int blocksize)
+/*
+ * XOR num_bufs source buffers together in a single pass and store
+ * the result in dst.  Unlike xor_bufs_and_store, dst is overwritten,
+ * so it is only written once and never read.
+ *
+ * Buffers must be aligned to 16-byte boundaries
+ */
+void xor_multi_bufs_and_store(char **bufs, int num_bufs, char *dst, int blocksize)
 {
+  int residual_bytes = num_unaligned_end(blocksize);
+  int fast_blocksize = blocksize > residual_bytes ? (blocksize - residual_bytes) : 0;
   int i, j;
-  
-  for (i=0; i < code_desc->k; i++) {
+
+  if (num_bufs == 0) {
+    memset(dst, 0, blocksize);
+    return;
+  }
+
+#ifdef INTEL_SSE2
+  {
+    int fast_int_blocksize = fast_blocksize / sizeof(__m128i);
+    __m128i *_dst = (__m128i*)dst;
+
+    /*
+     * Work on one 64-byte cache line at a time, so each source line
+     * is touched exactly once
+     */
+    for (i=0; i + 4 <= fast_int_blocksize; i += 4) {
+      __m128i *_src = (__m128i*)bufs[0] + i;
+      __m128i sum0 = _src[0];
+      __m128i sum1 = _src[1];
+      __m128i sum2 = _src[2];
+      __m128i sum3 = _src[3];
+      for (j=1; j < num_bufs; j++) {
+        _src = (__m128i*)bufs[j] + i;
+        sum0 = _mm_xor_si128(sum0, _src[0]);
+        sum1 = _mm_xor_si128(sum1, _src[1]);
+        sum2 = _mm_xor_si128(sum2, _src[2]);
+        sum3 = _mm_xor_si128(sum3, _src[3]);
+      }
+      _dst[i] = sum0;
+      _dst[i+1] = sum1;
+      _dst[i+2] = sum2;
+      _dst[i+3] = sum3;
+    }
+    for (; i < fast_int_blocksize; i++) {
+      __m128i sum = ((__m128i*)bufs[0])[i];
+      for (j=1; j < num_bufs; j++) {
+        sum = _mm_xor_si128(sum, ((__m128i*)bufs[j])[i]);
+      }
+      _dst[i] = sum;
+    }
+  }
+#else
+  {
+    int fast_int_blocksize = fast_blocksize / sizeof(unsigned long);
+    unsigned long *_dst = (unsigned long*)dst;
+
+    for (i=0; i < fast_int_blocksize; i++) {
+      unsigned long sum = ((unsigned long*)bufs[0])[i];
+      for (j=1; j < num_bufs; j++) {
+        sum ^= ((unsigned long*)bufs[j])[i];
+      }
+      _dst[i] = sum;
+    }
+  }
+#endif
+
+  /*
+   * XOR unaligned end of region
+   */
+  for (i=fast_blocksize; i < blocksize; i++) {
+    char sum = bufs[0][i];
+    for (j=1; j < num_bufs; j++) {
+      sum ^= bufs[j][i];
+    }
+    dst[i] = sum;
+  }
+}
+
+/*
+ * Build an encode schedule that shares partial XOR sums between parities.
+ *
+ * This is a greedy common-subexpression pass: find the pair of symbols
+ * that appears together in the most parities, replace it everywhere with
+ * a new temp symbol and repeat until no pair is shared by two or more
+ * parities.  Ties go to the lowest symbol indexes, so a given code always
+ * produces the same schedule.
+ */
+xor_schedule_t* build_xor_schedule(xor_code_t *code_desc)
+{
+  int k = code_desc->k;
+  int m = code_desc->m;
+  int max_temps = (k * m) / 2;
+  int max_syms = k + max_temps;
+  int num_syms = k;
+  xor_schedule_t *schedule = NULL;
+  char *member = NULL;
+  int a, b, i, j;
+
+  schedule = (xor_schedule_t*)calloc(1, sizeof(xor_schedule_t));
+  member = (char*)calloc(m * max_syms, sizeof(char));
+  if (NULL == schedule || NULL == member) {
+    goto error;
+  }
+  schedule->temps = malloc(sizeof(*schedule->temps) * (max_temps > 0 ? max_temps : 1));
+  if (NULL == schedule->temps) {
+    goto error;
+  }
+
+  for (j=0; j < m; j++) {
+    for (i=0; i < k; i++) {
+      member[j * max_syms + i] = is_data_in_parity(i, code_desc->parity_bms[j]);
+    }
+  }
+
+  while (num_syms < max_syms) {
+    int best_count = 1, best_a = -1, best_b = -1;
+
+    for (a=0; a < num_syms; a++) {
+      for (b=a+1; b < num_syms; b++) {
+        int count = 0;
+        for (j=0; j < m; j++) {
+          if (member[j * max_syms + a] && member[j * max_syms + b]) {
+            count++;
+          }
+        }
+        if (count > best_count) {
+          best_count = count;
+          best_a = a;
+          best_b = b;
+        }
+      }
+    }
+
+    if (best_a < 0) {
+      break;
+    }
+
+    schedule->temps[num_syms - k][0] = best_a;
+    schedule->temps[num_syms - k][1] = best_b;
+    for (j=0; j < m; j++) {
+      char *row = member + j * max_syms;
+      if (row[best_a] && row[best_b]) {
+        row[best_a] = 0;
+        row[best_b] = 0;
+        row[num_syms] = 1;
+      }
+    }
+    num_syms++;
+  }
+  schedule->num_temps = num_syms - k;
+
+  for (j=0; j < m; j++) {
+    schedule->srcs[j] = (int*)malloc(sizeof(int) * num_syms);
+    if (NULL == schedule->srcs[j]) {
+      goto error;
+    }
+    for (i=0; i < num_syms; i++) {
+      if (member[j * max_syms + i]) {
+        schedule->srcs[j][schedule->num_srcs[j]++] = i;
+      }
+    }
+  }
+
+  free(member);
+  return schedule;
+
+error:
+  free(member);
+  free_xor_schedule(schedule);
+  return NULL;
+}
+
+void free_xor_schedule(xor_schedule_t *schedule)
+{
+  int j;
+
+  if (NULL == schedule) {
+    return;
+  }
+  for (j=0; j < MAX_PARITY; j++) {
+    free(schedule->srcs[j]);
+  }
+  free(schedule->temps);
+  free(schedule);
+}
+
+static char *schedule_symbol(xor_code_t *code_desc, char **data, char *temps, int sym, int offset)
+{
+  if (sym < code_desc->k) {
+    return data[sym] + offset;
+  }
+  return temps + (sym - code_desc->k) * XOR_ENCODE_BLOCK_SIZE;
+}
+
+/*
+ * Run the encode schedule one XOR_ENCODE_BLOCK_SIZE chunk at a time, so
+ * the temps for a chunk fit in scratch and stay in cache
+ */
+static void xor_schedule_encode(xor_code_t *code_desc, xor_schedule_t *schedule, char **data, char **parity, int blocksize, char *scratch)
+{
+  char *bufs[MAX_DATA];
+  int i, j, offset;
+
+  for (offset=0; offset < blocksize; offset += XOR_ENCODE_BLOCK_SIZE) {
+    int len = blocksize - offset;
+
+    if (len > XOR_ENCODE_BLOCK_SIZE) {
+      len = XOR_ENCODE_BLOCK_SIZE;
+    }
+    for (i=0; i < schedule->num_temps; i++) {
+      bufs[0] = schedule_symbol(code_desc, data, scratch, schedule->temps[i][0], offset);
+      bufs[1] = schedule_symbol(code_desc, data, scratch, schedule->temps[i][1], offset);
+      xor_multi_bufs_and_store(bufs, 2, scratch + i * XOR_ENCODE_BLOCK_SIZE, len);
+    }
     for (j=0; j < code_desc->m; j++) {
+      for (i=0; i < schedule->num_srcs[j]; i++) {
+        bufs[i] = schedule_symbol(code_desc, data, scratch, schedule->srcs[j][i], offset);
+      }
+      xor_multi_bufs_and_store(bufs, schedule->num_srcs[j], parity[j] + offset, len);
+    }
+  }
+}
+
+/*
+ * Compute every parity from its full list of sources.  The fragments
+ * are walked in XOR_ENCODE_BLOCK_SIZE chunks, producing all m parities
+ * for a chunk before moving on, so the data chunks stay in cache while
+ * they are shared between parities.
+ *
+ * If the code has an encode schedule with shared partial sums, that is
+ * used instead; the temps need a small scratch buffer per call, since
+ * the descriptor may be shared between threads.
+ */
+void xor_code_encode(xor_code_t *code_desc, char **data, char **parity, int blocksize)
+{
+  int srcs[MAX_PARITY][MAX_DATA];
+  int num_srcs[MAX_PARITY];
+  char *bufs[MAX_DATA];
+  xor_schedule_t *schedule = code_desc->encode_schedule;
+  int i, j, offset;
+
+  if (NULL != schedule && schedule->num_temps > 0) {
+    char *scratch = NULL;
+    if (posix_memalign((void **) &scratch, MEM_ALIGN_SIZE,
+                       schedule->num_temps * XOR_ENCODE_BLOCK_SIZE) == 0) {
+      xor_schedule_encode(code_desc, schedule, data, parity, blocksize, scratch);
+      free(scratch);
+      return;
+    }
+  }
+
+  for (j=0; j < code_desc->m; j++) {
+    num_srcs[j] = 0;
+    for (i=0; i < code_desc->k; i++) {
       if (is_data_in_parity(i, code_desc->parity_bms[j])) {
-        xor_bufs_and_store(data[i], parity[j], blocksize);
+        srcs[j][num_srcs[j]++] = i;
       }
     }
   }
+
+  for (offset=0; offset < blocksize; offset += XOR_ENCODE_BLOCK_SIZE) {
+    int len = blocksize - offset;
+
+    if (len > XOR_ENCODE_BLOCK_SIZE) {
+      len = XOR_ENCODE_BLOCK_SIZE;
+    }
+    for (j=0; j < code_desc->m; j++) {
+      for (i=0; i < num_srcs[j]; i++) {
+        bufs[i] = data[srcs[j][i]] + offset;
+      }
+      xor_multi_bufs_and_store(bufs, num_srcs[j], parity[j] + offset, len);
+    }
+  }
+}
+
+/*
+ * Work out, once, how to rebuild the fragments in missing_bm as straight
+ * XOR sums.
+ *
+ * Each missing data fragment d is rebuilt from a set of available
+ * parities whose combined equation covers d and none of the other
+ * missing data; every available data fragment left in that equation is
+ * XORed back out.  All parity sets are tried and the one needing the
+ * fewest source buffers wins.  Missing parities are then re-encoded from
+ * the (now complete) data.
+ *
+ * Returns 0 on success, -1 if the pattern cannot be decoded this way.
+ */
+int build_xor_decode_plan(xor_code_t *code_desc, uint64_t missing_bm, xor_decode_plan_t *plan)
+{
+  int k = code_desc->k;
+  int m = code_desc->m;
+  uint64_t missing_data_bm = missing_bm & (((uint64_t)1 << k) - 1);
+  int avail_parity[MAX_PARITY];
+  int num_avail_parity = 0;
+  int *ops = NULL;
+  int num_ops = 0, len = 0;
+  int i, j, d;
+
+  plan->missing_bm = missing_bm;
+  plan->num_ops = 0;
+  plan->ops = NULL;
+
+  for (j=0; j < m; j++) {
+    if (!(missing_bm & ((uint64_t)1 << (k + j)))) {
+      avail_parity[num_avail_parity++] = j;
+    }
+  }
+
+  /* The subset search below is exponential in the number of parities */
+  if (num_avail_parity > 16) {
+    return -1;
+  }
+
+  ops = (int*)malloc(sizeof(int) * (k + m) * (k + m + 2));
+  if (NULL == ops) {
+    return -1;
+  }
+
+  for (d=0; d < k; d++) {
+    unsigned int best_mask = 0;
+    uint64_t best_bm = 0;
+    int best_cost = -1;
+    unsigned int mask;
+
+    if (!(missing_data_bm & ((uint64_t)1 << d))) {
+      continue;
+    }
+
+    for (mask=1; mask < (1U << num_avail_parity); mask++) {
+      uint64_t bm = 0;
+      int cost;
+      for (i=0; i < num_avail_parity; i++) {
+        if (mask & (1U << i)) {
+          bm ^= code_desc->parity_bms[avail_parity[i]];
+        }
+      }
+      if ((bm & missing_data_bm) != ((uint64_t)1 << d)) {
+        continue;
+      }
+      cost = __builtin_popcount(mask) + __builtin_popcountll(bm & ~missing_data_bm);
+      if (best_cost < 0 || cost < best_cost) {
+        best_cost = cost;
+        best_mask = mask;
+        best_bm = bm;
+      }
+    }
+
+    if (best_cost < 0) {
+      free(ops);
+      return -1;
+    }
+
+    ops[len++] = d;
+    ops[len++] = best_cost;
+    for (i=0; i < num_avail_parity; i++) {
+      if (best_mask & (1U << i)) {
+        ops[len++] = k + avail_parity[i];
+      }
+    }
+    for (i=0; i < k; i++) {
+      if ((best_bm & ~missing_data_bm) & ((uint64_t)1 << i)) {
+        ops[len++] = i;
+      }
+    }
+    num_ops++;
+  }
+
+  for (j=0; j < m; j++) {
+    if (!(missing_bm & ((uint64_t)1 << (k + j)))) {
+      continue;
+    }
+    ops[len++] = k + j;
+    ops[len++] = __builtin_popcountll(code_desc->parity_bms[j]);
+    for (i=0; i < k; i++) {
+      if (is_data_in_parity(i, code_desc->parity_bms[j])) {
+        ops[len++] = i;
+      }
+    }
+    num_ops++;
+  }
+
+  plan->num_ops = num_ops;
+  plan->ops = ops;
+  return 0;
+}
+
+static int compare_decode_plans(const void *a, const void *b)
+{
+  uint64_t bm_a = ((const xor_decode_plan_t*)a)->missing_bm;
+  uint64_t bm_b = ((const xor_decode_plan_t*)b)->missing_bm;
+
+  return (bm_a > bm_b) - (bm_a < bm_b);
+}
+
+/*
+ * Precompute a decode plan for every pattern of 1 to max_missing missing
+ * fragments, as long as there are no more than XOR_MAX_DECODE_PLANS of
+ * them.  Larger codes build their plans at decode time instead.
+ *
+ * Returns 0 on success (including when the code is too large to
+ * precompute), -1 on allocation failure.
+ */
+int init_xor_decode_plans(xor_code_t *code_desc, int max_missing)
+{
+  int n = code_desc->k + code_desc->m;
+  int num_patterns = 0;
+  int idx[MAX_FRAGMENTS];
+  int num_plans = 0;
+  int r, i;
+  xor_decode_plan_t *plans = NULL;
+
+  code_desc->num_decode_plans = 0;
+  code_desc->decode_plans = NULL;
+
+  if (n > MAX_FRAGMENTS) {
+    return 0;
+  }
+
+  for (r=1; r <= max_missing; r++) {
+    long long c = 1;
+    for (i=0; i < r; i++) {
+      c = c * (n - i) / (i + 1);
+    }
+    num_patterns += (int)c;
+    if (num_patterns > XOR_MAX_DECODE_PLANS) {
+      return 0;
+    }
+  }
+
+  plans = (xor_decode_plan_t*)malloc(sizeof(xor_decode_plan_t) * num_patterns);
+  if (NULL == plans) {
+    return -1;
+  }
+
+  /* Walk every r-combination of the n fragment indexes */
+  for (r=1; r <= max_missing && r <= n; r++) {
+    for (i=0; i < r; i++) {
+      idx[i] = i;
+    }
+    while (1) {
+      uint64_t bm = 0;
+      for (i=0; i < r; i++) {
+        bm |= ((uint64_t)1 << idx[i]);
+      }
+      if (build_xor_decode_plan(code_desc, bm, &plans[num_plans]) == 0) {
+        num_plans++;
+      }
+
+      i = r - 1;
+      while (i >= 0 && idx[i] == n - r + i) {
+        i--;
+      }
+      if (i < 0) {
+        break;
+      }
+      idx[i]++;
+      for (i=i+1; i < r; i++) {
+        idx[i] = idx[i-1] + 1;
+      }
+    }
+  }
+
+  qsort(plans, num_plans, sizeof(xor_decode_plan_t), compare_decode_plans);
+
+  code_desc->num_decode_plans = num_plans;
+  code_desc->decode_plans = plans;
+  return 0;
+}
+
+xor_decode_plan_t* lookup_xor_decode_plan(xor_code_t *code_desc, uint64_t missing_bm)
+{
+  xor_decode_plan_t key;
+
+  if (NULL == code_desc->decode_plans) {
+    return NULL;
+  }
+  key.missing_bm = missing_bm;
+  return (xor_decode_plan_t*)bsearch(&key, code_desc->decode_plans,
+                                     code_desc->num_decode_plans,
+                                     sizeof(xor_decode_plan_t),
+                                     compare_decode_plans);
+}
+
+static char *fragment_buffer(xor_code_t *code_desc, char **data, char **parity, int idx)
+{
+  return idx < code_desc->k ? data[idx] : parity[idx - code_desc->k];
+}
+
+/*
+ * Execute a decode plan one XOR_ENCODE_BLOCK_SIZE chunk at a time; the
+ * parity ops read the rebuilt data while it is still in cache.
+ */
+void run_xor_decode_plan(xor_code_t *code_desc, xor_decode_plan_t *plan, char **data, char **parity, int blocksize, int decode_parity)
+{
+  char *bufs[MAX_DATA + MAX_PARITY];
+  int offset, op, i;
+
+  for (offset=0; offset < blocksize; offset += XOR_ENCODE_BLOCK_SIZE) {
+    int len = blocksize - offset;
+    int *ops = plan->ops;
+
+    if (len > XOR_ENCODE_BLOCK_SIZE) {
+      len = XOR_ENCODE_BLOCK_SIZE;
+    }
+    for (op=0; op < plan->num_ops; op++) {
+      int dst = ops[0];
+      int num_srcs = ops[1];
+
+      if (dst < code_desc->k || decode_parity) {
+        for (i=0; i < num_srcs; i++) {
+          bufs[i] = fragment_buffer(code_desc, data, parity, ops[2 + i]) + offset;
+        }
+        xor_multi_bufs_and_store(bufs, num_srcs,
+                                 fragment_buffer(code_desc, data, parity, dst) + offset, len);
+      }
+      ops += 2 + num_srcs;
+    }
+  }
+}
+
+/*
+ * List the available fragments that a plan reads to rebuild the fragments
+ * in wanted_bm (including the inputs of any rebuilt data a wanted parity
+ * depends on).  The list is sorted and terminated with -1.
+ *
+ * Returns 0 on success, -1 if the plan does not rebuild everything wanted.
+ */
+int xor_decode_plan_fragments_needed(xor_code_t *code_desc, xor_decode_plan_t *plan, uint64_t wanted_bm, int *fragments_needed)
+{
+  uint64_t needed_bm = 0, rebuilt_bm = 0;
+  int *op_start[MAX_FRAGMENTS];
+  int *ops = plan->ops;
+  int op, i, j;
+
+  for (op=0; op < plan->num_ops; op++) {
+    op_start[op] = ops;
+    ops += 2 + ops[1];
+  }
+
+  /* Parity ops come last, so walk backwards to see their data inputs first */
+  for (op=plan->num_ops - 1; op >= 0; op--) {
+    int dst = op_start[op][0];
+    if (!((wanted_bm | needed_bm) & ((uint64_t)1 << dst))) {
+      continue;
+    }
+    rebuilt_bm |= ((uint64_t)1 << dst);
+    for (i=0; i < op_start[op][1]; i++) {
+      needed_bm |= ((uint64_t)1 << op_start[op][2 + i]);
+    }
+  }
+
+  if ((wanted_bm & rebuilt_bm) != wanted_bm) {
+    return -1;
+  }
+
+  needed_bm &= ~plan->missing_bm;
+  j = 0;
+  for (i=0; i < code_desc->k + code_desc->m; i++) {
+    if (needed_bm & ((uint64_t)1 << i)) {
+      fragments_needed[j++] = i;
+    }
+  }
+  fragments_needed[j] = -1;
+
+  return 0;
+}
+
+void free_xor_decode_plans(xor_code_t *code_desc)
+{
+  int i;
+
+  if (NULL == code_desc->decode_plans) {
+    return;
+  }
+  for (i=0; i < code_desc->num_decode_plans; i++) {
+    free(code_desc->decode_plans[i].ops);
+  }
+  free(code_desc->decode_plans);
+  code_desc->decode_plans = NULL;
+  code_desc->num_decode_plans = 0;
 }
 
 void selective_encode(xor_code_t *code_desc, char **data, char **parity, int *missing_parity, int blocksize)
@@ -205,6 +824,21 @@ void selective_encode(xor_code_t *code_desc, char **data, char **parity, int *mi
   }
 }
 
+/*
+ * Fold a change to one data element into the parities: delta is the XOR
+ * of the old and new contents of data[data_idx]
+ */
+void xor_code_encode_update(xor_code_t *code_desc, int data_idx, char *delta, char **parity, int blocksize)
+{
+  int i;
+
+  for (i=0; i < code_desc->m; i++) {
+    if (is_data_in_parity(data_idx, code_desc->parity_bms[i])) {
+      xor_bufs_and_store(delta, parity[i], blocksize);
+    }
+  }
+}
+
 int * get_missing_parity(xor_code_t *code_desc, int *missing_idxs)
 {
   int *missing_parity = (int*)malloc(sizeof(int)*MAX_PARITY);
@@ -259,12 +893,12 @@ void xor_reconstruct_one(xor_code_t *code_desc, char **data, char **parity, int
     if (connected_parity_idx >= 0) {
       // Can do a cheap reoncstruction!
       int relative_parity_idx = connected_parity_idx - code_desc->k;
-      int parity_bm = code_desc->parity_bms[relative_parity_idx];
+      uint64_t parity_bm = code_desc->parity_bms[relative_parity_idx];
 
       fast_memcpy(data[index_to_reconstruct], parity[relative_parity_idx], blocksize);
 
       for (i=0; i < code_desc->k; i++) {
-        if (parity_bm & (1 << i)) {
+        if (is_data_in_parity(i, parity_bm)) {
           if (i != index_to_reconstruct) {
             xor_bufs_and_store(data[i], data[index_to_reconstruct], blocksize);
           }
@@ -287,12 +921,12 @@ void xor_reconstruct_one(xor_code_t *code_desc, char **data, char **parity, int
 
     if (num_data_missing == 0) {
       int relative_parity_idx = index_to_reconstruct - code_desc->k;
-      int parity_bm = code_desc->parity_bms[relative_parity_idx];   
+      uint64_t parity_bm = code_desc->parity_bms[relative_parity_idx];
 
       memset(parity[relative_parity_idx], 0, blocksize);
       
       for (i=0; i < code_desc->k; i++) {
-        if (parity_bm & (1 << i)) {
+        if (is_data_in_parity(i, parity_bm)) {
           xor_bufs_and_store(data[i], parity[relative_parity_idx], blocksize);
         }
       }
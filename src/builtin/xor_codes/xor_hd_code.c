@@ -31,7 +31,7 @@
 /*
  * Returns -1 if not possible
  */
-static int fragments_needed_one_data(xor_code_t *code_desc, int *missing_data, int *missing_parity, unsigned int *data_bm, unsigned int *parity_bm)
+static int fragments_needed_one_data(xor_code_t *code_desc, int *missing_data, int *missing_parity, uint64_t *data_bm, unsigned int *parity_bm)
 {
   int data_index = missing_data[0];
   int parity_index = index_of_connected_parity(code_desc, data_index, missing_parity, missing_data);
@@ -45,7 +45,7 @@ static int fragments_needed_one_data(xor_code_t *code_desc, int *missing_data, i
 
   // Include this parity element
   *parity_bm |= (1 << (parity_index-code_desc->k));
-  *data_bm &= ~((unsigned int)1 << data_index);
+  *data_bm &= ~((uint64_t)1 << data_index);
 
   return 0;
 }
@@ -53,7 +53,7 @@ static int fragments_needed_one_data(xor_code_t *code_desc, int *missing_data, i
 /*
  * Returns -1 if not possible
  */
-static int fragments_needed_two_data(xor_code_t *code_desc, int *missing_data, int *missing_parity, unsigned int *data_bm, unsigned int *parity_bm)
+static int fragments_needed_two_data(xor_code_t *code_desc, int *missing_data, int *missing_parity, uint64_t *data_bm, unsigned int *parity_bm)
 {
   // Verify that missing_data[2] == -1?
   int data_index = missing_data[0];
@@ -80,7 +80,7 @@ static int fragments_needed_two_data(xor_code_t *code_desc, int *missing_data, i
 
   ret = fragments_needed_one_data(code_desc, missing_data, missing_parity, data_bm, parity_bm);
 
-  *data_bm &= ~((unsigned int)1 << data_index);
+  *data_bm &= ~((uint64_t)1 << data_index);
   
   return ret;
 }
@@ -88,12 +88,12 @@ static int fragments_needed_two_data(xor_code_t *code_desc, int *missing_data, i
 /*
  * Returns -1 if not possible
  */
-static int fragments_needed_three_data(xor_code_t *code_desc, int *missing_data, int *missing_parity, unsigned int *data_bm, unsigned int *parity_bm)
+static int fragments_needed_three_data(xor_code_t *code_desc, int *missing_data, int *missing_parity, uint64_t *data_bm, unsigned int *parity_bm)
 {
   int i = 0;
   int parity_index = -1;
   int data_index = -1;
-  int tmp_parity_bm = -1;
+  uint64_t tmp_parity_bm = 0;
   int contains_2d = -1;
   int contains_3d = -1;
   int ret = 0;
@@ -156,19 +156,19 @@ static int fragments_needed_three_data(xor_code_t *code_desc, int *missing_data,
   remove_from_missing_list(data_index, missing_data);
 
   // Include all data elements except for this one
-  *data_bm |= (code_desc->parity_bms[parity_index-code_desc->k]);
+  *data_bm |= tmp_parity_bm;
 
   // Include this parity element
   if (parity_index > -1) {
     *parity_bm |= (1 << (parity_index-code_desc->k));
   } else {
-    *parity_bm |= (1 << (contains_2d-code_desc->k));
-    *parity_bm |= (1 << (contains_3d-code_desc->k));
+    *parity_bm |= (1 << contains_2d);
+    *parity_bm |= (1 << contains_3d);
   }
 
   ret = fragments_needed_two_data(code_desc, missing_data, missing_parity, data_bm, parity_bm);
   
-  *data_bm &= ~((unsigned int)1 << data_index);
+  *data_bm &= ~((uint64_t)1 << data_index);
 
   return ret;
 }
@@ -176,7 +176,7 @@ static int fragments_needed_three_data(xor_code_t *code_desc, int *missing_data,
 static int fragments_needed_one_data_local(xor_code_t *code_desc, 
                                            int fragment_to_reconstruct,
                                            int *fragments_to_exclude,
-                                           unsigned int *data_bm, 
+                                           uint64_t *data_bm, 
                                            unsigned int *parity_bm)
 {
   int *missing_data = get_missing_data(code_desc, fragments_to_exclude);
@@ -194,7 +194,7 @@ static int fragments_needed_one_data_local(xor_code_t *code_desc,
 
   // Include this parity element
   *parity_bm |= (1 << (parity_index-code_desc->k));
-  *data_bm &= ~((unsigned int)1 << fragment_to_reconstruct);
+  *data_bm &= ~((uint64_t)1 << fragment_to_reconstruct);
 
   return 0;
 }
@@ -202,7 +202,8 @@ static int fragments_needed_one_data_local(xor_code_t *code_desc,
 int xor_hd_fragments_needed(xor_code_t *code_desc, int *fragments_to_reconstruct, int *fragments_to_exclude, int *fragments_needed)
 {
   failure_pattern_t pattern = get_failure_pattern(code_desc, fragments_to_reconstruct);
-  unsigned int data_bm = 0, parity_bm = 0;
+  uint64_t data_bm = 0;
+  unsigned int parity_bm = 0;
   int ret = -1;
   int *missing_idxs = NULL;
   int i, j;
@@ -280,7 +281,7 @@ int xor_hd_fragments_needed(xor_code_t *code_desc, int *fragments_to_reconstruct
 	    {
 	      int *missing_data = get_missing_data(code_desc, missing_idxs);
 	      int *missing_parity = get_missing_parity(code_desc, missing_idxs);
-	      unsigned int missing_data_bm = missing_elements_bm(code_desc, missing_data, data_bit_lookup);
+	      uint64_t missing_data_bm = missing_elements_bm(code_desc, missing_data, data_bit_lookup);
 	      ret = fragments_needed_one_data(code_desc, missing_data, missing_parity, &data_bm, &parity_bm);
 	      // OR all parities
 	      i=0;
@@ -297,7 +298,7 @@ int xor_hd_fragments_needed(xor_code_t *code_desc, int *fragments_to_reconstruct
 	    {
 	      int *missing_data = get_missing_data(code_desc, missing_idxs);
 	      int *missing_parity = get_missing_parity(code_desc, missing_idxs);
-	      int missing_data_bm = missing_elements_bm(code_desc, missing_data, data_bit_lookup);
+	      uint64_t missing_data_bm = missing_elements_bm(code_desc, missing_data, data_bit_lookup);
 	      ret = fragments_needed_one_data(code_desc, missing_data, missing_parity, &data_bm, &parity_bm);
 	      // OR all parities
 	      i=0;
@@ -314,7 +315,7 @@ int xor_hd_fragments_needed(xor_code_t *code_desc, int *fragments_to_reconstruct
 	    {
 	      int *missing_data = get_missing_data(code_desc, missing_idxs);
 	      int *missing_parity = get_missing_parity(code_desc, missing_idxs);
-	      unsigned int missing_data_bm = missing_elements_bm(code_desc, missing_data, data_bit_lookup);
+	      uint64_t missing_data_bm = missing_elements_bm(code_desc, missing_data, data_bit_lookup);
 	      ret = fragments_needed_two_data(code_desc, missing_data, missing_parity, &data_bm, &parity_bm);
 	      // OR all parities
 	      i=0;
@@ -372,6 +373,38 @@ int xor_hd_fragments_needed(xor_code_t *code_desc, int *fragments_to_reconstruct
 	  }
   }
 
+  /*
+   * The pattern-based search above only knows the goldilocks codes; fall
+   * back to the decode plan for anything it cannot handle
+   */
+  if (ret < 0 && NULL != missing_idxs) {
+    xor_decode_plan_t tmp_plan;
+    xor_decode_plan_t *plan = NULL;
+    uint64_t missing_bm = 0, wanted_bm = 0;
+    int num_missing = 0;
+
+    for (i=0; missing_idxs[i] > -1; i++) {
+      if (!(missing_bm & ((uint64_t)1 << missing_idxs[i]))) {
+        missing_bm |= ((uint64_t)1 << missing_idxs[i]);
+        num_missing++;
+      }
+    }
+    for (i=0; fragments_to_reconstruct[i] > -1; i++) {
+      wanted_bm |= ((uint64_t)1 << fragments_to_reconstruct[i]);
+    }
+
+    if (num_missing < code_desc->hd) {
+      plan = lookup_xor_decode_plan(code_desc, missing_bm);
+      if (NULL == plan && build_xor_decode_plan(code_desc, missing_bm, &tmp_plan) == 0) {
+        ret = xor_decode_plan_fragments_needed(code_desc, &tmp_plan, wanted_bm, fragments_needed);
+        free(tmp_plan.ops);
+      } else if (NULL != plan) {
+        ret = xor_decode_plan_fragments_needed(code_desc, plan, wanted_bm, fragments_needed);
+      }
+    }
+    goto out;
+  }
+
   if (ret >= 0) {
 	  i=0;
 	  j=0;
@@ -464,7 +497,7 @@ static int decode_three_data(xor_code_t *code_desc, char **data, char **parity,
   int i = 0;
   int parity_index = -1;
   int data_index = -1;
-  unsigned int parity_bm = -1;
+  uint64_t parity_bm = 0;
   char *parity_buffer = NULL;
 
   /*
@@ -559,7 +592,39 @@ static int decode_three_data(xor_code_t *code_desc, char **data, char **parity,
 int xor_hd_decode(xor_code_t *code_desc, char **data, char **parity, int *missing_idxs, int blocksize, int decode_parity)
 {
   int ret = 0;
-  failure_pattern_t pattern = get_failure_pattern(code_desc, missing_idxs);
+  failure_pattern_t pattern;
+  uint64_t missing_bm = 0;
+  int num_missing = 0;
+  int i;
+
+  for (i=0; missing_idxs[i] > -1; i++) {
+    if (!(missing_bm & (1ULL << missing_idxs[i]))) {
+      missing_bm |= (1ULL << missing_idxs[i]);
+      num_missing++;
+    }
+  }
+
+  /*
+   * Use a cached (or freshly built) decode plan when there is one;
+   * otherwise fall through to the pattern-based decoder
+   */
+  if (num_missing > 0 && num_missing < code_desc->hd) {
+    xor_decode_plan_t *plan = lookup_xor_decode_plan(code_desc, missing_bm);
+    if (NULL != plan) {
+      run_xor_decode_plan(code_desc, plan, data, parity, blocksize, decode_parity);
+      return 0;
+    }
+    if (NULL == code_desc->decode_plans) {
+      xor_decode_plan_t tmp_plan;
+      if (build_xor_decode_plan(code_desc, missing_bm, &tmp_plan) == 0) {
+        run_xor_decode_plan(code_desc, &tmp_plan, data, parity, blocksize, decode_parity);
+        free(tmp_plan.ops);
+        return 0;
+      }
+    }
+  }
+
+  pattern = get_failure_pattern(code_desc, missing_idxs);
 
   switch(pattern) {
     case FAIL_PATTERN_0D_0P: 
@@ -654,6 +719,8 @@ xor_code_t* init_xor_hd_code(int k, int m, int hd)
 {
   xor_code_t *code_desc = NULL;
   int is_valid = 0;
+  int is_generated = 0;
+  int i, j;
 
   if (hd == 3) {
     if (m == 6) {
@@ -681,18 +748,60 @@ xor_code_t* init_xor_hd_code(int k, int m, int hd)
     }
   }
 
+  /*
+   * Anything the hand-made and goldilocks tables do not cover comes from
+   * the generated tables, up to k + m = MAX_FRAGMENTS
+   */
+  if (!is_valid && (hd == 3 || hd == 4) && m >= 5 && m <= 7 && k >= m) {
+    if (k <= GEN_MAX_K(m, hd)) {
+      is_valid = 1;
+      is_generated = 1;
+    }
+  }
+
   if (is_valid) {
-    code_desc = (xor_code_t*)malloc(sizeof(xor_code_t));
-    code_desc->parity_bms = PARITY_BM_ARY(k, m, hd);
-    code_desc->data_bms = DATA_BM_ARY(k, m, hd);
+    /* Generated codes keep their parity bitmaps right after the descriptor */
+    code_desc = (xor_code_t*)malloc(sizeof(xor_code_t) + (is_generated ? m * sizeof(uint64_t) : 0));
+    if (NULL == code_desc) {
+      return NULL;
+    }
+    if (is_generated) {
+      code_desc->data_bms = GEN_DATA_BM_ARY(m, hd);
+      code_desc->parity_bms = (uint64_t*)(code_desc + 1);
+      for (j=0; j < m; j++) {
+        code_desc->parity_bms[j] = 0;
+        for (i=0; i < k; i++) {
+          if (does_parity_have_data(j, code_desc->data_bms[i])) {
+            code_desc->parity_bms[j] |= ((uint64_t)1 << i);
+          }
+        }
+      }
+    } else {
+      code_desc->parity_bms = PARITY_BM_ARY(k, m, hd);
+      code_desc->data_bms = DATA_BM_ARY(k, m, hd);
+    }
     code_desc->k = k;
     code_desc->m = m;
     code_desc->hd = hd;
     code_desc->decode = xor_hd_decode;
     code_desc->encode = xor_code_encode;
     code_desc->fragments_needed = xor_hd_fragments_needed;
+    /* Encode falls back to the direct sums if this fails */
+    code_desc->encode_schedule = build_xor_schedule(code_desc);
+    /* Likewise, decode builds plans on demand without the cache */
+    init_xor_decode_plans(code_desc, hd - 1);
   }
 
   return code_desc;
 }
 
+void free_xor_hd_code(xor_code_t *code_desc)
+{
+  if (NULL == code_desc) {
+    return;
+  }
+  free_xor_schedule(code_desc->encode_schedule);
+  free_xor_decode_plans(code_desc);
+  free(code_desc);
+}
+
@@ -27,7 +27,7 @@
  */
 
 #include <assert.h>
-#include <zlib.h>
+#include <limits.h>
 #include "list.h"
 #include "erasurecode.h"
 #include "erasurecode_backend.h"
@@ -36,8 +36,13 @@
 #include "erasurecode_preprocessing.h"
 #include "erasurecode_postprocessing.h"
 #include "erasurecode_stdinc.h"
+#include "erasurecode_threadpool.h"
 
 #include "alg_sig.h"
+#include "crc32c.h"
+#include "md5_private.h"
+#include "md5_mb.h"
+#include "xxh3.h"
 #include "erasurecode_log.h"
 
 /* =~=*=~==~=*=~==~=*=~= Supported EC backends =~=*=~==~=*=~==~=*=~==~=*=~== */
@@ -72,44 +77,194 @@ char *ec_backends_supported_str[EC_BACKENDS_MAX];
 
 /* =~=*=~==~=*=~==~=*=~= EC backend instance management =~=*=~==~=*=~==~=*= */
 
-/* Registered erasure code backend instances */
-SLIST_HEAD(backend_list, ec_backend) active_instances =
-    SLIST_HEAD_INITIALIZER(active_instances);
+/*
+ * Registered erasure code backend instances
+ *
+ * A descriptor is (generation << INSTANCE_SLOT_BITS) | slot.  Slots live
+ * in chunks that are allocated on demand and never freed, so looking one
+ * up is a couple of loads with no lock, and a reader may always touch the
+ * refcount of the slot its descriptor names, even while that instance is
+ * being destroyed.  The generation, bumped every time a slot is reused,
+ * keeps stale descriptors from reaching a newer instance.
+ *
+ * Free slots are handed out round-robin over the allocated chunks, so a
+ * slot is only reused once every other free slot has been, and a
+ * descriptor can only come back after INSTANCE_MAX_GEN reuses of its
+ * slot: at least INSTANCE_MAX_GEN * INSTANCE_CHUNK_SIZE (about 8.4M)
+ * instance creations, and 256 times that once every chunk is allocated.
+ *
+ * Readers take a reference by incrementing the slot's refcount and then
+ * checking that the slot still holds their descriptor.  Destroy unpublishes
+ * the slot first and then sleeps until its refcount drains before the
+ * instance is torn down, so an instance is never freed under a caller.
+ * Whoever drops the last reference of a draining slot wakes it.
+ */
+#define INSTANCE_SLOT_BITS      16
+#define INSTANCE_CHUNK_BITS     8
+#define INSTANCE_CHUNK_SIZE     (1 << INSTANCE_CHUNK_BITS)
+#define INSTANCE_NUM_CHUNKS     (1 << (INSTANCE_SLOT_BITS - INSTANCE_CHUNK_BITS))
+#define INSTANCE_MAX_GEN        ((INT_MAX >> INSTANCE_SLOT_BITS) - 1)
+
+struct instance_slot {
+    ec_backend_t instance;      /* NULL when the slot is free */
+    int desc;                   /* descriptor of the current instance */
+    int refs;                   /* callers currently using this slot */
+    int gen;                    /* generation of the last descriptor */
+    int draining;               /* destroy is waiting for refs to drain */
+    /* keep busy slots used from different threads off each other's lines */
+    char pad[64 - sizeof(ec_backend_t) - 4 * sizeof(int)];
+};
+
+static struct instance_slot *active_instances[INSTANCE_NUM_CHUNKS];
+
+/* Both under active_instances_rwlock */
+static int num_instance_chunks;     /* chunks allocated so far */
+static int next_instance_slot;      /* where the next free slot search starts */
+
+/* Serializes instance registration and removal; lookups do not take it */
 rwlock_t active_instances_rwlock = RWLOCK_INITIALIZER;
 
-/* Backend instance id */
-int next_backend_desc = 0;
+/* Destroys wait here for the references to their slot to drain */
+static pthread_mutex_t instance_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t instance_drain_cv = PTHREAD_COND_INITIALIZER;
+
+static struct instance_slot *instance_slot_get(int desc)
+{
+    struct instance_slot *chunk;
+    int slot;
+
+    if (desc <= 0) {
+        return NULL;
+    }
+    slot = desc & ((1 << INSTANCE_SLOT_BITS) - 1);
+    chunk = __atomic_load_n(&active_instances[slot >> INSTANCE_CHUNK_BITS],
+                            __ATOMIC_ACQUIRE);
+    if (NULL == chunk) {
+        return NULL;
+    }
+    return &chunk[slot & (INSTANCE_CHUNK_SIZE - 1)];
+}
+
+static void instance_slot_unref(struct instance_slot *s)
+{
+    /* Pairs with setting draining before the refcount check on destroy */
+    if (__atomic_sub_fetch(&s->refs, 1, __ATOMIC_SEQ_CST) == 0 &&
+        __atomic_load_n(&s->draining, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&instance_drain_lock);
+        pthread_cond_broadcast(&instance_drain_cv);
+        pthread_mutex_unlock(&instance_drain_lock);
+    }
+}
 
 /**
  * Look up a backend instance by descriptor
  *
  * @returns pointer to a registered liberasurecode instance
- * The caller must hold active_instances_rwlock
+ * No reference is taken: the caller must already hold one (see
+ * liberasurecode_backend_instance_get()) to keep using the instance
  */
 ec_backend_t liberasurecode_backend_instance_get_by_desc(int desc)
 {
-    struct ec_backend *b = NULL;
-    SLIST_FOREACH(b, &active_instances, link) {
-        if (b->idesc == desc)
-            break;
+    struct instance_slot *s = instance_slot_get(desc);
+    ec_backend_t instance;
+
+    if (NULL == s) {
+        return NULL;
     }
-    return b;
+    instance = __atomic_load_n(&s->instance, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&s->desc, __ATOMIC_RELAXED) != desc) {
+        return NULL;
+    }
+    return instance;
+}
+
+/**
+ * Look up a backend instance by descriptor and take a reference on it
+ *
+ * The instance cannot be destroyed until the reference is dropped with
+ * liberasurecode_backend_instance_put().
+ *
+ * @returns pointer to a registered liberasurecode instance, or NULL
+ */
+ec_backend_t liberasurecode_backend_instance_get(int desc)
+{
+    struct instance_slot *s = instance_slot_get(desc);
+    ec_backend_t instance;
+
+    if (NULL == s) {
+        return NULL;
+    }
+    /* Pairs with the unpublish-then-drain in instance_destroy */
+    __atomic_add_fetch(&s->refs, 1, __ATOMIC_SEQ_CST);
+    instance = __atomic_load_n(&s->instance, __ATOMIC_SEQ_CST);
+    if (NULL == instance ||
+        __atomic_load_n(&s->desc, __ATOMIC_RELAXED) != desc) {
+        instance_slot_unref(s);
+        return NULL;
+    }
+    return instance;
+}
+
+/**
+ * Drop a reference taken by liberasurecode_backend_instance_get()
+ */
+void liberasurecode_backend_instance_put(ec_backend_t instance)
+{
+    struct instance_slot *s;
+
+    if (NULL == instance) {
+        return;
+    }
+    s = instance_slot_get(instance->idesc);
+    instance_slot_unref(s);
 }
 
 /**
  * Allocated backend instance descriptor
  *
- * Returns a unique descriptor for a new backend.
+ * Returns a unique descriptor for a new backend, from the next free slot
+ * after the last one handed out, or -ENOMEM when all slots are in use.
+ * A new chunk is only allocated once every allocated slot is busy.
  * The caller must hold active_instances_rwlock
  */
 int liberasurecode_backend_alloc_desc(void)
 {
-    for (;;) {
-        if (++next_backend_desc <= 0)
-            next_backend_desc = 1;
-        if (!liberasurecode_backend_instance_get_by_desc(next_backend_desc))
-            return next_backend_desc;
+    struct instance_slot *chunk;
+    int num_slots = num_instance_chunks * INSTANCE_CHUNK_SIZE;
+    int i, slot;
+
+    for (i = 0; i < num_slots; i++) {
+        struct instance_slot *s;
+
+        slot = (next_instance_slot + i) % num_slots;
+        s = &active_instances[slot >> INSTANCE_CHUNK_BITS]
+                             [slot & (INSTANCE_CHUNK_SIZE - 1)];
+        /* skip slots still in use, or still draining after a destroy */
+        if (NULL != s->instance ||
+            __atomic_load_n(&s->refs, __ATOMIC_ACQUIRE) != 0 ||
+            __atomic_load_n(&s->draining, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        if (++s->gen > INSTANCE_MAX_GEN) {
+            s->gen = 1;
+        }
+        next_instance_slot = slot + 1;
+        return (s->gen << INSTANCE_SLOT_BITS) | slot;
+    }
+
+    if (num_instance_chunks == INSTANCE_NUM_CHUNKS) {
+        return -ENOMEM;
+    }
+    chunk = calloc(INSTANCE_CHUNK_SIZE, sizeof(*chunk));
+    if (NULL == chunk) {
+        return -ENOMEM;
     }
+    __atomic_store_n(&active_instances[num_instance_chunks], chunk,
+                     __ATOMIC_RELEASE);
+    slot = num_instance_chunks++ << INSTANCE_CHUNK_BITS;
+    chunk[0].gen = 1;
+    next_instance_slot = slot + 1;
+    return (chunk[0].gen << INSTANCE_SLOT_BITS) | slot;
 }
 
 /**
@@ -123,14 +278,17 @@ int liberasurecode_backend_instance_register(ec_backend_t instance)
 {
     int desc = -1;  /* descriptor to return */
     int rc = 0;     /* return call value */
+    struct instance_slot *s;
 
     rc = rwlock_wrlock(&active_instances_rwlock);
     if (rc == 0) {
-        SLIST_INSERT_HEAD(&active_instances, instance, link);
         desc = liberasurecode_backend_alloc_desc();
         if (desc <= 0)
             goto register_out;
         instance->idesc = desc;
+        s = instance_slot_get(desc);
+        __atomic_store_n(&s->desc, desc, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->instance, instance, __ATOMIC_RELEASE);
     } else {
         goto exit;
     }
@@ -144,20 +302,41 @@ exit:
 /**
  * Unregister a backend instance
  *
+ * The caller must hold a reference on instance, which is dropped here.
+ * Once every other reference is dropped too, this returns and the
+ * instance can be torn down.
+ *
  * @returns 0 on success, non-0 on error
  */
 int liberasurecode_backend_instance_unregister(ec_backend_t instance)
 {
     int rc = 0;  /* return call value */
+    struct instance_slot *s = instance_slot_get(instance->idesc);
 
     rc = rwlock_wrlock(&active_instances_rwlock);
     if (rc == 0) {
-        SLIST_REMOVE(&active_instances, instance, ec_backend, link);
+        if (s->instance != instance) {
+            /* somebody else is destroying it */
+            rwlock_unlock(&active_instances_rwlock);
+            liberasurecode_backend_instance_put(instance);
+            return -EBACKENDNOTAVAIL;
+        }
+        __atomic_store_n(&s->instance, NULL, __ATOMIC_SEQ_CST);
     }  else {
+        liberasurecode_backend_instance_put(instance);
         goto exit;
     }
+    __atomic_store_n(&s->draining, 1, __ATOMIC_SEQ_CST);
     rwlock_unlock(&active_instances_rwlock);
 
+    liberasurecode_backend_instance_put(instance);
+    pthread_mutex_lock(&instance_drain_lock);
+    while (__atomic_load_n(&s->refs, __ATOMIC_SEQ_CST) != 0) {
+        pthread_cond_wait(&instance_drain_cv, &instance_drain_lock);
+    }
+    pthread_mutex_unlock(&instance_drain_lock);
+    __atomic_store_n(&s->draining, 0, __ATOMIC_RELEASE);
+
 exit:
     return rc;
 }
@@ -217,6 +396,8 @@ liberasurecode_exit(void) {
     int i;
     for (i = 0; i < num_supported_backends; ++i)
         free(ec_backends_supported_str[i]);
+    for (i = 0; i < INSTANCE_NUM_CHUNKS; ++i)
+        free(active_instances[i]);
     closelog();
 }
 
@@ -312,8 +493,18 @@ int liberasurecode_instance_create(const ec_backend_id_t id,
         return -EBACKENDINITERR;
     }
 
+    pthread_mutex_init(&instance->pool_lock, NULL);
+
     /* Register instance and return a descriptor/instance id */
     instance->idesc = liberasurecode_backend_instance_register(instance);
+    if (instance->idesc <= 0) {
+        int rc = instance->idesc;
+        instance->common.ops->exit(instance->desc.backend_desc);
+        liberasurecode_backend_close(instance);
+        pthread_mutex_destroy(&instance->pool_lock);
+        free(instance);
+        return rc < 0 ? rc : -ENOMEM;
+    }
 
     return instance->idesc;
 }
@@ -328,25 +519,105 @@ int liberasurecode_instance_destroy(int desc)
     ec_backend_t instance = NULL;  /* instance to destroy */
     int rc = 0;                    /* return code */
 
-    instance = liberasurecode_backend_instance_get_by_desc(desc);
+    instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance)
         return -EBACKENDNOTAVAIL;
 
+    /*
+     * Remove instance from registry first, which waits out any encode,
+     * decode etc. still running on it
+     */
+    rc = liberasurecode_backend_instance_unregister(instance);
+    if (rc != 0) {
+        return rc;
+    }
+
     /* Call private exit() for the backend */
     instance->common.ops->exit(instance->desc.backend_desc);
 
     /* dlclose() backend library */
     liberasurecode_backend_close(instance);
 
-    /* Remove instance from registry */
-    rc = liberasurecode_backend_instance_unregister(instance);
-    if (rc == 0) {
-        free(instance);
-    }
+    ec_thread_pool_unref(instance->pool);
+    pthread_mutex_destroy(&instance->pool_lock);
+    free(instance);
 
     return rc;
 }
 
+/**
+ * Split large stripes over several threads
+ *
+ * @param desc - liberasurecode descriptor/handle
+ * @param num_threads - threads to use per stripe, including the calling
+ *        one; 0 or 1 to go back to single-threaded
+ * @param min_split_size - smallest range per thread in bytes, or 0 for
+ *        LIBERASURECODE_MIN_SPLIT_SIZE
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_instance_set_threads(int desc, int num_threads,
+        int min_split_size)
+{
+    ec_thread_pool_t pool = NULL, old_pool;
+    ec_backend_t instance;
+
+    if (num_threads < 0 || num_threads > EC_THREAD_POOL_MAX_THREADS ||
+        min_split_size < 0) {
+        log_error("Invalid thread count %d or split size %d",
+                  num_threads, min_split_size);
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    if (num_threads > 1) {
+        pool = ec_thread_pool_create(num_threads);
+        if (NULL == pool) {
+            log_error("Could not start %d threads", num_threads);
+            liberasurecode_backend_instance_put(instance);
+            return -ENOMEM;
+        }
+    }
+
+    /*
+     * Calls already running hold their own reference on the old pool, so
+     * its workers are only stopped once the last of them is done with it
+     */
+    pthread_mutex_lock(&instance->pool_lock);
+    old_pool = instance->pool;
+    instance->pool = pool;
+    instance->min_split_size = min_split_size > 0 ?
+        min_split_size : LIBERASURECODE_MIN_SPLIT_SIZE;
+    pthread_mutex_unlock(&instance->pool_lock);
+    ec_thread_pool_unref(old_pool);
+
+    liberasurecode_backend_instance_put(instance);
+    return 0;
+}
+
+/*
+ * Take a reference on the instance's thread pool (NULL if it has none)
+ * along with the matching split size; drop it with ec_thread_pool_unref()
+ */
+static ec_thread_pool_t instance_pool_get(ec_backend_t instance,
+        int *min_split_size)
+{
+    ec_thread_pool_t pool;
+
+    pthread_mutex_lock(&instance->pool_lock);
+    pool = instance->pool;
+    if (NULL != pool) {
+        ec_thread_pool_ref(pool);
+    }
+    *min_split_size = instance->min_split_size;
+    pthread_mutex_unlock(&instance->pool_lock);
+    return pool;
+}
+
 /**
  * Cleanup structures allocated by librasurecode_encode
  *
@@ -368,13 +639,14 @@ int liberasurecode_encode_cleanup(int desc,
 {
     int i, k, m;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         return -EBACKENDNOTAVAIL;
     }
 
     k = instance->args.uargs.k;
     m = instance->args.uargs.m;
+    liberasurecode_backend_instance_put(instance);
 
     if (encoded_data) {
         for (i = 0; i < k; i++) {
@@ -394,31 +666,294 @@ int liberasurecode_encode_cleanup(int desc,
     return 0;
 }
 
-/**
- * Erasure encode a data buffer
- *
- * @param desc - liberasurecode descriptor/handle
- *        from liberasurecode_instance_create()
- * @param orig_data - data to encode
- * @param orig_data_size - length of data to encode
- * @param encoded_data - pointer to _output_ array (char **) of k data
- *        fragments (char *), allocated by the callee
- * @param encoded_parity - pointer to _output_ array (char **) of m parity
- *        fragments (char *), allocated by the callee
- * @param fragment_len - pointer to _output_ length of each fragment, assuming
- *        all fragments are the same length
- *
- * @return 0 on success, -error code otherwise
+/*
+ * Backends whose encode works column by column with no block-wide layout,
+ * so that encoding a stripe one piece at a time gives the same parity
  */
-int liberasurecode_encode(int desc,
-        const char *orig_data, uint64_t orig_data_size, /* input */
-        char ***encoded_data, char ***encoded_parity,   /* output */
-        uint64_t *fragment_len)                         /* output */
+static int is_chunkable_backend(ec_backend_id_t id)
+{
+    switch (id) {
+        case EC_BACKEND_JERASURE_RS_VAND:
+        case EC_BACKEND_FLAT_XOR_HD:
+        case EC_BACKEND_ISA_L_RS_VAND:
+        case EC_BACKEND_LIBERASURECODE_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_CAUCHY:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Encode in ENCODE_CHKSUM_CHUNK_SIZE pieces and checksum each piece of
+ * parity as soon as it is produced; the parity checksums are accumulated
+ * in chksums[k..k+m-1], which must start out zeroed
+ */
+static int encode_with_chksums(ec_backend_t instance, int k, int m,
+        char **data, char **parity, int blocksize, uint32_t *chksums)
+{
+    ec_checksum_type_t ct = instance->args.uargs.ct;
+    char *data_chunks[EC_MAX_FRAGMENTS];
+    char *parity_chunks[EC_MAX_FRAGMENTS];
+    int offset, i, ret;
+
+    for (offset = 0; offset < blocksize; offset += ENCODE_CHKSUM_CHUNK_SIZE) {
+        int len = blocksize - offset;
+        if (len > ENCODE_CHKSUM_CHUNK_SIZE) {
+            len = ENCODE_CHKSUM_CHUNK_SIZE;
+        }
+
+        for (i = 0; i < k; i++) {
+            data_chunks[i] = data[i] + offset;
+        }
+        for (i = 0; i < m; i++) {
+            parity_chunks[i] = parity[i] + offset;
+        }
+
+        ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                           data_chunks, parity_chunks, len);
+        if (ret < 0) {
+            return ret;
+        }
+
+        for (i = 0; i < m; i++) {
+            chksums[k + i] = update_checksum(ct, chksums[k + i],
+                                             parity_chunks[i], len);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * How many column ranges to cut a blocksize-byte stripe into for the
+ * instance's thread pool, and how long each one is (the last may be
+ * shorter); returns 1 when the stripe should be handled inline.  For more
+ * than one range, *pool is set to a reference on the pool to run them on.
+ */
+static int get_column_ranges(ec_backend_t instance, int blocksize,
+        int *range_len, ec_thread_pool_t *pool)
+{
+    int num_ranges, min_split_size;
+
+    *pool = instance_pool_get(instance, &min_split_size);
+    if (NULL == *pool || blocksize < 2 * min_split_size) {
+        ec_thread_pool_unref(*pool);
+        *pool = NULL;
+        *range_len = blocksize;
+        return 1;
+    }
+
+    num_ranges = blocksize / min_split_size;
+    if (num_ranges > ec_thread_pool_size(*pool)) {
+        num_ranges = ec_thread_pool_size(*pool);
+    }
+    /* Keep range boundaries where a serial chunked encode would cut */
+    *range_len = (blocksize + num_ranges - 1) / num_ranges;
+    *range_len = (*range_len + ENCODE_CHKSUM_CHUNK_SIZE - 1) /
+        ENCODE_CHKSUM_CHUNK_SIZE * ENCODE_CHKSUM_CHUNK_SIZE;
+    return (blocksize + *range_len - 1) / *range_len;
+}
+
+enum column_range_op {
+    COLUMN_RANGE_ENCODE,
+    COLUMN_RANGE_DECODE,
+    COLUMN_RANGE_RECONSTRUCT,
+};
+
+struct column_ranges_job {
+    ec_backend_t instance;
+    ec_thread_pool_t pool;
+    enum column_range_op op;
+    int k;
+    int m;
+    char **data;
+    char **parity;
+    int *missing_idxs;          /* decode and reconstruct */
+    int destination_idx;        /* reconstruct */
+    int blocksize;
+    int range_len;
+    uint32_t *chksums;          /* encode, if checksumming parity */
+    int rets[EC_THREAD_POOL_MAX_THREADS];
+};
+
+static void column_range_task(void *arg, int task)
+{
+    struct column_ranges_job *job = (struct column_ranges_job *) arg;
+    struct ec_backend_op_stubs *ops = job->instance->common.ops;
+    void *backend_desc = job->instance->desc.backend_desc;
+    char *data_chunks[EC_MAX_FRAGMENTS];
+    char *parity_chunks[EC_MAX_FRAGMENTS];
+    int offset = task * job->range_len;
+    int len = job->blocksize - offset;
+    int i;
+
+    if (len > job->range_len) {
+        len = job->range_len;
+    }
+    for (i = 0; i < job->k; i++) {
+        data_chunks[i] = job->data[i] + offset;
+    }
+    for (i = 0; i < job->m; i++) {
+        parity_chunks[i] = job->parity[i] + offset;
+    }
+
+    switch (job->op) {
+        case COLUMN_RANGE_ENCODE:
+            job->rets[task] = ops->encode(backend_desc, data_chunks,
+                                          parity_chunks, len);
+            break;
+        case COLUMN_RANGE_DECODE:
+            job->rets[task] = ops->decode(backend_desc, data_chunks,
+                                          parity_chunks, job->missing_idxs,
+                                          len);
+            break;
+        case COLUMN_RANGE_RECONSTRUCT:
+            job->rets[task] = ops->reconstruct(backend_desc, data_chunks,
+                                               parity_chunks,
+                                               job->missing_idxs,
+                                               job->destination_idx, len);
+            break;
+    }
+}
+
+/*
+ * Run job->op on num_ranges column ranges of the stripe on the instance's
+ * thread pool.  For decode and reconstruct the backend gets to build its
+ * decoding tables first, so that the ranges share one copy.
+ */
+static int run_column_ranges(struct column_ranges_job *job, int num_ranges)
+{
+    ec_backend_t instance = job->instance;
+    int i, ret;
+
+    if (job->op != COLUMN_RANGE_ENCODE &&
+        NULL != instance->common.ops->prepare_decode) {
+        ret = instance->common.ops->prepare_decode(
+                instance->desc.backend_desc, job->missing_idxs);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    ec_thread_pool_run(job->pool, num_ranges, column_range_task, job);
+    for (i = 0; i < num_ranges; i++) {
+        if (job->rets[i] < 0) {
+            return job->rets[i];
+        }
+    }
+    return 0;
+}
+
+static void parity_chksum_task(void *arg, int task)
+{
+    struct column_ranges_job *job = (struct column_ranges_job *) arg;
+    int i = job->k + task;
+
+    job->chksums[i] = update_checksum(job->instance->args.uargs.ct,
+                                      job->chksums[i], job->parity[task],
+                                      job->blocksize);
+}
+
+/*
+ * Encode num_ranges column ranges of the stripe on the instance's thread
+ * pool; then, if chksums is given, checksum the parity fragments the same
+ * way, one per thread
+ */
+static int encode_ranges(ec_backend_t instance, ec_thread_pool_t pool,
+        int k, int m, char **data, char **parity, int blocksize,
+        int num_ranges, int range_len, uint32_t *chksums)
+{
+    struct column_ranges_job job;
+    int ret;
+
+    memset(&job, 0, sizeof(job));
+    job.instance = instance;
+    job.pool = pool;
+    job.op = COLUMN_RANGE_ENCODE;
+    job.k = k;
+    job.m = m;
+    job.data = data;
+    job.parity = parity;
+    job.blocksize = blocksize;
+    job.range_len = range_len;
+    job.chksums = chksums;
+
+    ret = run_column_ranges(&job, num_ranges);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (NULL != chksums) {
+        ec_thread_pool_run(pool, m, parity_chksum_task, &job);
+    }
+    return 0;
+}
+
+/*
+ * Decode (destination_idx < 0) or reconstruct destination_idx, splitting
+ * the stripe over the instance's thread pool when it is worth it
+ */
+static int decode_columns(ec_backend_t instance, int k, int m,
+        char **data, char **parity, int *missing_idxs, int destination_idx,
+        int blocksize)
+{
+    struct column_ranges_job job;
+    ec_thread_pool_t pool = NULL;
+    int num_ranges = 1, range_len = blocksize;
+    int ret;
+
+    if (is_chunkable_backend(instance->common.id)) {
+        num_ranges = get_column_ranges(instance, blocksize, &range_len,
+                                       &pool);
+    }
+    if (num_ranges < 2) {
+        if (destination_idx < 0) {
+            return instance->common.ops->decode(instance->desc.backend_desc,
+                                                data, parity, missing_idxs,
+                                                blocksize);
+        }
+        return instance->common.ops->reconstruct(instance->desc.backend_desc,
+                                                 data, parity, missing_idxs,
+                                                 destination_idx, blocksize);
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.instance = instance;
+    job.pool = pool;
+    job.op = destination_idx < 0 ? COLUMN_RANGE_DECODE :
+                                   COLUMN_RANGE_RECONSTRUCT;
+    job.k = k;
+    job.m = m;
+    job.data = data;
+    job.parity = parity;
+    job.missing_idxs = missing_idxs;
+    job.destination_idx = destination_idx;
+    job.blocksize = blocksize;
+    job.range_len = range_len;
+
+    ret = run_column_ranges(&job, num_ranges);
+    ec_thread_pool_unref(pool);
+    return ret;
+}
+
+/*
+ * liberasurecode_encode(), also feeding orig_data to digest (if given) as
+ * it is copied into the data fragments
+ */
+static int encode_object(int desc,
+        const char *orig_data, uint64_t orig_data_size,
+        char ***encoded_data, char ***encoded_parity,
+        uint64_t *fragment_len, MD5_CTX *digest)
 {
     int k, m;
     int ret = 0;            /* return code */
 
     int blocksize = 0;      /* length of each of k data elements */
+    uint32_t *chksums = NULL;   /* payload checksums computed during encode */
+    int num_ranges, range_len;  /* column ranges for the thread pool */
+    ec_thread_pool_t pool = NULL;
+    ec_backend_t instance = NULL;
 
     if (orig_data == NULL) {
         log_error("Pointer to data buffer is null!");
@@ -442,7 +977,7 @@ int liberasurecode_encode(int desc,
         goto out;
     }
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
         goto out;
@@ -466,8 +1001,22 @@ int liberasurecode_encode(int desc,
         goto out;
     }
 
+    /*
+     * Checksum fragments while they are still in cache: data while it is
+     * copied in, parity as each piece is encoded
+     */
+    if (is_incremental_checksum(instance->args.uargs.ct) &&
+        is_chunkable_backend(instance->common.id)) {
+        chksums = (uint32_t *) alloc_zeroed_buffer(sizeof(uint32_t) * (k + m));
+        if (NULL == chksums) {
+            ret = -ENOMEM;
+            goto out;
+        }
+    }
+
     ret = prepare_fragments_for_encode(instance, k, m, orig_data, orig_data_size,
-                                       *encoded_data, *encoded_parity, &blocksize);
+                                       *encoded_data, *encoded_parity, &blocksize,
+                                       chksums, digest);
     if (ret < 0) {
         // ensure encoded_data/parity point the head of fragment_ptr
         get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
@@ -476,8 +1025,21 @@ int liberasurecode_encode(int desc,
     }
 
     /* call the backend encode function passing it desc instance */
-    ret = instance->common.ops->encode(instance->desc.backend_desc,
-                                       *encoded_data, *encoded_parity, blocksize);
+    if (is_chunkable_backend(instance->common.id) &&
+        (num_ranges = get_column_ranges(instance, blocksize, &range_len,
+                                        &pool)) > 1) {
+        ret = encode_ranges(instance, pool, k, m, *encoded_data,
+                            *encoded_parity, blocksize, num_ranges,
+                            range_len, chksums);
+        ec_thread_pool_unref(pool);
+    } else if (NULL != chksums) {
+        ret = encode_with_chksums(instance, k, m, *encoded_data,
+                                  *encoded_parity, blocksize, chksums);
+    } else {
+        ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                           *encoded_data, *encoded_parity,
+                                           blocksize);
+    }
     if (ret < 0) {
         // ensure encoded_data/parity point the head of fragment_ptr
         get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
@@ -486,44 +1048,228 @@ int liberasurecode_encode(int desc,
     }
 
     ret = finalize_fragments_after_encode(instance, k, m, blocksize, orig_data_size,
-                                          *encoded_data, *encoded_parity);
+                                          *encoded_data, *encoded_parity, chksums);
 
     *fragment_len = get_fragment_size((*encoded_data)[0]);
 
 out:
+    free(chksums);
     if (ret) {
         /* Cleanup the allocations we have done */
         liberasurecode_encode_cleanup(desc, *encoded_data, *encoded_parity);
         log_error("Error in liberasurecode_encode %d", ret);
     }
+    liberasurecode_backend_instance_put(instance);
     return ret;
 }
 
 /**
- * Cleanup structures allocated by librasurecode_decode
- *
- * The caller has no context, so cannot safely free memory
- * allocated by liberasurecode, so it must pass the
- * deallocation responsibility back to liberasurecode.
+ * Erasure encode a data buffer
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param data - (char *) buffer of data decoded by
- *        librasurecode_decode
- * @return 0 in success; -error otherwise
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
  */
-int liberasurecode_decode_cleanup(int desc, char *data)
+int liberasurecode_encode(int desc,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len)                         /* output */
 {
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
-    if (NULL == instance) {
-        return -EBACKENDNOTAVAIL;
-    }
-
-    free(data);
+    return encode_object(desc, orig_data, orig_data_size,
+                         encoded_data, encoded_parity, fragment_len, NULL);
+}
+
+/**
+ * Erasure encode a data buffer and return its MD5 digest
+ *
+ * Same as liberasurecode_encode(), but also computes the MD5 of orig_data
+ * (e.g. for an object ETag) piece by piece as it is copied into the data
+ * fragments, so the object is only read once.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ * @param digest - _output_ buffer of LIBERASURECODE_DIGEST_LEN bytes for
+ *        the MD5 of orig_data
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_with_digest(int desc,
+        const char *orig_data, uint64_t orig_data_size, /* input */
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len,                         /* output */
+        unsigned char *digest)                          /* output */
+{
+    MD5_CTX ctx;
+    int ret;
+
+    if (digest == NULL) {
+        log_error("Pointer to digest buffer is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    MD5_Init(&ctx);
+    ret = encode_object(desc, orig_data, orig_data_size,
+                        encoded_data, encoded_parity, fragment_len, &ctx);
+    if (0 == ret) {
+        MD5_Final(digest, &ctx);
+    }
+    return ret;
+}
+
+/**
+ * Cleanup structures allocated by librasurecode_decode
+ *
+ * The caller has no context, so cannot safely free memory
+ * allocated by liberasurecode, so it must pass the
+ * deallocation responsibility back to liberasurecode.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data - (char *) buffer of data decoded by
+ *        librasurecode_decode
+ * @return 0 in success; -error otherwise
+ */
+int liberasurecode_decode_cleanup(int desc, char *data)
+{
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+    liberasurecode_backend_instance_put(instance);
+
+    free(data);
 
     return 0;
 }
 
+/**
+ * Pick the fragments to decode from, verifying only the ones picked
+ *
+ * Candidates are ordered data fragments first (by index), then parity,
+ * then any duplicates, and the first k of them are verified.  If those
+ * are all valid and enough to decode from on their own (all data, or a
+ * backend that can decode from any k), they are the selection; a healthy
+ * stripe is then served without hashing its parity.  Otherwise the
+ * remaining candidates are verified as well and every valid one is used.
+ *
+ * @param instance - backend instance
+ * @param desc - liberasurecode descriptor/handle
+ * @param fragments - fragments with already validated headers
+ * @param num_fragments - number of fragments in fragments
+ * @param selected - _output_ array (num_fragments entries) of valid fragments
+ * @param num_selected - _output_ number of fragments in selected
+ *
+ * @return 0 on success, -error code otherwise
+ */
+static int select_verified_fragments(ec_backend_t instance, int desc,
+        char **fragments, int num_fragments,            /* input */
+        char **selected, int *num_selected)             /* output */
+{
+    int k = instance->args.uargs.k;
+    char **candidates = NULL;
+    char *queued = NULL;
+    char is_selected[EC_MAX_FRAGMENTS] = { 0 };
+    uint64_t *invalid_bm = NULL;
+    int num_candidates = 0;
+    int num_valid = 0;
+    int all_data = 1;
+    int pos = 0;
+    int ret = 0;
+    int i, idx, batch;
+
+    candidates = alloc_zeroed_buffer(sizeof(char *) * num_fragments);
+    queued = alloc_zeroed_buffer(num_fragments);
+    /* Sized for the longest batch: every fragment passed in */
+    invalid_bm = alloc_zeroed_buffer(sizeof(uint64_t) *
+                                     ((num_fragments + 63) / 64));
+    if (NULL == candidates || NULL == queued || NULL == invalid_bm) {
+        log_error("Could not allocate candidate fragments!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    /* One fragment per index, in index order, then whatever is left */
+    for (idx = 0; idx < EC_MAX_FRAGMENTS; idx++) {
+        for (i = 0; i < num_fragments; i++) {
+            if (!queued[i] && get_fragment_idx(fragments[i]) == idx) {
+                candidates[num_candidates++] = fragments[i];
+                queued[i] = 1;
+                break;
+            }
+        }
+    }
+    for (i = 0; i < num_fragments; i++) {
+        if (!queued[i]) {
+            candidates[num_candidates++] = fragments[i];
+        }
+    }
+
+    /* First the k we would like to use, then (if need be) the rest */
+    batch = k;
+    while (pos < num_candidates) {
+        if (batch > num_candidates - pos) {
+            batch = num_candidates - pos;
+        }
+        ret = liberasurecode_verify_fragments(desc, candidates + pos, batch,
+                                              invalid_bm);
+        if (ret < 0) {
+            goto out;
+        }
+        for (i = 0; i < batch; i++) {
+            idx = get_fragment_idx(candidates[pos + i]);
+            if ((invalid_bm[i / 64] & (1ULL << (i % 64))) ||
+                    idx < 0 || idx >= EC_MAX_FRAGMENTS ||
+                    is_selected[idx]) {
+                all_data = 0;
+                continue;
+            }
+            if (idx >= k) {
+                all_data = 0;
+            }
+            is_selected[idx] = 1;
+            selected[num_valid++] = candidates[pos + i];
+        }
+        pos += batch;
+
+        if (num_valid == k && (all_data ||
+                instance->common.id != EC_BACKEND_FLAT_XOR_HD)) {
+            break;
+        }
+        batch = num_candidates - pos;
+    }
+
+    if (num_valid < k) {
+        log_error("Not enough valid fragments available for decode!");
+        ret = -EINSUFFFRAGS;
+        goto out;
+    }
+    *num_selected = num_valid;
+    ret = 0;
+
+out:
+    free(invalid_bm);
+    free(queued);
+    free(candidates);
+    return ret;
+}
+
 /**
  * Reconstruct original data from a set of k encoded fragments
  *
@@ -532,7 +1278,8 @@ int liberasurecode_decode_cleanup(int desc, char *data)
  * @param available_fragments - erasure encoded fragments (> = k)
  * @param num_fragments - number of fragments being passed in
  * @param fragment_len - length of each fragment (assume they are the same)
- * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0),
+ *        one of LIBERASURECODE_METADATA_CHECKS_{NONE,ALL,LAZY}
  * @param out_data - _output_ pointer to decoded data
  * @param out_data_len - _output_ length of decoded output
  * @return 0 on success, -error code otherwise
@@ -555,10 +1302,11 @@ int liberasurecode_decode(int desc,
     char **data_segments = NULL;
     char **parity_segments = NULL;
     int *missing_idxs = NULL;
+    char **verified_fragments = NULL;
 
     uint64_t realloc_bm = 0;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
         goto out;
@@ -609,6 +1357,26 @@ int liberasurecode_decode(int desc,
         }
     }
 
+    /*
+     * In lazy mode only the fragments we are going to use get checked,
+     * and everything below works from those alone
+     */
+    if (force_metadata_checks == LIBERASURECODE_METADATA_CHECKS_LAZY) {
+        verified_fragments = alloc_zeroed_buffer(sizeof(char *) * num_fragments);
+        if (NULL == verified_fragments) {
+            log_error("Could not allocate verified fragments buffer!");
+            ret = -ENOMEM;
+            goto out;
+        }
+        ret = select_verified_fragments(instance, desc,
+                                        available_fragments, num_fragments,
+                                        verified_fragments, &num_fragments);
+        if (ret < 0) {
+            goto out;
+        }
+        available_fragments = verified_fragments;
+    }
+
     if (instance->common.id != EC_BACKEND_SHSS && instance->common.id != EC_BACKEND_LIBPHAZR) {
         /* shss (ntt_backend) & libphazr backend must force to decode */
         // TODO: Add a frag and function to handle whether the backend want to decode or not.
@@ -646,13 +1414,17 @@ int liberasurecode_decode(int desc,
         goto out;
     }
 
-    /* If metadata checks requested, check fragment integrity upfront */
-    if (force_metadata_checks) {
-        int num_invalid_fragments = 0;
-        for (i = 0; i < num_fragments; ++i) {
-            if (is_invalid_fragment(desc, available_fragments[i])) {
-                ++num_invalid_fragments;
-            }
+    /*
+     * If metadata checks requested, check fragment integrity upfront;
+     * any non-zero value other than LAZY means ALL
+     */
+    if (force_metadata_checks &&
+        force_metadata_checks != LIBERASURECODE_METADATA_CHECKS_LAZY) {
+        int num_invalid_fragments = liberasurecode_verify_fragments(desc,
+                available_fragments, num_fragments, NULL);
+        if (num_invalid_fragments < 0) {
+            ret = num_invalid_fragments;
+            goto out;
         }
         if ((num_fragments - num_invalid_fragments) < k) {
             ret = -EINSUFFFRAGS;
@@ -695,9 +1467,8 @@ int liberasurecode_decode(int desc,
     get_data_ptr_array_from_fragments(parity_segments, parity, m);
 
     /* call the backend decode function passing it desc instance */
-    ret = instance->common.ops->decode(instance->desc.backend_desc,
-                                       data_segments, parity_segments,
-                                       missing_idxs, blocksize);
+    ret = decode_columns(instance, k, m, data_segments, parity_segments,
+                         missing_idxs, -1, blocksize);
 
     if (ret < 0) {
         log_error("Encountered error in backend decode function!");
@@ -734,13 +1505,13 @@ out:
     /* Free the buffers allocated in prepare_fragments_for_decode */
     if (realloc_bm != 0) {
         for (i = 0; i < k; i++) {
-            if (realloc_bm & (1 << i)) {
+            if (realloc_bm & (1ULL << i)) {
                 free(data[i]);
             }
         }
 
         for (i = 0; i < m; i++) {
-            if (realloc_bm & (1 << (i + k))) {
+            if (realloc_bm & (1ULL << (i + k))) {
                 free(parity[i]);
             }
         }
@@ -751,6 +1522,8 @@ out:
     free(missing_idxs);
     free(data_segments);
     free(parity_segments);
+    free(verified_fragments);
+    liberasurecode_backend_instance_put(instance);
 
     return ret;
 }
@@ -789,7 +1562,7 @@ int liberasurecode_reconstruct_fragment(int desc,
     char **parity_segments = NULL;
     int set_chksum = 1;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
         goto out;
@@ -903,10 +1676,8 @@ int liberasurecode_reconstruct_fragment(int desc,
 
 
     /* call the backend reconstruct function passing it desc instance */
-    ret = instance->common.ops->reconstruct(instance->desc.backend_desc,
-                                            data_segments, parity_segments,
-                                            missing_idxs, destination_idx,
-                                            blocksize);
+    ret = decode_columns(instance, k, m, data_segments, parity_segments,
+                         missing_idxs, destination_idx, blocksize);
     if (ret < 0) {
         log_error("Could not reconstruct fragment!");
         goto out;
@@ -937,13 +1708,13 @@ out:
     /* Free the buffers allocated in prepare_fragments_for_decode */
     if (realloc_bm != 0) {
         for (i = 0; i < k; i++) {
-            if (realloc_bm & (1 << i)) {
+            if (realloc_bm & (1ULL << i)) {
                 free(data[i]);
             }
         }
 
         for (i = 0; i < m; i++) {
-            if (realloc_bm & (1 << (i + k))) {
+            if (realloc_bm & (1ULL << (i + k))) {
                 free(parity[i]);
             }
         }
@@ -954,137 +1725,732 @@ out:
     free(missing_idxs);
     free(data_segments);
     free(parity_segments);
+    liberasurecode_backend_instance_put(instance);
 
     return ret;
 }
 
-/**
- * Return a list of lists with valid rebuild indexes given
- * a list of missing indexes.
- *
- * @desc: liberasurecode instance descriptor (obtained with
- *        liberasurecode_instance_create)
- * @fragments_to_reconstruct list of indexes to reconstruct
- * @fragments_to_exclude list of indexes to exclude from
-          reconstruction equation
- * @fragments_needed list of fragments needed to reconstruct
-          fragments in fragments_to_reconstruct
- *
- * @return a list of lists (bitmaps) of indexes to rebuild data
- *        from (in 'fragments_needed')
+static void xor_into(char *dst, const char *src, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+/*
+ * Backends whose parity is a linear function of the data over GF(2^w), so
+ * that encoding a stripe that is all zeros except for the delta yields
+ * the parity delta
  */
-int liberasurecode_fragments_needed(int desc,
-                                    int *fragments_to_reconstruct,
-                                    int *fragments_to_exclude,
-                                    int *fragments_needed)
+static int is_linear_backend(ec_backend_id_t id)
+{
+    switch (id) {
+        case EC_BACKEND_JERASURE_RS_VAND:
+        case EC_BACKEND_JERASURE_RS_CAUCHY:
+        case EC_BACKEND_FLAT_XOR_HD:
+        case EC_BACKEND_ISA_L_RS_VAND:
+        case EC_BACKEND_LIBERASURECODE_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_CAUCHY:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Fallback for backends without an ENCODEUPDATE stub: encode the delta
+ * as the only non-zero data fragment and XOR the result into the parity
+ */
+static int encode_update_by_encode(ec_backend_t instance, int k, int m,
+        int data_idx, char *delta, char **parity, int blocksize)
 {
+    char *zeros = NULL;
+    char **data = NULL;
+    char **parity_delta = NULL;
     int ret = 0;
+    int i;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
-    if (NULL == instance) {
-        ret = -EBACKENDNOTAVAIL;
-        goto out_error;
+    zeros = get_aligned_buffer16(blocksize);
+    data = alloc_zeroed_buffer(sizeof(char*) * k);
+    parity_delta = alloc_zeroed_buffer(sizeof(char*) * m);
+    if (NULL == zeros || NULL == data || NULL == parity_delta) {
+        ret = -ENOMEM;
+        goto out;
     }
-    if (NULL == fragments_to_reconstruct) {
-        log_error("Unable to determine list of fragments needed, pointer to list of indexes to reconstruct is NULL.");
-        ret = -EINVALIDPARAMS;
-        goto out_error;
+
+    for (i = 0; i < m; i++) {
+        parity_delta[i] = get_aligned_buffer16(blocksize);
+        if (NULL == parity_delta[i]) {
+            ret = -ENOMEM;
+            goto out;
+        }
     }
 
-    if (NULL == fragments_to_exclude) {
-        log_error("Unable to determine list of fragments needed, pointer to list of fragments to exclude is NULL.");
-        ret = -EINVALIDPARAMS;
-        goto out_error;
+    for (i = 0; i < k; i++) {
+        data[i] = (i == data_idx) ? delta : zeros;
     }
 
-    if (NULL == fragments_needed) {
-        log_error("Unable to determine list of fragments needed, pointer to list of fragments to reconstruct is NULL.");
-        ret = -EINVALIDPARAMS;
-        goto out_error;
+    ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                       data, parity_delta, blocksize);
+    if (ret < 0) {
+        goto out;
     }
 
-    /* FIXME preprocessing */
+    for (i = 0; i < m; i++) {
+        xor_into(parity[i], parity_delta[i], blocksize);
+    }
 
-    /* call the backend fragments_needed function passing it desc instance */
-    ret = instance->common.ops->fragments_needed(
-            instance->desc.backend_desc,
-            fragments_to_reconstruct, fragments_to_exclude, fragments_needed);
+out:
+    if (NULL != parity_delta) {
+        for (i = 0; i < m; i++) {
+            free(parity_delta[i]);
+        }
+    }
+    free(parity_delta);
+    free(data);
+    free(zeros);
 
-out_error:
     return ret;
 }
 
-/* =~=*=~==~=*=~==~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~= */
-
 /**
- * Get opaque metadata for a fragment.  The metadata is opaque to the
- * client, but meaningful to the underlying library.  It is used to verify
- * stripes in verify_stripe_metadata().
+ * Update a stripe in place after one data fragment is overwritten
  *
- * @param fragment - fragment pointer
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data_fragment - data fragment being overwritten (updated in place)
+ * @param new_data - new payload for data_fragment
+ * @param new_data_len - length of new_data (the fragment payload size)
+ * @param parity_fragments - all m parity fragments (updated in place)
+ * @param num_parity - number of fragments in parity_fragments
  *
- * @param fragment_metadata - pointer to output fragment metadata struct
- *          (reference passed by the user)
+ * @return 0 on success, -error code otherwise
  */
-int liberasurecode_get_fragment_metadata(char *fragment,
-        fragment_metadata_t *fragment_metadata)
+int liberasurecode_encode_update(int desc,
+        char *data_fragment,                            /* input/output */
+        const char *new_data, uint64_t new_data_len,    /* input */
+        char **parity_fragments, int num_parity)        /* input/output */
 {
     int ret = 0;
-    fragment_header_t *fragment_hdr = NULL;
+    int blocksize = 0;
+    int orig_data_size = 0;
+    int data_idx = -1;
+    int k = -1;
+    int m = -1;
+    int i;
+    uint64_t realloc_bm = 0;
+    char *old_data = NULL;
+    char *delta = NULL;
+    char **parity = NULL;
+    char **parity_segments = NULL;
+    ec_checksum_type_t ct;
 
-    if (NULL == fragment) {
-        log_error("Need valid fragment object to get metadata for");
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    if (NULL == data_fragment || NULL == new_data || NULL == parity_fragments) {
+        log_error("Can not update parity, fragment or data pointer is NULL");
         ret = -EINVALIDPARAMS;
         goto out;
     }
 
-    if (NULL == fragment_metadata) {
-        log_error("Need valid fragment_metadata object for return value");
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+    ct = instance->args.uargs.ct;
+
+    if (num_parity != m) {
+        log_error("All %d parity fragments are needed to update parity", m);
         ret = -EINVALIDPARAMS;
         goto out;
     }
 
-    /* Verify metadata checksum */
-    if (is_invalid_fragment_header((fragment_header_t *) fragment)) {
+    if (is_invalid_fragment_header((fragment_header_t *) data_fragment)) {
         log_error("Invalid fragment header information!");
         ret = -EBADHEADER;
         goto out;
     }
 
-    memcpy(fragment_metadata, fragment, sizeof(struct fragment_metadata));
-    fragment_hdr = (fragment_header_t *) fragment;
-    if (LIBERASURECODE_FRAG_HEADER_MAGIC != fragment_hdr->magic) {
-        if (LIBERASURECODE_FRAG_HEADER_MAGIC != bswap_32(fragment_hdr->magic)) {
-            log_error("Invalid fragment, illegal magic value");
+    data_idx = get_fragment_idx(data_fragment);
+    blocksize = get_fragment_payload_size(data_fragment);
+    orig_data_size = get_orig_data_size(data_fragment);
+    if (data_idx < 0 || data_idx >= k) {
+        log_error("Fragment %d is not a data fragment", data_idx);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (new_data_len != blocksize) {
+        log_error("New data length %llu does not match payload size %d",
+                  (unsigned long long) new_data_len, blocksize);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    /* Put the parity fragments in index order and check they match */
+    parity = alloc_zeroed_buffer(sizeof(char*) * m);
+    parity_segments = alloc_zeroed_buffer(sizeof(char*) * m);
+    if (NULL == parity || NULL == parity_segments) {
+        log_error("Could not allocate parity buffer!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    for (i = 0; i < m; i++) {
+        char *fragment = parity_fragments[i];
+        int idx;
+
+        if (NULL == fragment ||
+            is_invalid_fragment_header((fragment_header_t *) fragment)) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+        idx = get_fragment_idx(fragment);
+        if (idx < k || idx >= k + m || NULL != parity[idx - k]) {
+            log_error("Fragment %d is not a distinct parity fragment", idx);
             ret = -EINVALIDPARAMS;
             goto out;
-        } else {
-            // Must've written this on an opposite-endian architecture.
-            // Fix it in fragment_metadata
-            fragment_metadata->idx = bswap_32(fragment_metadata->idx);
-            fragment_metadata->size = bswap_32(fragment_metadata->size);
-            fragment_metadata->frag_backend_metadata_size =
-                bswap_32(fragment_metadata->frag_backend_metadata_size);
-            fragment_metadata->orig_data_size =
-                bswap_64(fragment_metadata->orig_data_size);
-            fragment_metadata->chksum_type =
-                bswap_32(fragment_metadata->chksum_type);
-            for (int i = 0; i < LIBERASURECODE_MAX_CHECKSUM_LEN; i++) {
-                fragment_metadata->chksum[i] =
-                    bswap_32(fragment_metadata->chksum[i]);
+        }
+        if (get_fragment_payload_size(fragment) != blocksize ||
+            get_orig_data_size(fragment) != orig_data_size) {
+            log_error("Parity fragment %d is not from the same stripe", idx);
+            ret = -EBADHEADER;
+            goto out;
+        }
+        parity[idx - k] = fragment;
+    }
+
+    /* Backends expect 16-byte aligned payloads */
+    for (i = 0; i < m; i++) {
+        char *payload = get_data_ptr_from_fragment(parity[i]);
+        if (((uintptr_t) payload & 15) != 0) {
+            parity_segments[i] = get_aligned_buffer16(blocksize);
+            if (NULL == parity_segments[i]) {
+                log_error("Could not allocate parity buffer!");
+                ret = -ENOMEM;
+                goto out;
             }
-            fragment_metadata->backend_version =
-                bswap_32(fragment_metadata->backend_version);
+            memcpy(parity_segments[i], payload, blocksize);
+            realloc_bm |= 1ULL << i;
+        } else {
+            parity_segments[i] = payload;
         }
     }
 
-    switch(fragment_metadata->chksum_type) {
-        case CHKSUM_CRC32: {
-            uint32_t computed_chksum = 0;
+    /* delta = old ^ new */
+    old_data = get_data_ptr_from_fragment(data_fragment);
+    delta = get_aligned_buffer16(blocksize);
+    if (NULL == delta) {
+        log_error("Could not allocate delta buffer!");
+        ret = -ENOMEM;
+        goto out;
+    }
+    memcpy(delta, new_data, blocksize);
+    xor_into(delta, old_data, blocksize);
+
+    ret = -EECMETHODNOTIMPL;
+    if (NULL != instance->common.ops->encode_update) {
+        ret = instance->common.ops->encode_update(instance->desc.backend_desc,
+                                                  data_idx, delta,
+                                                  parity_segments, blocksize);
+    }
+    if (ret == -EECMETHODNOTIMPL && is_linear_backend(instance->common.id)) {
+        ret = encode_update_by_encode(instance, k, m, data_idx, delta,
+                                      parity_segments, blocksize);
+    }
+    if (ret < 0) {
+        log_error("Could not update parity fragments!");
+        goto out;
+    }
+
+    /* Write back the payloads and refresh checksums and headers */
+    memcpy(old_data, new_data, blocksize);
+    add_fragment_metadata(instance, data_fragment, data_idx,
+                          orig_data_size, blocksize, ct, 1);
+
+    for (i = 0; i < m; i++) {
+        if (realloc_bm & (1ULL << i)) {
+            memcpy(get_data_ptr_from_fragment(parity[i]), parity_segments[i],
+                   blocksize);
+        }
+        add_fragment_metadata(instance, parity[i], i + k,
+                              orig_data_size, blocksize, ct, 1);
+    }
+
+out:
+    if (NULL != parity_segments) {
+        for (i = 0; i < m; i++) {
+            if (realloc_bm & (1ULL << i)) {
+                free(parity_segments[i]);
+            }
+        }
+    }
+    free(parity_segments);
+    free(parity);
+    free(delta);
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
+struct ec_encode_accumulator {
+    int desc;
+    int k;
+    int m;
+    int blocksize;
+    int data_offset;
+    int incremental;            /* parity is updated as fragments arrive */
+    uint64_t orig_data_size;
+    /* Data fragments added so far */
+    char added[EC_MAX_FRAGMENTS];
+    int num_added;
+    pthread_mutex_t lock;       /* guards added and the parity buffers */
+    char **encoded_data;        /* payload pointers */
+    char **encoded_parity;      /* payload pointers */
+};
+
+static void free_encode_accumulator(ec_encode_accumulator_t acc)
+{
+    int i;
+
+    if (NULL != acc->encoded_data) {
+        for (i = 0; i < acc->k; i++) {
+            if (NULL != acc->encoded_data[i]) {
+                free_fragment_buffer(acc->encoded_data[i]);
+            }
+        }
+        free(acc->encoded_data);
+    }
+    if (NULL != acc->encoded_parity) {
+        for (i = 0; i < acc->m; i++) {
+            if (NULL != acc->encoded_parity[i]) {
+                free_fragment_buffer(acc->encoded_parity[i]);
+            }
+        }
+        free(acc->encoded_parity);
+    }
+    pthread_mutex_destroy(&acc->lock);
+    free(acc);
+}
+
+/**
+ * Start an encode where the data fragments are supplied one at a time
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data_size - length of the whole object
+ * @param data_len_per_fragment - _output_ object bytes per data fragment
+ * @param acc - _output_ accumulator
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_accumulate_init(int desc,
+        uint64_t orig_data_size,                        /* input */
+        uint64_t *data_len_per_fragment,                /* output */
+        ec_encode_accumulator_t *acc)                   /* output */
+{
+    ec_encode_accumulator_t new_acc = NULL;
+    int metadata_size;
+    int ret = 0;
+
+    if (NULL == data_len_per_fragment || NULL == acc) {
+        log_error("Pointer to accumulator output is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    new_acc = alloc_zeroed_buffer(sizeof(struct ec_encode_accumulator));
+    if (NULL == new_acc) {
+        log_error("Could not allocate accumulator!");
+        liberasurecode_backend_instance_put(instance);
+        return -ENOMEM;
+    }
+
+    if (pthread_mutex_init(&new_acc->lock, NULL) != 0) {
+        free(new_acc);
+        liberasurecode_backend_instance_put(instance);
+        return -ENOMEM;
+    }
+
+    new_acc->desc = desc;
+    new_acc->k = instance->args.uargs.k;
+    new_acc->m = instance->args.uargs.m;
+    new_acc->orig_data_size = orig_data_size;
+    new_acc->incremental = (NULL != instance->common.ops->encode_update);
+
+    new_acc->encoded_data = alloc_zeroed_buffer(sizeof(char *) * new_acc->k);
+    new_acc->encoded_parity = alloc_zeroed_buffer(sizeof(char *) * new_acc->m);
+    if (NULL == new_acc->encoded_data || NULL == new_acc->encoded_parity) {
+        log_error("Could not allocate fragment arrays!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    /* Allocates zeroed fragments; the data is added later */
+    ret = prepare_fragments_for_encode(instance, new_acc->k, new_acc->m,
+                                       NULL, orig_data_size,
+                                       new_acc->encoded_data,
+                                       new_acc->encoded_parity,
+                                       &new_acc->blocksize, NULL, NULL);
+    if (ret < 0) {
+        /* prepare_fragments_for_encode frees the arrays on error */
+        new_acc->encoded_data = NULL;
+        new_acc->encoded_parity = NULL;
+        goto out;
+    }
+
+    metadata_size = instance->common.ops->get_backend_metadata_size(
+                                    instance->desc.backend_desc,
+                                    new_acc->blocksize);
+    new_acc->data_offset = instance->common.ops->get_encode_offset(
+                                    instance->desc.backend_desc,
+                                    metadata_size);
+
+    *data_len_per_fragment = new_acc->blocksize;
+    *acc = new_acc;
+
+out:
+    if (ret < 0) {
+        free_encode_accumulator(new_acc);
+    }
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/**
+ * Add the object bytes of one data fragment to an accumulating encode
+ *
+ * @param acc - accumulator from liberasurecode_encode_accumulate_init()
+ * @param data_idx - index of the data fragment
+ * @param data - object bytes for this fragment
+ * @param data_len - length of data
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_accumulate(ec_encode_accumulator_t acc,
+        int data_idx, const char *data, uint64_t data_len)
+{
+    uint64_t expected_len = 0;
+    uint64_t start;
+    int ret = 0;
+
+    if (NULL == acc) {
+        log_error("Pointer to accumulator is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    if (data_idx < 0 || data_idx >= acc->k) {
+        log_error("Fragment %d is not a data fragment", data_idx);
+        return -EINVALIDPARAMS;
+    }
+
+    start = (uint64_t) data_idx * acc->blocksize;
+    if (start < acc->orig_data_size) {
+        expected_len = acc->orig_data_size - start;
+        if (expected_len > acc->blocksize) {
+            expected_len = acc->blocksize;
+        }
+    }
+    if (data_len != expected_len || (data_len > 0 && NULL == data)) {
+        log_error("Fragment %d needs %llu bytes of data", data_idx,
+                  (unsigned long long) expected_len);
+        return -EINVALIDPARAMS;
+    }
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(acc->desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    /* Claim the index so concurrent callers cannot add it twice */
+    pthread_mutex_lock(&acc->lock);
+    if (acc->added[data_idx]) {
+        pthread_mutex_unlock(&acc->lock);
+        log_error("Fragment %d was already added", data_idx);
+        liberasurecode_backend_instance_put(instance);
+        return -EINVALIDPARAMS;
+    }
+    acc->added[data_idx] = 1;
+    acc->num_added++;
+    pthread_mutex_unlock(&acc->lock);
+
+    if (data_len > 0) {
+        memcpy(acc->encoded_data[data_idx] + acc->data_offset, data, data_len);
+    }
+
+    pthread_mutex_lock(&acc->lock);
+    if (acc->incremental) {
+        ret = instance->common.ops->encode_update(instance->desc.backend_desc,
+                                                  data_idx,
+                                                  acc->encoded_data[data_idx],
+                                                  acc->encoded_parity,
+                                                  acc->blocksize);
+        if (ret == -EECMETHODNOTIMPL) {
+            /* Compute all parity at finalize instead (encode overwrites) */
+            acc->incremental = 0;
+            ret = 0;
+        } else if (ret < 0) {
+            acc->added[data_idx] = 0;
+            acc->num_added--;
+        }
+    }
+    pthread_mutex_unlock(&acc->lock);
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
+/**
+ * Finish an accumulating encode once all k data fragments were added
+ *
+ * @param acc - accumulator from liberasurecode_encode_accumulate_init()
+ * @param encoded_data - pointer to _output_ array of k data fragments
+ * @param encoded_parity - pointer to _output_ array of m parity fragments
+ * @param fragment_len - pointer to _output_ length of each fragment
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_accumulate_finalize(ec_encode_accumulator_t acc,
+        char ***encoded_data, char ***encoded_parity,   /* output */
+        uint64_t *fragment_len)                         /* output */
+{
+    int ret = 0;
+
+    if (NULL == acc || NULL == encoded_data || NULL == encoded_parity ||
+        NULL == fragment_len) {
+        log_error("Pointer to accumulator or output is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(acc->desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    pthread_mutex_lock(&acc->lock);
+    if (acc->num_added != acc->k) {
+        ret = -EINSUFFFRAGS;
+    } else if (!acc->incremental) {
+        ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                           acc->encoded_data,
+                                           acc->encoded_parity,
+                                           acc->blocksize);
+        /* Parity is complete; do not encode again if finalize is retried */
+        if (ret == 0) {
+            acc->incremental = 1;
+        }
+    }
+    pthread_mutex_unlock(&acc->lock);
+
+    if (ret < 0) {
+        liberasurecode_backend_instance_put(instance);
+        return ret;
+    }
+
+    finalize_fragments_after_encode(instance, acc->k, acc->m, acc->blocksize,
+                                    acc->orig_data_size,
+                                    acc->encoded_data, acc->encoded_parity,
+                                    NULL);
+    liberasurecode_backend_instance_put(instance);
+
+    *encoded_data = acc->encoded_data;
+    *encoded_parity = acc->encoded_parity;
+    *fragment_len = get_fragment_size((*encoded_data)[0]);
+
+    acc->encoded_data = NULL;
+    acc->encoded_parity = NULL;
+    free_encode_accumulator(acc);
+
+    return 0;
+}
+
+/**
+ * Release an accumulating encode without producing fragments
+ *
+ * @param acc - accumulator from liberasurecode_encode_accumulate_init()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_accumulate_abort(ec_encode_accumulator_t acc)
+{
+    if (NULL == acc) {
+        return -EINVALIDPARAMS;
+    }
+
+    free_encode_accumulator(acc);
+    return 0;
+}
+
+/**
+ * Return a list of lists with valid rebuild indexes given
+ * a list of missing indexes.
+ *
+ * @desc: liberasurecode instance descriptor (obtained with
+ *        liberasurecode_instance_create)
+ * @fragments_to_reconstruct list of indexes to reconstruct
+ * @fragments_to_exclude list of indexes to exclude from
+          reconstruction equation
+ * @fragments_needed list of fragments needed to reconstruct
+          fragments in fragments_to_reconstruct
+ *
+ * @return a list of lists (bitmaps) of indexes to rebuild data
+ *        from (in 'fragments_needed')
+ */
+int liberasurecode_fragments_needed(int desc,
+                                    int *fragments_to_reconstruct,
+                                    int *fragments_to_exclude,
+                                    int *fragments_needed)
+{
+    int ret = 0;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out_error;
+    }
+    if (NULL == fragments_to_reconstruct) {
+        log_error("Unable to determine list of fragments needed, pointer to list of indexes to reconstruct is NULL.");
+        ret = -EINVALIDPARAMS;
+        goto out_error;
+    }
+
+    if (NULL == fragments_to_exclude) {
+        log_error("Unable to determine list of fragments needed, pointer to list of fragments to exclude is NULL.");
+        ret = -EINVALIDPARAMS;
+        goto out_error;
+    }
+
+    if (NULL == fragments_needed) {
+        log_error("Unable to determine list of fragments needed, pointer to list of fragments to reconstruct is NULL.");
+        ret = -EINVALIDPARAMS;
+        goto out_error;
+    }
+
+    /* FIXME preprocessing */
+
+    /* call the backend fragments_needed function passing it desc instance */
+    ret = instance->common.ops->fragments_needed(
+            instance->desc.backend_desc,
+            fragments_to_reconstruct, fragments_to_exclude, fragments_needed);
+
+out_error:
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~= */
+
+/*
+ * Check len bytes of payload starting at chunk first_chunk against a
+ * CHKSUM_CRC32C_CHUNKED table, after checking the table against its
+ * stored CRC32C
+ */
+static int verify_chunks(const char *table, int table_size,
+        uint32_t table_chksum, int first_chunk, const char *data,
+        uint64_t len)
+{
+    const unsigned char *entry;
+    uint64_t offset, n;
+    uint32_t stored;
+
+    if (liberasurecode_crc32c(0, table, table_size) != table_chksum) {
+        return -EBADCHKSUM;
+    }
+
+    entry = (const unsigned char *) table + first_chunk * sizeof(uint32_t);
+    for (offset = 0; offset < len; offset += n) {
+        n = len - offset;
+        if (n > LIBERASURECODE_CHKSUM_CHUNK_SIZE) {
+            n = LIBERASURECODE_CHKSUM_CHUNK_SIZE;
+        }
+        stored = (uint32_t) entry[0] | ((uint32_t) entry[1] << 8) |
+                 ((uint32_t) entry[2] << 16) | ((uint32_t) entry[3] << 24);
+        if (liberasurecode_crc32c(0, data + offset, n) != stored) {
+            return -EBADCHKSUM;
+        }
+        entry += sizeof(uint32_t);
+    }
+    return 0;
+}
+
+/**
+ * Get opaque metadata for a fragment.  The metadata is opaque to the
+ * client, but meaningful to the underlying library.  It is used to verify
+ * stripes in verify_stripe_metadata().
+ *
+ * @param fragment - fragment pointer
+ *
+ * @param fragment_metadata - pointer to output fragment metadata struct
+ *          (reference passed by the user)
+ */
+int liberasurecode_get_fragment_metadata(char *fragment,
+        fragment_metadata_t *fragment_metadata)
+{
+    int ret = 0;
+    fragment_header_t *fragment_hdr = NULL;
+
+    if (NULL == fragment) {
+        log_error("Need valid fragment object to get metadata for");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (NULL == fragment_metadata) {
+        log_error("Need valid fragment_metadata object for return value");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    /* Verify metadata checksum */
+    if (is_invalid_fragment_header((fragment_header_t *) fragment)) {
+        log_error("Invalid fragment header information!");
+        ret = -EBADHEADER;
+        goto out;
+    }
+
+    memcpy(fragment_metadata, fragment, sizeof(struct fragment_metadata));
+    fragment_hdr = (fragment_header_t *) fragment;
+    if (LIBERASURECODE_FRAG_HEADER_MAGIC != fragment_hdr->magic) {
+        if (LIBERASURECODE_FRAG_HEADER_MAGIC != bswap_32(fragment_hdr->magic)) {
+            log_error("Invalid fragment, illegal magic value");
+            ret = -EINVALIDPARAMS;
+            goto out;
+        } else {
+            // Must've written this on an opposite-endian architecture.
+            // Fix it in fragment_metadata
+            fragment_metadata->idx = bswap_32(fragment_metadata->idx);
+            fragment_metadata->size = bswap_32(fragment_metadata->size);
+            fragment_metadata->frag_backend_metadata_size =
+                bswap_32(fragment_metadata->frag_backend_metadata_size);
+            fragment_metadata->orig_data_size =
+                bswap_64(fragment_metadata->orig_data_size);
+            fragment_metadata->chksum_type =
+                bswap_32(fragment_metadata->chksum_type);
+            for (int i = 0; i < LIBERASURECODE_MAX_CHECKSUM_LEN; i++) {
+                fragment_metadata->chksum[i] =
+                    bswap_32(fragment_metadata->chksum[i]);
+            }
+            fragment_metadata->backend_version =
+                bswap_32(fragment_metadata->backend_version);
+        }
+    }
+
+    switch(fragment_metadata->chksum_type) {
+        case CHKSUM_CRC32: {
+            uint32_t computed_chksum = 0;
             uint32_t stored_chksum = fragment_metadata->chksum[0];
             char *fragment_data = get_data_ptr_from_fragment(fragment);
             uint64_t fragment_size = fragment_metadata->size;
-            computed_chksum = crc32(0, (unsigned char *) fragment_data, fragment_size);
+            computed_chksum = liberasurecode_crc32(0, fragment_data, fragment_size);
             if (stored_chksum != computed_chksum) {
                 // Try again with our "alternative" crc32; see
                 // https://bugs.launchpad.net/liberasurecode/+bug/1666320
@@ -1100,8 +2466,73 @@ int liberasurecode_get_fragment_metadata(char *fragment,
             }
             break;
         }
-        case CHKSUM_MD5:
+        case CHKSUM_CRC32C: {
+            char *fragment_data = get_data_ptr_from_fragment(fragment);
+            fragment_metadata->chksum_mismatch =
+                fragment_metadata->chksum[0] != liberasurecode_crc32c(
+                    0, fragment_data, fragment_metadata->size);
+            break;
+        }
+        case CHKSUM_XXH3: {
+            char *fragment_data = get_data_ptr_from_fragment(fragment);
+            uint64_t computed_chksum = liberasurecode_xxh3_64(
+                fragment_data, fragment_metadata->size);
+            fragment_metadata->chksum_mismatch =
+                fragment_metadata->chksum[0] != (uint32_t) computed_chksum ||
+                fragment_metadata->chksum[1] !=
+                    (uint32_t) (computed_chksum >> 32);
+            break;
+        }
+        case CHKSUM_CRC32C_CHUNKED: {
+            char *fragment_data = get_data_ptr_from_fragment(fragment);
+            int table_size = get_chksum_table_size(CHKSUM_CRC32C_CHUNKED,
+                                                   fragment_metadata->size);
+            fragment_metadata->chksum_mismatch = 1;
+            if (fragment_metadata->frag_backend_metadata_size >= table_size) {
+                fragment_metadata->chksum_mismatch = 0 != verify_chunks(
+                    fragment_data + fragment_metadata->size +
+                        fragment_metadata->frag_backend_metadata_size -
+                        table_size,
+                    table_size, fragment_metadata->chksum[0], 0,
+                    fragment_data, fragment_metadata->size);
+            }
             break;
+        }
+        case CHKSUM_ALG_SIG: {
+            char *fragment_data = get_data_ptr_from_fragment(fragment);
+            fragment_metadata->chksum_mismatch =
+                fragment_metadata->chksum[0] != liberasurecode_alg_sig32(
+                    fragment_data, fragment_metadata->size);
+            break;
+        }
+        case CHKSUM_MD5: {
+            const char *fragment_data = get_data_ptr_from_fragment(fragment);
+            unsigned char digest[1][MD5_DIGEST_LEN];
+            uint32_t libec_version = fragment_hdr->libec_version;
+            int i;
+
+            if (LIBERASURECODE_FRAG_HEADER_MAGIC != fragment_hdr->magic) {
+                libec_version = bswap_32(libec_version);
+            }
+            fragment_metadata->chksum_mismatch = 0;
+            if (libec_version < _VERSION(1,7,0)) {
+                /* written without a digest; nothing to check */
+                break;
+            }
+
+            liberasurecode_md5_mb(&fragment_data, 1, fragment_metadata->size,
+                                  digest);
+            for (i = 0; i < MD5_DIGEST_LEN / 4; i++) {
+                uint32_t word = (uint32_t) digest[0][4 * i] |
+                        ((uint32_t) digest[0][4 * i + 1] << 8) |
+                        ((uint32_t) digest[0][4 * i + 2] << 16) |
+                        ((uint32_t) digest[0][4 * i + 3] << 24);
+                if (fragment_metadata->chksum[i] != word) {
+                    fragment_metadata->chksum_mismatch = 1;
+                }
+            }
+            break;
+        }
         case CHKSUM_NONE:
         default:
             break;
@@ -1138,7 +2569,7 @@ int is_invalid_fragment_header(fragment_header_t *header)
         /* no metadata checksum support */
         return 0;
 
-    csum = crc32(0, (unsigned char *) &header->meta, sizeof(fragment_metadata_t));
+    csum = liberasurecode_crc32(0, &header->meta, sizeof(fragment_metadata_t));
     if (metadata_chksum == csum) {
         return 0;
     }
@@ -1167,23 +2598,23 @@ int liberasurecode_verify_fragment_metadata(ec_backend_t be,
 
 int is_invalid_fragment_metadata(int desc, fragment_metadata_t *fragment_metadata)
 {
-    ec_backend_t be = liberasurecode_backend_instance_get_by_desc(desc);
+    int ret = 0;
+    ec_backend_t be = liberasurecode_backend_instance_get(desc);
     if (!be) {
         log_error("Unable to verify fragment metadata: invalid backend id %d.",
                 desc);
-        return -EINVALIDPARAMS;
-    }
-    if (liberasurecode_verify_fragment_metadata(be,
-            fragment_metadata) != 0) {
-        return -EBADHEADER;
-    }
-    if (!be->common.ops->is_compatible_with(fragment_metadata->backend_version))  {
-        return -EBADHEADER;
+        return -EINVALIDPARAMS;
     }
-    if (fragment_metadata->chksum_mismatch == 1) {
-        return -EBADCHKSUM;
+    if (liberasurecode_verify_fragment_metadata(be,
+            fragment_metadata) != 0) {
+        ret = -EBADHEADER;
+    } else if (!be->common.ops->is_compatible_with(fragment_metadata->backend_version))  {
+        ret = -EBADHEADER;
+    } else if (fragment_metadata->chksum_mismatch == 1) {
+        ret = -EBADCHKSUM;
     }
-    return 0;
+    liberasurecode_backend_instance_put(be);
+    return ret;
 }
 
 int is_invalid_fragment(int desc, char *fragment)
@@ -1213,6 +2644,109 @@ int is_invalid_fragment(int desc, char *fragment)
     return 0;
 }
 
+/*
+ * Below this many bytes of payload per task, verifying on more threads
+ * costs more than it saves
+ */
+#define VERIFY_MIN_BYTES_PER_THREAD (1024 * 1024)
+
+struct verify_fragments_job {
+    int desc;
+    char **fragments;
+    int num_fragments;
+    int num_tasks;          /* task t checks t, t + num_tasks, ... */
+    int *invalid;           /* per fragment is_invalid_fragment() result */
+};
+
+static void verify_fragments_task(void *arg, int task)
+{
+    struct verify_fragments_job *job = (struct verify_fragments_job *) arg;
+    int i;
+
+    for (i = task; i < job->num_fragments; i += job->num_tasks) {
+        job->invalid[i] = is_invalid_fragment(job->desc, job->fragments[i]);
+    }
+}
+
+int liberasurecode_verify_fragments(int desc,
+        char **fragments, int num_fragments,            /* input */
+        uint64_t *invalid_bm)                           /* output */
+{
+    struct verify_fragments_job job;
+    ec_thread_pool_t pool = NULL;
+    int *invalid = NULL;
+    uint64_t total_size = 0;
+    int min_split_size, num_tasks = 1, num_invalid = 0;
+    int i;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+    if (NULL == fragments || num_fragments <= 0) {
+        log_error("Unable to verify fragments: fragments missing.");
+        liberasurecode_backend_instance_put(instance);
+        return -EINVALIDPARAMS;
+    }
+
+    invalid = alloc_zeroed_buffer(sizeof(int) * num_fragments);
+    if (NULL == invalid) {
+        log_error("Could not allocate verification results!");
+        liberasurecode_backend_instance_put(instance);
+        return -ENOMEM;
+    }
+
+    /* Size up the work from the headers that look sane */
+    for (i = 0; i < num_fragments; i++) {
+        fragment_header_t *header = (fragment_header_t *) fragments[i];
+        if (NULL != header &&
+            header->magic == LIBERASURECODE_FRAG_HEADER_MAGIC) {
+            total_size += header->meta.size;
+        }
+    }
+    /* Spread the fragments over the instance's thread pool, if it has one */
+    pool = instance_pool_get(instance, &min_split_size);
+    if (NULL != pool) {
+        uint64_t max_tasks = total_size / VERIFY_MIN_BYTES_PER_THREAD;
+
+        num_tasks = ec_thread_pool_size(pool);
+        if (num_tasks > max_tasks) {
+            num_tasks = max_tasks;
+        }
+        if (num_tasks > num_fragments) {
+            num_tasks = num_fragments;
+        }
+        if (num_tasks < 1) {
+            num_tasks = 1;
+        }
+    }
+
+    job.desc = desc;
+    job.fragments = fragments;
+    job.num_fragments = num_fragments;
+    job.num_tasks = num_tasks;
+    job.invalid = invalid;
+    ec_thread_pool_run(pool, num_tasks, verify_fragments_task, &job);
+    ec_thread_pool_unref(pool);
+
+    if (NULL != invalid_bm) {
+        memset(invalid_bm, 0,
+               sizeof(uint64_t) * ((num_fragments + 63) / 64));
+    }
+    for (i = 0; i < num_fragments; i++) {
+        if (invalid[i]) {
+            num_invalid++;
+            if (NULL != invalid_bm) {
+                invalid_bm[i / 64] |= 1ULL << (i % 64);
+            }
+        }
+    }
+
+    free(invalid);
+    liberasurecode_backend_instance_put(instance);
+    return num_invalid;
+}
+
 int liberasurecode_verify_stripe_metadata(int desc,
         char **fragments, int num_fragments)
 {
@@ -1238,6 +2772,401 @@ int liberasurecode_verify_stripe_metadata(int desc,
     return 0;
 }
 
+/*
+ * Header of a CHKSUM_CRC32C_CHUNKED fragment, or NULL after logging why not
+ */
+static fragment_header_t *get_chunked_header(char *header)
+{
+    fragment_header_t *fragment_hdr = (fragment_header_t *) header;
+
+    if (NULL == header || is_invalid_fragment_header(fragment_hdr)) {
+        log_error("Invalid fragment header information!");
+        return NULL;
+    }
+    if (fragment_hdr->meta.chksum_type != CHKSUM_CRC32C_CHUNKED) {
+        log_error("Fragment has no checksum table (checksum type %d)",
+                  fragment_hdr->meta.chksum_type);
+        return NULL;
+    }
+    return fragment_hdr;
+}
+
+int liberasurecode_get_fragment_read_range(char *header,
+        uint64_t offset, uint64_t len,                  /* input */
+        uint64_t *read_offset, uint64_t *read_len,      /* output */
+        uint64_t *table_offset, uint64_t *table_len)    /* output */
+{
+    fragment_header_t *fragment_hdr = get_chunked_header(header);
+    uint64_t size, end;
+    int table_size;
+
+    if (NULL == fragment_hdr) {
+        return -EBADHEADER;
+    }
+    if (NULL == read_offset || NULL == read_len ||
+        NULL == table_offset || NULL == table_len) {
+        log_error("Output pointers for the read range can not be NULL");
+        return -EINVALIDPARAMS;
+    }
+
+    size = fragment_hdr->meta.size;
+    if (offset > size || len > size - offset) {
+        log_error("Range %llu+%llu is past the end of the payload",
+                  (unsigned long long) offset, (unsigned long long) len);
+        return -EINVALIDPARAMS;
+    }
+    table_size = get_chksum_table_size(CHKSUM_CRC32C_CHUNKED, size);
+    if (fragment_hdr->meta.frag_backend_metadata_size < table_size) {
+        log_error("Fragment is too small for its checksum table");
+        return -EBADHEADER;
+    }
+
+    end = offset + len + LIBERASURECODE_CHKSUM_CHUNK_SIZE - 1;
+    end -= end % LIBERASURECODE_CHKSUM_CHUNK_SIZE;
+    if (end > size) {
+        end = size;
+    }
+    *read_offset = offset - offset % LIBERASURECODE_CHKSUM_CHUNK_SIZE;
+    *read_len = end - *read_offset;
+    *table_offset = size + fragment_hdr->meta.frag_backend_metadata_size -
+                    table_size;
+    *table_len = table_size;
+
+    return 0;
+}
+
+int liberasurecode_verify_fragment_range(char *header, const char *table,
+        uint64_t offset, const char *data, uint64_t len)
+{
+    fragment_header_t *fragment_hdr = get_chunked_header(header);
+    uint64_t size;
+
+    if (NULL == fragment_hdr) {
+        return -EBADHEADER;
+    }
+    if (NULL == table || (NULL == data && len > 0)) {
+        log_error("Checksum table or data pointer is NULL");
+        return -EINVALIDPARAMS;
+    }
+
+    size = fragment_hdr->meta.size;
+    if (offset % LIBERASURECODE_CHKSUM_CHUNK_SIZE != 0 ||
+        offset > size || len > size - offset ||
+        (len % LIBERASURECODE_CHKSUM_CHUNK_SIZE != 0 &&
+         offset + len != size)) {
+        log_error("Range %llu+%llu is not made of whole checksum chunks",
+                  (unsigned long long) offset, (unsigned long long) len);
+        return -EINVALIDPARAMS;
+    }
+
+    return verify_chunks(table,
+            get_chksum_table_size(CHKSUM_CRC32C_CHUNKED, size),
+            fragment_hdr->meta.chksum[0],
+            offset / LIBERASURECODE_CHKSUM_CHUNK_SIZE, data, len);
+}
+
+/*
+ * Backends whose parity is a GF(2^8) combination of the data taken byte
+ * by byte, so that encoding the CHKSUM_ALG_SIG signatures of the data
+ * fragments gives the signatures of the parity fragments
+ */
+static int is_gf8_bytewise_backend(ec_backend_t instance)
+{
+    switch (instance->common.id) {
+        case EC_BACKEND_FLAT_XOR_HD:
+        case EC_BACKEND_ISA_L_RS_VAND:
+        case EC_BACKEND_ISA_L_RS_CAUCHY:
+            return 1;
+        case EC_BACKEND_JERASURE_RS_VAND:
+            return instance->common.ops->element_size(
+                    instance->desc.backend_desc) == 8;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Verify the payload checksum of each of the k + m fragments in stripe,
+ * setting bad[i] on a mismatch; the stored checksums go in chksums
+ */
+static int scrub_checksums(char **stripe, int num_fragments, int *bad,
+        uint32_t *chksums)
+{
+    fragment_metadata_t metadata;
+    int i, ret;
+
+    for (i = 0; i < num_fragments; i++) {
+        ret = liberasurecode_get_fragment_metadata(stripe[i], &metadata);
+        if (ret < 0) {
+            return ret;
+        }
+        bad[i] = metadata.chksum_mismatch;
+        chksums[i] = metadata.chksum[0];
+    }
+    return 0;
+}
+
+/*
+ * Re-encode the data fragments ENCODE_CHKSUM_CHUNK_SIZE bytes at a time
+ * into scratch space and compare with the parity fragments, setting
+ * parity_bad[i] for each parity that differs
+ */
+static int scrub_parity_by_encode(ec_backend_t instance, int k, int m,
+        char **stripe, int blocksize, int *parity_bad)
+{
+    char *data_chunks[EC_MAX_FRAGMENTS];
+    char *parity_chunks[EC_MAX_FRAGMENTS];
+    char *scratch = NULL;
+    int chunk = ENCODE_CHKSUM_CHUNK_SIZE;
+    int copy_data = 0;
+    int num_bad = 0;
+    int offset, len, i;
+    int ret = 0;
+
+    if (!is_chunkable_backend(instance->common.id) || chunk > blocksize) {
+        chunk = blocksize;
+    }
+
+    /* Backends expect 16-byte aligned payloads */
+    for (i = 0; i < k; i++) {
+        if (((uintptr_t) get_data_ptr_from_fragment(stripe[i]) & 15) != 0) {
+            copy_data = 1;
+        }
+    }
+
+    scratch = get_aligned_buffer16((m + (copy_data ? k : 0)) * chunk);
+    if (NULL == scratch) {
+        log_error("Could not allocate scrub buffer!");
+        return -ENOMEM;
+    }
+
+    for (offset = 0; offset < blocksize && num_bad < m; offset += chunk) {
+        len = blocksize - offset;
+        if (len > chunk) {
+            len = chunk;
+        }
+
+        for (i = 0; i < k; i++) {
+            data_chunks[i] = get_data_ptr_from_fragment(stripe[i]) + offset;
+            if (copy_data) {
+                memcpy(scratch + (m + i) * chunk, data_chunks[i], len);
+                data_chunks[i] = scratch + (m + i) * chunk;
+            }
+        }
+        for (i = 0; i < m; i++) {
+            parity_chunks[i] = scratch + i * chunk;
+        }
+
+        ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                           data_chunks, parity_chunks, len);
+        if (ret < 0) {
+            log_error("Could not re-encode stripe!");
+            goto out;
+        }
+
+        for (i = 0; i < m; i++) {
+            if (!parity_bad[i] && memcmp(parity_chunks[i],
+                    get_data_ptr_from_fragment(stripe[k + i]) + offset,
+                    len) != 0) {
+                parity_bad[i] = 1;
+                num_bad++;
+            }
+        }
+    }
+
+out:
+    free(scratch);
+    return ret;
+}
+
+/*
+ * Encode the data fragment signatures as if they were a tiny stripe and
+ * compare the result with the stored parity signatures
+ */
+static int scrub_parity_by_signature(ec_backend_t instance, int k, int m,
+        const uint32_t *sigs, int *parity_bad)
+{
+    /* the smallest payload every bytewise backend accepts */
+    const int sig_block = 16;
+    char *data_sigs[EC_MAX_FRAGMENTS];
+    char *parity_sigs[EC_MAX_FRAGMENTS];
+    char *scratch = NULL;
+    int i, j, ret;
+
+    scratch = get_aligned_buffer16((k + m) * sig_block);
+    if (NULL == scratch) {
+        log_error("Could not allocate scrub buffer!");
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < k; i++) {
+        data_sigs[i] = scratch + i * sig_block;
+        for (j = 0; j < 4; j++) {
+            data_sigs[i][j] = (char) (sigs[i] >> (8 * j));
+        }
+    }
+    for (i = 0; i < m; i++) {
+        parity_sigs[i] = scratch + (k + i) * sig_block;
+    }
+
+    ret = instance->common.ops->encode(instance->desc.backend_desc,
+                                       data_sigs, parity_sigs, sig_block);
+    if (ret < 0) {
+        log_error("Could not encode stripe signatures!");
+        goto out;
+    }
+
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < 4; j++) {
+            if (parity_sigs[i][j] != (char) (sigs[k + i] >> (8 * j))) {
+                parity_bad[i] = 1;
+            }
+        }
+    }
+
+out:
+    free(scratch);
+    return ret;
+}
+
+int liberasurecode_scrub_stripe(int desc,
+        char **fragments, int num_fragments,
+        int *bad_idxs, int *num_bad)
+{
+    int ret = 0;
+    int blocksize = 0;
+    int orig_data_size = 0;
+    int data_bad = 0;
+    int k = -1;
+    int m = -1;
+    int i, idx;
+    char **stripe = NULL;
+    int *chksum_bad = NULL;
+    int *parity_bad = NULL;
+    uint32_t *chksums = NULL;
+    ec_checksum_type_t ct;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    if (NULL == fragments || NULL == bad_idxs || NULL == num_bad) {
+        log_error("Can not scrub stripe, fragments or output pointer is NULL");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+    ct = instance->args.uargs.ct;
+
+    if (num_fragments != k + m) {
+        log_error("All %d fragments are needed to scrub a stripe", k + m);
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (!is_linear_backend(instance->common.id)) {
+        ret = -EECMETHODNOTIMPL;
+        goto out;
+    }
+
+    stripe = alloc_zeroed_buffer(sizeof(char*) * (k + m));
+    chksum_bad = alloc_zeroed_buffer(sizeof(int) * (k + m));
+    parity_bad = alloc_zeroed_buffer(sizeof(int) * m);
+    chksums = alloc_zeroed_buffer(sizeof(uint32_t) * (k + m));
+    if (NULL == stripe || NULL == chksum_bad || NULL == parity_bad ||
+        NULL == chksums) {
+        log_error("Could not allocate scrub state!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    /* Put the fragments in index order and check they are one stripe */
+    for (i = 0; i < num_fragments; i++) {
+        char *fragment = fragments[i];
+
+        if (NULL == fragment ||
+            is_invalid_fragment_header((fragment_header_t *) fragment)) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+        idx = get_fragment_idx(fragment);
+        if (idx < 0 || idx >= k + m || NULL != stripe[idx]) {
+            log_error("Fragment %d is not a distinct fragment index", idx);
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+        if (i == 0) {
+            blocksize = get_fragment_payload_size(fragment);
+            orig_data_size = get_orig_data_size(fragment);
+        } else if (get_fragment_payload_size(fragment) != blocksize ||
+                   get_orig_data_size(fragment) != orig_data_size) {
+            log_error("Fragment %d is not from the same stripe", idx);
+            ret = -EBADHEADER;
+            goto out;
+        }
+        stripe[idx] = fragment;
+    }
+
+    if (ct == CHKSUM_ALG_SIG && is_gf8_bytewise_backend(instance)) {
+        /*
+         * One signature pass over each fragment checks its payload, and
+         * the signatures alone then check the parity
+         */
+        ret = scrub_checksums(stripe, k + m, chksum_bad, chksums);
+        if (ret < 0) {
+            goto out;
+        }
+        for (i = 0; i < k; i++) {
+            data_bad |= chksum_bad[i];
+        }
+        if (!data_bad) {
+            ret = scrub_parity_by_signature(instance, k, m, chksums,
+                                            parity_bad);
+        }
+    } else {
+        ret = scrub_parity_by_encode(instance, k, m, stripe, blocksize,
+                                     parity_bad);
+        for (i = 0; i < m && ret == 0; i++) {
+            if (parity_bad[i] && ct != CHKSUM_NONE) {
+                /*
+                 * A bad data fragment shows up as bad parity; use the
+                 * fragment checksums to tell which side is wrong
+                 */
+                ret = scrub_checksums(stripe, k + m, chksum_bad, chksums);
+                for (idx = 0; idx < k; idx++) {
+                    data_bad |= chksum_bad[idx];
+                }
+                break;
+            }
+        }
+    }
+    if (ret < 0) {
+        goto out;
+    }
+
+    /* Parity can only be judged against intact data */
+    *num_bad = 0;
+    for (i = 0; i < k + m; i++) {
+        if (chksum_bad[i] || (i >= k && !data_bad && parity_bad[i - k])) {
+            bad_idxs[(*num_bad)++] = i;
+        }
+    }
+
+out:
+    free(chksums);
+    free(parity_bad);
+    free(chksum_bad);
+    free(stripe);
+    liberasurecode_backend_instance_put(instance);
+
+    return ret;
+}
+
 /* =~=*=~==~=*=~==~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~===~=*=~==~=*=~= */
 
 /**
@@ -1254,12 +3183,18 @@ int liberasurecode_get_aligned_data_size(int desc, uint64_t data_len)
     int word_size;
     int alignment_multiple;
 
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
         goto out;
     }
 
+    if (EC_BACKEND_JERASURE_RS_CAUCHY == instance->common.id) {
+        /* Cauchy alignment depends on the (possibly per object) packetsize */
+        ret = get_aligned_data_size(instance, data_len);
+        goto out;
+    }
+
     k = instance->args.uargs.k;
 
     word_size = instance->common.ops->element_size(
@@ -1271,6 +3206,7 @@ int liberasurecode_get_aligned_data_size(int desc, uint64_t data_len)
             * alignment_multiple;
 
 out:
+    liberasurecode_backend_instance_put(instance);
     return ret;
 }
 
@@ -1283,19 +3219,49 @@ int liberasurecode_get_minimum_encode_size(int desc)
     return liberasurecode_get_aligned_data_size(desc, 1);
 }
 
+/**
+ * This will return the packet size used to encode an object of data_len
+ * bytes.  Only Jerasure RS Cauchy encodes in packets.
+ */
+int liberasurecode_get_packetsize(int desc, uint64_t data_len)
+{
+    int ret = 0;
+    int blocksize;
+
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    if (EC_BACKEND_JERASURE_RS_CAUCHY != instance->common.id) {
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    blocksize = get_aligned_data_size(instance, data_len) /
+                instance->args.uargs.k;
+    ret = get_cauchy_packetsize(
+            instance->args.uargs.priv_args1.jerasure_cauchy_args.packetsize,
+            instance->args.uargs.w, blocksize);
+
+out:
+    liberasurecode_backend_instance_put(instance);
+    return ret;
+}
+
 int liberasurecode_get_fragment_size(int desc, int data_len)
 {
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    ec_backend_t instance = liberasurecode_backend_instance_get(desc);
     // TODO: Create a common function to calculate fragment size also for preprocessing
     if (NULL == instance)
         return -EBACKENDNOTAVAIL;
     int aligned_data_len = get_aligned_data_size(instance, data_len);
     int blocksize = aligned_data_len / instance->args.uargs.k;
-    int metadata_size = instance->common.ops->get_backend_metadata_size(
-                                                instance->desc.backend_desc,
-                                                blocksize);
+    int metadata_size = get_fragment_metadata_size(instance, blocksize);
     int size = blocksize + metadata_size;
 
+    liberasurecode_backend_instance_put(instance);
     return size;
 }
 
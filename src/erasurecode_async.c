@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode asynchronous request queues
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+
+#include <pthread.h>
+
+#include "erasurecode.h"
+#include "erasurecode_backend.h"
+#include "erasurecode_stdinc.h"
+#include "erasurecode_log.h"
+
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#else
+#include <fcntl.h>
+#endif
+
+/* Most requests a worker takes off the submission ring at once */
+#define ASYNC_BATCH_SIZE 16
+
+/* A fixed-size FIFO of requests */
+struct async_ring {
+    struct ec_async_request **reqs;
+    int head;
+    int count;
+};
+
+struct ec_async_queue {
+    int desc;
+    ec_async_callback_fn callback;
+    void *callback_arg;
+
+    pthread_mutex_t lock;
+    pthread_cond_t submit_cv;       /* requests queued, or shutting down */
+    pthread_cond_t complete_cv;     /* a request completed */
+
+    /* All under lock */
+    int depth;
+    int outstanding;                /* submitted, not yet reaped or called */
+    struct async_ring submitted;
+    struct async_ring completed;
+    int shutdown;
+
+    /* Readable while completed is not empty; one fd with eventfd */
+    int event_rfd;
+    int event_wfd;
+    int event_raised;               /* under lock */
+
+    pthread_t *workers;
+    int num_workers;
+};
+
+/* =~=*=~==~=*=~==~=*=~= Rings and completion events =~=*=~==~=*=~==~=*=~== */
+
+static void ring_push(struct async_ring *ring, int depth,
+        struct ec_async_request *req)
+{
+    ring->reqs[(ring->head + ring->count) % depth] = req;
+    ring->count++;
+}
+
+static struct ec_async_request *ring_pop(struct async_ring *ring, int depth)
+{
+    struct ec_async_request *req = ring->reqs[ring->head];
+
+    ring->head = (ring->head + 1) % depth;
+    ring->count--;
+    return req;
+}
+
+static int open_event(ec_async_queue_t queue)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    queue->event_rfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (queue->event_rfd < 0) {
+        return -errno;
+    }
+    queue->event_wfd = queue->event_rfd;
+#else
+    int fds[2];
+
+    if (pipe(fds) != 0) {
+        return -errno;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    queue->event_rfd = fds[0];
+    queue->event_wfd = fds[1];
+#endif
+    return 0;
+}
+
+static void close_event(ec_async_queue_t queue)
+{
+    if (queue->event_wfd >= 0 && queue->event_wfd != queue->event_rfd) {
+        close(queue->event_wfd);
+    }
+    if (queue->event_rfd >= 0) {
+        close(queue->event_rfd);
+    }
+}
+
+/*
+ * Both under lock: the event is raised as the completed ring stops being
+ * empty and cleared as it empties again, so one write covers a batch
+ */
+static void raise_event(ec_async_queue_t queue)
+{
+    uint64_t one = 1;
+    ssize_t rc;
+
+    if (queue->event_raised) {
+        return;
+    }
+    queue->event_raised = 1;
+    do {
+        rc = write(queue->event_wfd, &one, sizeof(one));
+    } while (rc < 0 && EINTR == errno);
+}
+
+static void clear_event(ec_async_queue_t queue)
+{
+    uint64_t buf[8];
+    ssize_t rc;
+
+    if (!queue->event_raised) {
+        return;
+    }
+    queue->event_raised = 0;
+    do {
+        rc = read(queue->event_rfd, buf, sizeof(buf));
+    } while (rc > 0 || (rc < 0 && EINTR == errno));
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*=~== Workers =~==~=*=~==~=*=~==~=*=~==~=*=~==~= */
+
+static void run_request(int desc, struct ec_async_request *req)
+{
+    switch (req->op) {
+        case EC_ASYNC_ENCODE:
+            req->status = liberasurecode_encode(desc,
+                    req->orig_data, req->orig_data_size,
+                    &req->encoded_data, &req->encoded_parity,
+                    &req->fragment_len);
+            break;
+        case EC_ASYNC_DECODE:
+            req->status = liberasurecode_decode(desc,
+                    req->available_fragments, req->num_fragments,
+                    req->fragment_len, req->force_metadata_checks,
+                    &req->out_data, &req->out_data_len);
+            break;
+        case EC_ASYNC_RECONSTRUCT:
+            req->status = liberasurecode_reconstruct_fragment(desc,
+                    req->available_fragments, req->num_fragments,
+                    req->fragment_len, req->destination_idx,
+                    req->out_fragment);
+            break;
+        default:
+            req->status = -EINVALIDPARAMS;
+            break;
+    }
+}
+
+static void *async_worker(void *arg)
+{
+    ec_async_queue_t queue = (ec_async_queue_t) arg;
+    struct ec_async_request *batch[ASYNC_BATCH_SIZE];
+    int num, i;
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (!queue->shutdown && 0 == queue->submitted.count) {
+            pthread_cond_wait(&queue->submit_cv, &queue->lock);
+        }
+        if (0 == queue->submitted.count) {
+            break;
+        }
+
+        /* Take a fair share of what is queued, so idle workers get some */
+        num = (queue->submitted.count + queue->num_workers - 1) /
+              queue->num_workers;
+        if (num > ASYNC_BATCH_SIZE) {
+            num = ASYNC_BATCH_SIZE;
+        }
+        for (i = 0; i < num; i++) {
+            batch[i] = ring_pop(&queue->submitted, queue->depth);
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        for (i = 0; i < num; i++) {
+            run_request(queue->desc, batch[i]);
+        }
+
+        if (queue->callback) {
+            /* Free the room first, so that callbacks can submit more */
+            pthread_mutex_lock(&queue->lock);
+            queue->outstanding -= num;
+            pthread_mutex_unlock(&queue->lock);
+            for (i = 0; i < num; i++) {
+                queue->callback(batch[i], queue->callback_arg);
+            }
+            pthread_mutex_lock(&queue->lock);
+        } else {
+            pthread_mutex_lock(&queue->lock);
+            for (i = 0; i < num; i++) {
+                ring_push(&queue->completed, queue->depth, batch[i]);
+            }
+            raise_event(queue);
+            pthread_cond_broadcast(&queue->complete_cv);
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*=~== Public API =~==~=*=~==~=*=~==~=*=~==~=*=~= */
+
+static void free_async_queue(ec_async_queue_t queue)
+{
+    close_event(queue);
+    pthread_cond_destroy(&queue->complete_cv);
+    pthread_cond_destroy(&queue->submit_cv);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->submitted.reqs);
+    free(queue->completed.reqs);
+    free(queue->workers);
+    free(queue);
+}
+
+/**
+ * Create a queue of asynchronous requests against an instance
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param num_workers - worker threads, 1 to LIBERASURECODE_ASYNC_MAX_WORKERS
+ * @param queue_depth - most outstanding requests, or 0 for
+ *        LIBERASURECODE_ASYNC_DEFAULT_DEPTH
+ * @param callback - completion callback, or NULL to reap completions
+ * @param callback_arg - passed to callback
+ * @param queue - _output_ queue
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_async_create(int desc, int num_workers, int queue_depth,
+        ec_async_callback_fn callback, void *callback_arg,
+        ec_async_queue_t *queue)
+{
+    ec_backend_t instance = NULL;
+    ec_async_queue_t new_queue = NULL;
+    int ret = 0, rc = 0;
+    int i;
+
+    if (NULL == queue) {
+        log_error("Pointer to queue output is null!");
+        return -EINVALIDPARAMS;
+    }
+    if (num_workers < 1 || num_workers > LIBERASURECODE_ASYNC_MAX_WORKERS) {
+        log_error("Invalid number of async workers %d", num_workers);
+        return -EINVALIDPARAMS;
+    }
+    if (0 == queue_depth) {
+        queue_depth = LIBERASURECODE_ASYNC_DEFAULT_DEPTH;
+    }
+    if (queue_depth < 1 || queue_depth > LIBERASURECODE_ASYNC_MAX_DEPTH) {
+        log_error("Invalid async queue depth %d", queue_depth);
+        return -EINVALIDPARAMS;
+    }
+
+    instance = liberasurecode_backend_instance_get(desc);
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+    liberasurecode_backend_instance_put(instance);
+
+    new_queue = calloc(1, sizeof(*new_queue));
+    if (NULL == new_queue) {
+        return -ENOMEM;
+    }
+    new_queue->desc = desc;
+    new_queue->callback = callback;
+    new_queue->callback_arg = callback_arg;
+    new_queue->depth = queue_depth;
+    new_queue->event_rfd = -1;
+    new_queue->event_wfd = -1;
+    pthread_mutex_init(&new_queue->lock, NULL);
+    pthread_cond_init(&new_queue->submit_cv, NULL);
+    pthread_cond_init(&new_queue->complete_cv, NULL);
+
+    new_queue->submitted.reqs = calloc(queue_depth, sizeof(void *));
+    new_queue->workers = calloc(num_workers, sizeof(pthread_t));
+    if (NULL == callback) {
+        new_queue->completed.reqs = calloc(queue_depth, sizeof(void *));
+    }
+    if (NULL == new_queue->submitted.reqs || NULL == new_queue->workers ||
+        (NULL == callback && NULL == new_queue->completed.reqs)) {
+        ret = -ENOMEM;
+        goto out;
+    }
+    if (NULL == callback) {
+        ret = open_event(new_queue);
+        if (ret < 0) {
+            log_error("Could not open the async completion event");
+            goto out;
+        }
+    }
+
+    /*
+     * Workers already running read num_workers under the lock, so it is
+     * updated there too; settle for fewer workers if some will not start
+     */
+    for (i = 0; i < num_workers; i++) {
+        rc = pthread_create(&new_queue->workers[i], NULL,
+                            async_worker, new_queue);
+        if (rc != 0) {
+            break;
+        }
+        pthread_mutex_lock(&new_queue->lock);
+        new_queue->num_workers++;
+        pthread_mutex_unlock(&new_queue->lock);
+    }
+    if (0 == new_queue->num_workers) {
+        log_error("Could not start async workers: %d", rc);
+        ret = -rc;
+        goto out;
+    }
+
+    *queue = new_queue;
+    new_queue = NULL;
+
+out:
+    if (new_queue) {
+        free_async_queue(new_queue);
+    }
+    return ret;
+}
+
+/**
+ * Finish every submitted request, then stop the workers and free the queue
+ *
+ * @param queue - queue from liberasurecode_async_create()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_async_destroy(ec_async_queue_t queue)
+{
+    int i;
+
+    if (NULL == queue) {
+        return -EINVALIDPARAMS;
+    }
+
+    /* The workers drain the submission ring before they see this */
+    pthread_mutex_lock(&queue->lock);
+    queue->shutdown = 1;
+    pthread_cond_broadcast(&queue->submit_cv);
+    pthread_mutex_unlock(&queue->lock);
+    for (i = 0; i < queue->num_workers; i++) {
+        pthread_join(queue->workers[i], NULL);
+    }
+
+    free_async_queue(queue);
+    return 0;
+}
+
+/**
+ * Queue requests without waiting for them
+ *
+ * @param queue - queue from liberasurecode_async_create()
+ * @param reqs - requests to submit
+ * @param num_reqs - number of requests in reqs
+ *
+ * @return number of requests queued, -EAGAIN if the queue is full,
+ *         -error code otherwise
+ */
+int liberasurecode_async_submit(ec_async_queue_t queue,
+        struct ec_async_request **reqs, int num_reqs)
+{
+    int num = 0;
+    int i;
+
+    if (NULL == queue || NULL == reqs || num_reqs < 1) {
+        return -EINVALIDPARAMS;
+    }
+    for (i = 0; i < num_reqs; i++) {
+        if (NULL == reqs[i] || reqs[i]->op < EC_ASYNC_ENCODE ||
+            reqs[i]->op > EC_ASYNC_RECONSTRUCT) {
+            log_error("Invalid async request %d", i);
+            return -EINVALIDPARAMS;
+        }
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    while (num < num_reqs && queue->outstanding < queue->depth) {
+        reqs[num]->status = 0;
+        ring_push(&queue->submitted, queue->depth, reqs[num]);
+        queue->outstanding++;
+        num++;
+    }
+    if (num > 1) {
+        pthread_cond_broadcast(&queue->submit_cv);
+    } else if (num) {
+        pthread_cond_signal(&queue->submit_cv);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return num ? num : -EAGAIN;
+}
+
+/**
+ * Descriptor that polls readable while completions are waiting to be reaped
+ *
+ * @param queue - queue from liberasurecode_async_create() without a
+ *        callback
+ *
+ * @return file descriptor, -error code otherwise
+ */
+int liberasurecode_async_get_eventfd(ec_async_queue_t queue)
+{
+    if (NULL == queue || queue->callback) {
+        return -EINVALIDPARAMS;
+    }
+    return queue->event_rfd;
+}
+
+/**
+ * Collect completed requests, oldest first
+ *
+ * @param queue - queue from liberasurecode_async_create() without a
+ *        callback
+ * @param reqs - _output_ array for up to max_reqs completed requests
+ * @param max_reqs - room in reqs
+ * @param min_reqs - completions to wait for; 0 to not block
+ *
+ * @return number of requests in reqs, -error code otherwise
+ */
+int liberasurecode_async_reap(ec_async_queue_t queue,
+        struct ec_async_request **reqs, int max_reqs, int min_reqs)
+{
+    int num = 0;
+
+    if (NULL == queue || queue->callback || NULL == reqs || max_reqs < 1 ||
+        min_reqs < 0) {
+        return -EINVALIDPARAMS;
+    }
+    if (min_reqs > max_reqs) {
+        min_reqs = max_reqs;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (num < max_reqs && queue->completed.count) {
+            reqs[num++] = ring_pop(&queue->completed, queue->depth);
+            queue->outstanding--;
+        }
+        if (0 == queue->completed.count) {
+            clear_event(queue);
+        }
+        /* Stop waiting once nothing else can complete */
+        if (num >= min_reqs || 0 == queue->outstanding) {
+            break;
+        }
+        pthread_cond_wait(&queue->complete_cv, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return num;
+}
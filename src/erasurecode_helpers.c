@@ -28,7 +28,6 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdarg.h>
-#include <zlib.h>
 #include "erasurecode_backend.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
@@ -36,6 +35,9 @@
 #include "erasurecode_version.h"
 
 #include "alg_sig.h"
+#include "crc32c.h"
+#include "md5_mb.h"
+#include "xxh3.h"
 #include "erasurecode_log.h"
 
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
@@ -174,6 +176,68 @@ uint64_t get_fragment_size(char *buf)
     return get_fragment_buffer_size(buf) + sizeof(fragment_header_t);
  }
 
+/**
+ * Return the Jerasure RS Cauchy packet size used for fragments of
+ * blocksize bytes.  A fixed packetsize is returned as is; in auto mode it
+ * is the largest power-of-two multiple of sizeof(long), up to the default,
+ * that evenly divides each of the w packets of a block.  Since encode and
+ * decode both derive it from the fragment size, it needs no metadata.
+ *
+ * @param packetsize - configured packet size or EC_CAUCHY_PACKETSIZE_AUTO
+ * @param w - word size, in bits
+ * @param blocksize - fragment payload size in bytes
+ * @return packet size in bytes
+ */
+int get_cauchy_packetsize(uint64_t packetsize, int w, int blocksize)
+{
+    int auto_packetsize = EC_CAUCHY_DEFAULT_PACKETSIZE;
+
+    if (EC_CAUCHY_PACKETSIZE_AUTO != packetsize) {
+        return (int) packetsize;
+    }
+
+    while (auto_packetsize > (int) sizeof(long) &&
+           blocksize % (w * auto_packetsize) != 0) {
+        auto_packetsize /= 2;
+    }
+
+    return auto_packetsize;
+}
+
+/*
+ * Packet size to align an object of data_len bytes to; in auto mode the
+ * largest one whose padding stays within the EC_CAUCHY_AUTO_PADDING_DIVISOR
+ * bound, or the smallest one if none does
+ */
+static int get_cauchy_align_packetsize(ec_backend_t instance, int data_len)
+{
+    uint64_t packetsize =
+        instance->args.uargs.priv_args1.jerasure_cauchy_args.packetsize;
+    int k = instance->args.uargs.k;
+    int w = instance->args.uargs.w;
+    int max_padding = data_len / EC_CAUCHY_AUTO_PADDING_DIVISOR;
+    int auto_packetsize;
+
+    if (0 == packetsize) {
+        return EC_CAUCHY_DEFAULT_PACKETSIZE;
+    }
+    if (EC_CAUCHY_PACKETSIZE_AUTO != packetsize) {
+        return (int) packetsize;
+    }
+
+    for (auto_packetsize = EC_CAUCHY_DEFAULT_PACKETSIZE;
+         auto_packetsize > (int) sizeof(long); auto_packetsize /= 2) {
+        int alignment_multiple = k * w * auto_packetsize;
+        int padding = (alignment_multiple - data_len % alignment_multiple)
+                      % alignment_multiple;
+        if (padding <= max_padding) {
+            break;
+        }
+    }
+
+    return auto_packetsize;
+}
+
 /**
  * Compute a size aligned to the number of data and the underlying wordsize 
  * of the EC algorithm.
@@ -195,7 +259,8 @@ int get_aligned_data_size(ec_backend_t instance, int data_len)
      * For Vandermonde reed-solomon and flat-XOR, align to k*word_size
      */
     if (EC_BACKEND_JERASURE_RS_CAUCHY == instance->common.id) {
-        alignment_multiple = k * w * (sizeof(long) * 128);
+        alignment_multiple = k * w *
+            get_cauchy_align_packetsize(instance, data_len);
     } else {
         alignment_multiple = k * word_size;
     }
@@ -206,6 +271,30 @@ int get_aligned_data_size(ec_backend_t instance, int data_len)
     return aligned_size;
 }
 
+/**
+ * Size of the CHKSUM_CRC32C_CHUNKED table for a blocksize-byte payload
+ * (0 for other checksum types)
+ */
+int get_chksum_table_size(ec_checksum_type_t ct, int blocksize)
+{
+    if (ct != CHKSUM_CRC32C_CHUNKED) {
+        return 0;
+    }
+    return sizeof(uint32_t) * ((blocksize + LIBERASURECODE_CHKSUM_CHUNK_SIZE
+                - 1) / LIBERASURECODE_CHKSUM_CHUNK_SIZE);
+}
+
+/**
+ * Bytes following the payload of each fragment: the backend's own metadata,
+ * then the checksum table, if any
+ */
+int get_fragment_metadata_size(ec_backend_t instance, int blocksize)
+{
+    return instance->common.ops->get_backend_metadata_size(
+                instance->desc.backend_desc, blocksize) +
+           get_chksum_table_size(instance->args.uargs.ct, blocksize);
+}
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
 char *get_data_ptr_from_fragment(char *buf)
@@ -459,12 +548,51 @@ int get_backend_version(char *buf, uint32_t *version)
 
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
-inline int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize)
+/**
+ * Return 1 if payload checksums of type ct can be computed a piece at a
+ * time with update_checksum()
+ */
+int is_incremental_checksum(ec_checksum_type_t ct)
+{
+    return ct == CHKSUM_CRC32 || ct == CHKSUM_CRC32C;
+}
+
+/**
+ * Continue a running payload checksum of type ct over len more bytes;
+ * start with chksum = 0.  Feeding a payload through in pieces gives the
+ * same value set_checksum() stores for it.
+ */
+uint32_t update_checksum(ec_checksum_type_t ct, uint32_t chksum,
+        const char *buf, int len)
 {
-    fragment_header_t* header = (fragment_header_t*) buf;
-    char *data = get_data_ptr_from_fragment(buf);
     char *flag;
 
+    switch(ct) {
+        case CHKSUM_CRC32:
+            flag = getenv("LIBERASURECODE_WRITE_LEGACY_CRC");
+            if (flag && !(flag[0] == '\0' || (flag[0] == '0' && flag[1] == '\0'))) {
+                return liberasurecode_crc32_alt(chksum, buf, len);
+            }
+            return liberasurecode_crc32(chksum, buf, len);
+        case CHKSUM_CRC32C:
+            return liberasurecode_crc32c(chksum, buf, len);
+        case CHKSUM_XXH3:
+        case CHKSUM_ALG_SIG:
+        case CHKSUM_CRC32C_CHUNKED:
+        case CHKSUM_MD5:
+        case CHKSUM_NONE:
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Store a payload checksum computed with update_checksum()
+ */
+int set_precomputed_checksum(ec_checksum_type_t ct, char *buf, uint32_t chksum)
+{
+    fragment_header_t* header = (fragment_header_t*) buf;
+
     assert(NULL != header);
     if (header->magic != LIBERASURECODE_FRAG_HEADER_MAGIC) {
         log_error("Invalid fragment header (set chksum)!\n");
@@ -473,24 +601,144 @@ inline int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize)
 
     header->meta.chksum_type = ct;
     header->meta.chksum_mismatch = 0;
-
-    switch(header->meta.chksum_type) {
-        case CHKSUM_CRC32:
-            flag = getenv("LIBERASURECODE_WRITE_LEGACY_CRC");
-            if (flag && !(flag[0] == '\0' || (flag[0] == '0' && flag[1] == '\0'))) {
-                header->meta.chksum[0] = liberasurecode_crc32_alt(0, data, blocksize);
-            } else {
-                header->meta.chksum[0] = crc32(0, (unsigned char *) data, blocksize);
-            }
-            break;
-        case CHKSUM_MD5:
-            break;
-        case CHKSUM_NONE:
-        default:
-            break;
+    if (is_incremental_checksum(ct)) {
+        header->meta.chksum[0] = chksum;
     }
-    
+
     return 0;
 }
 
+/**
+ * Store an MD5 digest as four little-endian words
+ */
+static int set_md5_checksum(char *buf, const unsigned char *digest)
+{
+    fragment_header_t* header = (fragment_header_t*) buf;
+    int i, ret;
+
+    ret = set_precomputed_checksum(CHKSUM_MD5, buf, 0);
+    if (0 == ret) {
+        for (i = 0; i < MD5_DIGEST_LEN / 4; i++) {
+            header->meta.chksum[i] = (uint32_t) digest[4 * i] |
+                    ((uint32_t) digest[4 * i + 1] << 8) |
+                    ((uint32_t) digest[4 * i + 2] << 16) |
+                    ((uint32_t) digest[4 * i + 3] << 24);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Fill in the CHKSUM_CRC32C_CHUNKED table, which sits at the end of the
+ * backend metadata, and store its CRC32C
+ */
+static int set_chunked_checksum(char *buf, int blocksize)
+{
+    fragment_header_t* header = (fragment_header_t*) buf;
+    char *data = get_data_ptr_from_fragment(buf);
+    int table_size = get_chksum_table_size(CHKSUM_CRC32C_CHUNKED, blocksize);
+    unsigned char *table;
+    uint32_t crc;
+    int offset, len, ret;
+
+    if (header->meta.frag_backend_metadata_size < table_size) {
+        log_error("No room for the checksum table!");
+        return -1;
+    }
+    table = (unsigned char *) data + blocksize +
+            header->meta.frag_backend_metadata_size - table_size;
+
+    for (offset = 0; offset < blocksize;
+         offset += LIBERASURECODE_CHKSUM_CHUNK_SIZE) {
+        len = blocksize - offset;
+        if (len > LIBERASURECODE_CHKSUM_CHUNK_SIZE) {
+            len = LIBERASURECODE_CHKSUM_CHUNK_SIZE;
+        }
+        crc = liberasurecode_crc32c(0, data + offset, len);
+        table[0] = crc;
+        table[1] = crc >> 8;
+        table[2] = crc >> 16;
+        table[3] = crc >> 24;
+        table += sizeof(uint32_t);
+    }
+
+    ret = set_precomputed_checksum(CHKSUM_CRC32C_CHUNKED, buf, 0);
+    if (0 == ret) {
+        header->meta.chksum[0] = liberasurecode_crc32c(0,
+                table - table_size, table_size);
+    }
+    return ret;
+}
+
+inline int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize)
+{
+    fragment_header_t* header = (fragment_header_t*) buf;
+    char *data = get_data_ptr_from_fragment(buf);
+    unsigned char digest[1][MD5_DIGEST_LEN];
+    uint64_t hash;
+    int ret;
+
+    if (ct == CHKSUM_MD5) {
+        liberasurecode_md5_mb((const char * const *) &data, 1, blocksize,
+                              digest);
+        return set_md5_checksum(buf, digest[0]);
+    }
+
+    if (ct == CHKSUM_XXH3) {
+        /* 64-bit hash, low word first */
+        hash = liberasurecode_xxh3_64(data, blocksize);
+        ret = set_precomputed_checksum(ct, buf, 0);
+        if (0 == ret) {
+            header->meta.chksum[0] = (uint32_t) hash;
+            header->meta.chksum[1] = (uint32_t) (hash >> 32);
+        }
+        return ret;
+    }
+
+    if (ct == CHKSUM_CRC32C_CHUNKED) {
+        return set_chunked_checksum(buf, blocksize);
+    }
+
+    if (ct == CHKSUM_ALG_SIG) {
+        ret = set_precomputed_checksum(ct, buf, 0);
+        if (0 == ret) {
+            header->meta.chksum[0] =
+                liberasurecode_alg_sig32(data, blocksize);
+        }
+        return ret;
+    }
+
+    return set_precomputed_checksum(ct, buf,
+            update_checksum(ct, 0, data, blocksize));
+}
+
+/**
+ * set_checksum() for each of num_fragments fragments with blocksize-byte
+ * payloads.  MD5 digests of the whole set are computed in one
+ * multi-buffer pass.
+ */
+int set_checksums(ec_checksum_type_t ct, char **fragments, int num_fragments,
+        int blocksize)
+{
+    const char *data[EC_MAX_FRAGMENTS] = { NULL };
+    unsigned char digests[EC_MAX_FRAGMENTS][MD5_DIGEST_LEN];
+    int i, ret = 0;
+
+    if (ct != CHKSUM_MD5 || num_fragments > EC_MAX_FRAGMENTS) {
+        for (i = 0; i < num_fragments && 0 == ret; i++) {
+            ret = set_checksum(ct, fragments[i], blocksize);
+        }
+        return ret;
+    }
+
+    for (i = 0; i < num_fragments; i++) {
+        data[i] = get_data_ptr_from_fragment(fragments[i]);
+    }
+    liberasurecode_md5_mb(data, num_fragments, blocksize, digests);
+    for (i = 0; i < num_fragments && 0 == ret; i++) {
+        ret = set_md5_checksum(fragments[i], digests[i]);
+    }
+    return ret;
+}
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
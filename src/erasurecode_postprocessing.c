@@ -26,7 +26,6 @@
  * vi: set noai tw=79 ts=4 sw=4:
  */
 
-#include <zlib.h>
 #include "erasurecode_backend.h"
 #include "erasurecode_helpers.h"
 #include "erasurecode_helpers_ext.h"
@@ -45,9 +44,8 @@ void add_fragment_metadata(ec_backend_t be, char *fragment,
     set_fragment_payload_size(fragment, blocksize);
     set_backend_id(fragment, be->common.id);
     set_backend_version(fragment, be->common.ec_backend_version);
-    set_fragment_backend_metadata_size(fragment, be->common.ops->get_backend_metadata_size(
-                                                    be->desc.backend_desc,
-                                                    blocksize));
+    set_fragment_backend_metadata_size(fragment,
+            get_fragment_metadata_size(be, blocksize));
 
     if (add_chksum) {
         set_checksum(ct, fragment, blocksize);
@@ -65,32 +63,54 @@ void add_fragment_metadata(ec_backend_t be, char *fragment,
         header->metadata_chksum = liberasurecode_crc32_alt(
             0, &header->meta, sizeof(fragment_metadata_t));
     } else {
-        header->metadata_chksum = crc32(0, (unsigned char *) &header->meta,
+        header->metadata_chksum = liberasurecode_crc32(0, &header->meta,
                                         sizeof(fragment_metadata_t));
     }
 }
 
 int finalize_fragments_after_encode(ec_backend_t instance,
         int k, int m, int blocksize, uint64_t orig_data_size,
-        char **encoded_data, char **encoded_parity)
+        char **encoded_data, char **encoded_parity,
+        const uint32_t *chksums)
 {
-    int i, set_chksum = 1;
+    char *fragments[EC_MAX_FRAGMENTS];
+    int i;
     ec_checksum_type_t ct = instance->args.uargs.ct;
 
-    /* finalize data fragments */
     for (i = 0; i < k; i++) {
-        char *fragment = get_fragment_ptr_from_data(encoded_data[i]);
-        add_fragment_metadata(instance, fragment, i, orig_data_size,
-                blocksize, ct, set_chksum);
-        encoded_data[i] = fragment;
+        fragments[i] = get_fragment_ptr_from_data(encoded_data[i]);
+    }
+    for (i = 0; i < m; i++) {
+        fragments[i + k] = get_fragment_ptr_from_data(encoded_parity[i]);
+    }
+
+    /* The checksum table, if any, is placed using the metadata size */
+    for (i = 0; i < k + m; i++) {
+        set_fragment_backend_metadata_size(fragments[i],
+                get_fragment_metadata_size(instance, blocksize));
+    }
+
+    /*
+     * chksums, if given, holds the k + m payload checksums from encode;
+     * otherwise checksum the whole stripe in one pass
+     */
+    if (NULL != chksums) {
+        for (i = 0; i < k + m; i++) {
+            set_precomputed_checksum(ct, fragments[i], chksums[i]);
+        }
+    } else {
+        set_checksums(ct, fragments, k + m, blocksize);
     }
 
-    /* finalize parity fragments */
+    for (i = 0; i < k + m; i++) {
+        add_fragment_metadata(instance, fragments[i], i, orig_data_size,
+                blocksize, ct, 0);
+    }
+    for (i = 0; i < k; i++) {
+        encoded_data[i] = fragments[i];
+    }
     for (i = 0; i < m; i++) {
-        char *fragment = get_fragment_ptr_from_data(encoded_parity[i]);
-        add_fragment_metadata(instance, fragment, i + k, orig_data_size,
-                blocksize, ct, set_chksum);
-        encoded_parity[i] = fragment;
+        encoded_parity[i] = fragments[i + k];
     }
 
     return 0;
@@ -32,13 +32,45 @@
 #include "erasurecode_log.h"
 #include "erasurecode_preprocessing.h"
 #include "erasurecode_stdinc.h"
+#include "md5_private.h"
+#include "xor_code.h"
+
+/*
+ * Copy len bytes into a data fragment payload in ENCODE_CHKSUM_CHUNK_SIZE
+ * pieces, feeding each piece to the running payload checksum (if chksum
+ * is given) and the object digest (if digest is given) while it is still
+ * in cache
+ */
+static void copy_and_checksum(ec_checksum_type_t ct, uint32_t *chksum,
+        MD5_CTX *digest, char *dst, const char *src, int len)
+{
+    if (NULL == chksum && NULL == digest) {
+        memcpy(dst, src, len);
+        return;
+    }
+
+    while (len > 0) {
+        int n = len > ENCODE_CHKSUM_CHUNK_SIZE ? ENCODE_CHKSUM_CHUNK_SIZE : len;
+        memcpy(dst, src, n);
+        if (NULL != chksum) {
+            *chksum = update_checksum(ct, *chksum, dst, n);
+        }
+        if (NULL != digest) {
+            MD5_Update(digest, dst, n);
+        }
+        dst += n;
+        src += n;
+        len -= n;
+    }
+}
 
 int prepare_fragments_for_encode(ec_backend_t instance,
         int k, int m,
         const char *orig_data, uint64_t orig_data_size, /* input */
         char **encoded_data, char **encoded_parity,     /* output */
-        int *blocksize)
+        int *blocksize, uint32_t *data_chksums, void *digest)
 {
+    ec_checksum_type_t ct = instance->args.uargs.ct;
     int i, ret = 0;
     int data_len;           /* data len to write to fragment headers */
     int aligned_data_len;   /* EC algorithm compatible data length */
@@ -55,7 +87,8 @@ int prepare_fragments_for_encode(ec_backend_t instance,
     data_offset = instance->common.ops->get_encode_offset(
                                     instance->desc.backend_desc,
                                     metadata_size);
-    buffer_size = payload_size + metadata_size;
+    buffer_size = payload_size + get_fragment_metadata_size(instance,
+                                                            *blocksize);
 
     for (i = 0; i < k; i++) {
         int copy_size = data_len > payload_size ? payload_size : data_len;
@@ -68,11 +101,27 @@ int prepare_fragments_for_encode(ec_backend_t instance,
         /* Copy existing data into clean, zero'd out buffer */
         encoded_data[i] = get_data_ptr_from_fragment(fragment);
       
-        if (data_len > 0) {
-            memcpy(encoded_data[i] + data_offset, orig_data, copy_size);
+        /* orig_data is NULL when the data is filled in later */
+        if (NULL != data_chksums) {
+            /* checksum the whole payload: offset, data, then zero padding */
+            int copied = 0;
+            uint32_t chksum = update_checksum(ct, 0, encoded_data[i],
+                                              data_offset);
+            if (data_len > 0 && NULL != orig_data) {
+                copy_and_checksum(ct, &chksum, digest,
+                        encoded_data[i] + data_offset, orig_data, copy_size);
+                orig_data += copy_size;
+                copied = copy_size;
+            }
+            data_chksums[i] = update_checksum(ct, chksum,
+                    encoded_data[i] + data_offset + copied,
+                    payload_size - data_offset - copied);
+        } else if (data_len > 0 && NULL != orig_data) {
+            copy_and_checksum(ct, NULL, digest,
+                    encoded_data[i] + data_offset, orig_data, copy_size);
+            orig_data += copy_size;
         }
 
-        orig_data += copy_size;
         data_len -= copy_size;
     }
 
@@ -150,7 +199,7 @@ int prepare_fragments_for_decode(
                 log_error("Could not allocate data buffer!");
                 return -ENOMEM;
             }
-            *realloc_bm = *realloc_bm | (1 << i);
+            *realloc_bm = *realloc_bm | (1ULL << i);
         } else if (!is_addr_aligned((unsigned long)data[i], 16)) {
             char *tmp_buf = alloc_fragment_buffer(fragment_size - sizeof(fragment_header_t));
             if (NULL == tmp_buf) {
@@ -159,11 +208,11 @@ int prepare_fragments_for_decode(
             }
             memcpy(tmp_buf, data[i], fragment_size);
             data[i] = tmp_buf;
-            *realloc_bm = *realloc_bm | (1 << i);
+            *realloc_bm = *realloc_bm | (1ULL << i);
         }
 
         /* Need to determine the size of the original data */
-       if (((missing_bm & (1 << i)) == 0) && orig_data_size < 0) {
+       if (((missing_bm & (1ULL << i)) == 0) && orig_data_size < 0) {
             orig_data_size = get_orig_data_size(data[i]);
             if (orig_data_size < 0) {
                 log_error("Invalid orig_data_size in fragment header!");
@@ -189,7 +238,7 @@ int prepare_fragments_for_decode(
                 log_error("Could not allocate parity buffer!");
                 return -ENOMEM;
             }
-            *realloc_bm = *realloc_bm | (1 << (k + i));
+            *realloc_bm = *realloc_bm | (1ULL << (k + i));
         } else if (!is_addr_aligned((unsigned long)parity[i], 16)) {
             char *tmp_buf = alloc_fragment_buffer(fragment_size-sizeof(fragment_header_t));
             if (NULL == tmp_buf) {
@@ -198,11 +247,11 @@ int prepare_fragments_for_decode(
             }
             memcpy(tmp_buf, parity[i], fragment_size);
             parity[i] = tmp_buf;
-            *realloc_bm = *realloc_bm | (1 << (k + i));
+            *realloc_bm = *realloc_bm | (1ULL << (k + i));
         }
 
        /* Need to determine the size of the original data */
-       if (((missing_bm & (1 << (k + i))) == 0) && orig_data_size < 0) {
+       if (((missing_bm & (1ULL << (k + i))) == 0) && orig_data_size < 0) {
             orig_data_size = get_orig_data_size(parity[i]);
             if (orig_data_size < 0) {
                 log_error("Invalid orig_data_size in fragment header!");
@@ -364,7 +413,7 @@ int fragments_to_string(int k, int m,
         char* fragment_data = get_data_ptr_from_fragment(data[i]);
         int fragment_size = get_fragment_payload_size(data[i]);
         int payload_size = orig_data_size > fragment_size ? fragment_size : orig_data_size;
-        memcpy(internal_payload + string_off, fragment_data, payload_size);
+        fast_memcpy(internal_payload + string_off, fragment_data, payload_size);
         orig_data_size -= payload_size;
         string_off += payload_size;
     }
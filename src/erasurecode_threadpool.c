@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "erasurecode_threadpool.h"
+
+struct ec_thread_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;         /* tasks available, or shutting down */
+    pthread_cond_t done_cv;         /* a worker finished the last task */
+    pthread_mutex_t run_lock;       /* held by the caller using the pool */
+
+    pthread_t *workers;
+    int num_workers;
+    int shutdown;
+    int refs;                       /* atomic; the last unref frees the pool */
+
+    /* The current batch, all under lock */
+    ec_thread_pool_task_fn fn;
+    void *arg;
+    int num_tasks;
+    int next_task;
+    int done_tasks;
+};
+
+static void *ec_thread_pool_worker(void *arg)
+{
+    ec_thread_pool_t pool = (ec_thread_pool_t) arg;
+    ec_thread_pool_task_fn fn;
+    void *fn_arg;
+    int task;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->next_task >= pool->num_tasks) {
+            pthread_cond_wait(&pool->work_cv, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        task = pool->next_task++;
+        fn = pool->fn;
+        fn_arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        fn(fn_arg, task);
+
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->done_tasks == pool->num_tasks) {
+            pthread_cond_signal(&pool->done_cv);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void ec_thread_pool_free(ec_thread_pool_t pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done_cv);
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_mutex_destroy(&pool->run_lock);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+ec_thread_pool_t ec_thread_pool_create(int num_threads)
+{
+    ec_thread_pool_t pool;
+    int i;
+
+    if (num_threads < 2 || num_threads > EC_THREAD_POOL_MAX_THREADS) {
+        return NULL;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    if (NULL == pool) {
+        return NULL;
+    }
+    pool->workers = calloc(num_threads - 1, sizeof(pthread_t));
+    if (NULL == pool->workers) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->done_cv, NULL);
+    pool->refs = 1;
+
+    for (i = 0; i < num_threads - 1; i++) {
+        if (pthread_create(&pool->workers[i], NULL,
+                           ec_thread_pool_worker, pool) != 0) {
+            break;
+        }
+        pool->num_workers++;
+    }
+    if (0 == pool->num_workers) {
+        ec_thread_pool_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void ec_thread_pool_ref(ec_thread_pool_t pool)
+{
+    __atomic_add_fetch(&pool->refs, 1, __ATOMIC_RELAXED);
+}
+
+void ec_thread_pool_unref(ec_thread_pool_t pool)
+{
+    if (NULL == pool) {
+        return;
+    }
+    if (__atomic_sub_fetch(&pool->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        ec_thread_pool_free(pool);
+    }
+}
+
+int ec_thread_pool_size(ec_thread_pool_t pool)
+{
+    return NULL == pool ? 1 : pool->num_workers + 1;
+}
+
+void ec_thread_pool_run(ec_thread_pool_t pool, int num_tasks,
+        ec_thread_pool_task_fn fn, void *arg)
+{
+    int task;
+
+    /*
+     * Another caller has the workers: running here beats waiting, since
+     * the cores are busy anyway
+     */
+    if (NULL == pool || num_tasks < 2 ||
+        pthread_mutex_trylock(&pool->run_lock) != 0) {
+        for (task = 0; task < num_tasks; task++) {
+            fn(arg, task);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->num_tasks = num_tasks;
+    pool->next_task = 0;
+    pool->done_tasks = 0;
+    pthread_cond_broadcast(&pool->work_cv);
+
+    while (pool->next_task < pool->num_tasks) {
+        task = pool->next_task++;
+        pthread_mutex_unlock(&pool->lock);
+        fn(arg, task);
+        pthread_mutex_lock(&pool->lock);
+        pool->done_tasks++;
+    }
+    while (pool->done_tasks < pool->num_tasks) {
+        pthread_cond_wait(&pool->done_cv, &pool->lock);
+    }
+    pool->num_tasks = 0;
+    pool->next_task = 0;
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->run_lock);
+}
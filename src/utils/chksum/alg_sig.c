@@ -22,412 +22,338 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <dlfcn.h>
+/*
+ * Algebraic signatures over GF(2^8) (polynomial 0x11d) and GF(2^16)
+ * (polynomial 0x1100b), the same fields Jerasure uses for w = 8 and 16.
+ *
+ * Horner's rule over the whole buffer is one long dependency chain, so the
+ * SSSE3 kernels split the buffer into ALG_SIG_LANES interleaved lanes:
+ * symbol i goes to lane i % ALG_SIG_LANES, each lane is run through
+ * Horner's rule with alpha^(c * ALG_SIG_LANES), and the lanes are folded
+ * together with alpha^c at the end.  With SSSE3 the per-lane multiply is a
+ * pair of pshufb nibble lookups per byte of symbol.
+ */
+
 #include <alg_sig.h>
-#include <stdio.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
-#define GALOIS_SINGLE_MULTIPLY "galois_single_multiply"
-#define GALOIS_UNINIT "galois_uninit_field"
 
-int valid_gf_w[] = { 8, 16, -1 };
-int valid_pairs[][2] = { { 8, 32}, {16, 32}, {16, 64}, {-1, -1} };
-
-galois_single_multiply_func get_galois_multi_func(void *handle) {
-    /*
-     * ISO C forbids casting a void* to a function pointer.
-     * Since dlsym return returns a void*, we use this union to
-     * "transform" the void* to a function pointer.
-     */
-    union {
-        galois_single_multiply_func fptr;
-        void *vptr;
-    } func_handle = {.vptr = NULL};
-    func_handle.vptr = dlsym(handle,  GALOIS_SINGLE_MULTIPLY);
-    return func_handle.fptr;
-}
-
-void stub_galois_uninit_field(int w){}
-
-galois_uninit_field_func get_galois_uninit_func(void *handle) {
-    /*
-     * ISO C forbids casting a void* to a function pointer.
-     * Since dlsym return returns a void*, we use this union to
-     * "transform" the void* to a function pointer.
-     */
-    union {
-        galois_uninit_field_func fptr;
-        void *vptr;
-    } func_handle = {.vptr = NULL};
-    func_handle.vptr = dlsym(handle,  GALOIS_UNINIT);
-    return func_handle.fptr;
-}
+#if defined(INTEL_SSSE3)
+#include <tmmintrin.h>
+#define ALG_SIG_SSSE3
+#endif
 
+int valid_pairs[][2] = { { 8, 32}, {16, 32}, {16, 64}, {-1, -1} };
 
-void *get_jerasure_sohandle()
+static int gf_mult(int x, int y, int w)
 {
-    return dlopen(JERASURE_SONAME, RTLD_LAZY | RTLD_LOCAL);
-}
+  int poly = (w == 8) ? 0x11d : 0x1100b;
+  int prod = 0;
 
-int load_gf_functions(void *sohandle, struct jerasure_mult_routines *routines)
-{
-    routines->galois_single_multiply = get_galois_multi_func(sohandle);
-    routines->galois_uninit_field = get_galois_uninit_func(sohandle);
-    if (NULL == routines->galois_single_multiply) {
-      return -1;
+  while (y) {
+    if (y & 1) {
+      prod ^= x;
     }
-    /**
-     * It is possible that the underlying Jerasure implementation
-     * is old (pre-jerasure.org).  If so, there is not an uninit
-     * function, so these tests will fail.
-     *
-     * Since nothing is using alg_sig at the moment, we stub the
-     * uninit function to unblock the tests.  Once we plug the internal
-     * GF functions into alg_sig, this can jsut go away.
-     */
-    if (NULL == routines->galois_uninit_field) {
-      routines->galois_uninit_field = &stub_galois_uninit_field;
+    y >>= 1;
+    x <<= 1;
+    if (x & (1 << w)) {
+      x ^= poly;
     }
-
-    return 0;
+  }
+  return prod;
 }
 
-static
-alg_sig_t *init_alg_sig_w8(void *jerasure_sohandle, int sig_len)
+/* x * alpha^c using the scalar split tables */
+static inline int mult_alpha(const alg_sig_t *h, int c, int x)
 {
-    alg_sig_t *alg_sig_handle;
-    int num_gf_lr_table_syms;
-    int i;
-    int w = 8;
-    int alpha = 2, beta = 4, gamma = 8;
-    int num_components = sig_len / w;
-
-    alg_sig_handle = (alg_sig_t *)malloc(sizeof(alg_sig_t));
-    if (NULL == alg_sig_handle) {
-      return NULL;
-    }
+  int half = h->gf_w >> 1;
 
-    alg_sig_handle->jerasure_sohandle = jerasure_sohandle;
+  return h->tbl_l[c - 1][x >> half] ^ h->tbl_r[c - 1][x & ((1 << half) - 1)];
+}
 
-    if (load_gf_functions(alg_sig_handle->jerasure_sohandle, &(alg_sig_handle->mult_routines)) < 0) {
-      free(alg_sig_handle);
-      return NULL;
-    }
+alg_sig_t *init_alg_sig(int sig_len, int gf_w)
+{
+  alg_sig_t *alg_sig_handle;
+  int num_components = sig_len / gf_w;
+  int half = gf_w >> 1;
+  int c, i, k, g, beta, p;
 
-    alg_sig_handle->sig_len = sig_len;
-    alg_sig_handle->gf_w = w;
+  for (i = 0; valid_pairs[i][0] > -1; i++) {
+    if (gf_w == valid_pairs[i][0] && sig_len == valid_pairs[i][1]) {
+      break;
+    }
+  }
+  if (valid_pairs[i][0] == -1) {
+    return NULL;
+  }
 
-    num_gf_lr_table_syms = 1 << (w >> 1);
+  alg_sig_handle = (alg_sig_t *)calloc(1, sizeof(alg_sig_t));
+  if (NULL == alg_sig_handle) {
+    return NULL;
+  }
+  alg_sig_handle->sig_len = sig_len;
+  alg_sig_handle->gf_w = gf_w;
+
+  /* Component 0 is a plain XOR; components 1..3 use alpha, alpha^2, alpha^3 */
+  for (c = 1; c < num_components; c++) {
+    g = 1 << c;
+    for (i = 0; i < (1 << half); i++) {
+      alg_sig_handle->tbl_l[c - 1][i] = gf_mult(i << half, g, gf_w);
+      alg_sig_handle->tbl_r[c - 1][i] = gf_mult(i, g, gf_w);
+    }
 
-    if (num_components >= 4) {
-      alg_sig_handle->tbl1_l = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl1_r = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl2_l = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl2_r = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl3_l = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl3_r = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
+    beta = 1;
+    for (i = 0; i < ALG_SIG_LANES; i++) {
+      beta = gf_mult(beta, g, gf_w);
     }
-    
-    /*
-     * Note that \alpha = 2 
-     * Note that \beta = 4 (\alpha ^ 2)
-     * Note that \gamme = 8 (\alpha ^ 3)
-     */
     for (i = 0; i < 16; i++) {
-      if (num_components >= 4) {
-        alg_sig_handle->tbl1_l[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned char)(i << 4) & 0xf0, alpha, w);
-        alg_sig_handle->tbl1_r[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned char) i, alpha, w);
-
-        alg_sig_handle->tbl2_l[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned char) (i << 4) & 0xf0, beta, w);
-        alg_sig_handle->tbl2_r[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned char) i, beta, w);
-      
-        alg_sig_handle->tbl3_l[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned char) (i << 4) & 0xf0, gamma, w);
-        alg_sig_handle->tbl3_r[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned char) i, gamma, w);
+      if (gf_w == 8) {
+        alg_sig_handle->vec_tbl[c - 1][0][i] = gf_mult(i, beta, 8);
+        alg_sig_handle->vec_tbl[c - 1][1][i] = gf_mult(i << 4, beta, 8);
+      } else {
+        /* product of each nibble of a 16-bit symbol, split by byte */
+        for (k = 0; k < 4; k++) {
+          p = gf_mult(i << (4 * k), beta, 16);
+          alg_sig_handle->vec_tbl[c - 1][k][i] = p & 0xff;
+          alg_sig_handle->vec_tbl[c - 1][4 + k][i] = p >> 8;
+        }
       }
     }
+  }
 
-    return alg_sig_handle;
+  return alg_sig_handle;
 }
 
-static
-alg_sig_t *init_alg_sig_w16(void *jerasure_sohandle, int sig_len)
+void destroy_alg_sig(alg_sig_t* alg_sig_handle)
 {
-    alg_sig_t *alg_sig_handle;
-    int num_gf_lr_table_syms;
-    int i;
-    int w = 16;
-    int alpha = 2, beta = 4, gamma = 8;
-    int num_components = sig_len / w;
-
-    if (NULL == jerasure_sohandle) {
-        return NULL;
-    }
-    
-    alg_sig_handle = (alg_sig_t *)malloc(sizeof(alg_sig_t));
-    if (NULL == alg_sig_handle) {
-      return NULL;
-    }
-
-    alg_sig_handle->jerasure_sohandle = jerasure_sohandle;
-
-    if (load_gf_functions(alg_sig_handle->jerasure_sohandle, &(alg_sig_handle->mult_routines)) < 0) {
-      free(alg_sig_handle);
-      return NULL;
-    }
+  free(alg_sig_handle);
+}
 
-    alg_sig_handle->sig_len = sig_len;
-    alg_sig_handle->gf_w = w;
+#ifdef ALG_SIG_SSSE3
 
-    num_gf_lr_table_syms = 1 << (w >> 1);
+/*
+ * Fold the per-lane Horner results into the signature:
+ * sig = sum(lane[r] * alpha^(c * r))
+ */
+static int fold_lanes(const alg_sig_t *h, int c, const int *lane)
+{
+  int r, sig = lane[ALG_SIG_LANES - 1];
 
-    if (num_components >= 2) {
-      alg_sig_handle->tbl1_l = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl1_r = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-    }
+  for (r = ALG_SIG_LANES - 2; r >= 0; r--) {
+    sig = (c == 0) ? sig ^ lane[r] : lane[r] ^ mult_alpha(h, c, sig);
+  }
+  return sig;
+}
 
-    if (num_components >= 4) {
-      alg_sig_handle->tbl2_l = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl2_r = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl3_l = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-      alg_sig_handle->tbl3_r = (int*)malloc(sizeof(int) * num_gf_lr_table_syms);
-    }
-    
-    /*
-     * Note that \alpha = 2 
-     * Note that \beta = 4 (\alpha ^ 2 MOD 2^16)
-     * Note that \gamme = 8 (\alpha ^ 3 MOD 2^16)
-     */
-    for (i = 0; i < 256; i++) {
-      alg_sig_handle->tbl1_l[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned short) (i << 8), alpha, w);
-      alg_sig_handle->tbl1_r[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned short) i, alpha, w);
-
-      if (num_components >= 4) {
-        alg_sig_handle->tbl2_l[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned short) (i << 8), beta, w);
-        alg_sig_handle->tbl2_r[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned short) i, beta, w);
-      
-        alg_sig_handle->tbl3_l[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned short) (i << 8), gamma, w);
-        alg_sig_handle->tbl3_r[i] = alg_sig_handle->mult_routines.galois_single_multiply((unsigned short) i, gamma, w);
-      }
-    }
+static inline __m128i mult_vec8(__m128i x, const unsigned char (*tbl)[16])
+{
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  __m128i lo = _mm_loadu_si128((const __m128i *) tbl[0]);
+  __m128i hi = _mm_loadu_si128((const __m128i *) tbl[1]);
 
-    return alg_sig_handle;
+  return _mm_xor_si128(
+      _mm_shuffle_epi8(lo, _mm_and_si128(x, mask)),
+      _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
 }
 
-alg_sig_t *init_alg_sig(int sig_len, int gf_w)
+/* Component signatures of len bytes of GF(2^8) symbols */
+static void alg_sig_w8(const alg_sig_t *h, const unsigned char *buf, int len,
+                       int num_components, int *sig)
 {
-  int i=0;
-  void *jerasure_sohandle = get_jerasure_sohandle();
-
-  if (NULL == jerasure_sohandle) {
-    fprintf (stderr, "Could not open Jerasure backend.  Install Jerasure or fix LD_LIBRARY_PATH.  Passing.\n");
-    return NULL;
+  unsigned char tail[ALG_SIG_LANES] = { 0 };
+  unsigned char out[ALG_SIG_LANES];
+  __m128i acc[4], d;
+  int lane[ALG_SIG_LANES];
+  int nblocks = (len + ALG_SIG_LANES - 1) / ALG_SIG_LANES;
+  int c, q, r;
+
+  for (c = 0; c < num_components; c++) {
+    acc[c] = _mm_setzero_si128();
   }
 
-  while (valid_pairs[i][0] > -1) {
-    if (gf_w == valid_pairs[i][0] && 
-        sig_len == valid_pairs[i][1]) {
-      break;
+  /* Horner's rule runs from the last block back to the first */
+  for (q = nblocks - 1; q >= 0; q--) {
+    if ((q + 1) * ALG_SIG_LANES > len) {
+      memcpy(tail, buf + q * ALG_SIG_LANES, len - q * ALG_SIG_LANES);
+      d = _mm_loadu_si128((const __m128i *) tail);
+    } else {
+      d = _mm_loadu_si128((const __m128i *) (buf + q * ALG_SIG_LANES));
+    }
+    acc[0] = _mm_xor_si128(acc[0], d);
+    for (c = 1; c < num_components; c++) {
+      acc[c] = _mm_xor_si128(mult_vec8(acc[c], h->vec_tbl[c - 1]), d);
     }
-    i++;
-  }
-
-  if (valid_pairs[i][0] == -1) {
-    return NULL;
   }
 
-  if (gf_w == 8) {
-    return init_alg_sig_w8(jerasure_sohandle, sig_len);
-  } else if (gf_w == 16) {
-    return init_alg_sig_w16(jerasure_sohandle, sig_len);
+  for (c = 0; c < num_components; c++) {
+    _mm_storeu_si128((__m128i *) out, acc[c]);
+    for (r = 0; r < ALG_SIG_LANES; r++) {
+      lane[r] = out[r];
+    }
+    sig[c] = fold_lanes(h, c, lane);
   }
-  return NULL;
 }
 
-void destroy_alg_sig(alg_sig_t* alg_sig_handle)
+static inline void mult_vec16(__m128i *lo, __m128i *hi,
+                              const unsigned char (*tbl)[16])
 {
-  if (alg_sig_handle == NULL) {
-    return;
-  }
-  if (alg_sig_handle->gf_w == 0) {
-    free(alg_sig_handle);
-    return;
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  __m128i n[4];
+  __m128i new_lo = _mm_setzero_si128();
+  __m128i new_hi = _mm_setzero_si128();
+  int k;
+
+  n[0] = _mm_and_si128(*lo, mask);
+  n[1] = _mm_and_si128(_mm_srli_epi64(*lo, 4), mask);
+  n[2] = _mm_and_si128(*hi, mask);
+  n[3] = _mm_and_si128(_mm_srli_epi64(*hi, 4), mask);
+  for (k = 0; k < 4; k++) {
+    new_lo = _mm_xor_si128(new_lo, _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *) tbl[k]), n[k]));
+    new_hi = _mm_xor_si128(new_hi, _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *) tbl[4 + k]), n[k]));
   }
-
-  alg_sig_handle->mult_routines.galois_uninit_field(alg_sig_handle->gf_w);
-  dlclose(alg_sig_handle->jerasure_sohandle);
-
-  int num_components = alg_sig_handle->sig_len / alg_sig_handle->gf_w;
-
-  free(alg_sig_handle->tbl1_l);
-  free(alg_sig_handle->tbl1_r);
-  if (num_components >= 4) {
-    free(alg_sig_handle->tbl2_l);
-    free(alg_sig_handle->tbl2_r);
-    free(alg_sig_handle->tbl3_l);
-    free(alg_sig_handle->tbl3_r);
-  }
-
-  free(alg_sig_handle);
+  *lo = new_lo;
+  *hi = new_hi;
 }
 
-
-static
-int compute_w8_alg_sig_32(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig)
+/*
+ * Component signatures of len bytes of little-endian GF(2^16) symbols; an
+ * odd trailing byte is the low half of a final symbol.  The lanes are kept
+ * split into a vector of low bytes and a vector of high bytes.
+ */
+static void alg_sig_w16(const alg_sig_t *h, const unsigned char *buf, int len,
+                        int num_components, int *sig)
 {
-  int i;
-
-  if (len == 0) {
-    bzero(sig, 4);
-    return 0;
+  const int block = 2 * ALG_SIG_LANES;
+  const __m128i low_byte = _mm_set1_epi16(0x00ff);
+  unsigned char tail[2 * ALG_SIG_LANES];
+  unsigned char out_lo[ALG_SIG_LANES], out_hi[ALG_SIG_LANES];
+  __m128i acc_lo[4], acc_hi[4], v0, v1, d_lo, d_hi;
+  int lane[ALG_SIG_LANES];
+  int nblocks = (len + block - 1) / block;
+  const unsigned char *p;
+  int c, q, r;
+
+  for (c = 0; c < num_components; c++) {
+    acc_lo[c] = _mm_setzero_si128();
+    acc_hi[c] = _mm_setzero_si128();
   }
 
-  sig[0] = buf[len-1];
-  sig[1] = buf[len-1];
-  sig[2] = buf[len-1];
-  sig[3] = buf[len-1];
-
-  /**
-   * This is the loop to optimize.  It is currently optimized enough : using Horner's alg.,
-   * shortened mult. tables, and other tricks.
-   */
-  for (i = len - 2; i >= 0; i--) {
-      sig[0] ^= buf[i];
-      sig[1] = (buf[i] ^ (alg_sig_handle->tbl1_l[(sig[1] >> 4) & 0x0f] ^ alg_sig_handle->tbl1_r[sig[1] & 0x0f]));
-      sig[2] = (buf[i] ^ (alg_sig_handle->tbl2_l[(sig[2] >> 4) & 0x0f] ^ alg_sig_handle->tbl2_r[sig[2] & 0x0f]));
-      sig[3] = (buf[i] ^ (alg_sig_handle->tbl3_l[(sig[3] >> 4) & 0x0f] ^ alg_sig_handle->tbl3_r[sig[3] & 0x0f]));
+  for (q = nblocks - 1; q >= 0; q--) {
+    p = buf + q * block;
+    if ((q + 1) * block > len) {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, p, len - q * block);
+      p = tail;
+    }
+    v0 = _mm_loadu_si128((const __m128i *) p);
+    v1 = _mm_loadu_si128((const __m128i *) (p + 16));
+    d_lo = _mm_packus_epi16(_mm_and_si128(v0, low_byte),
+                            _mm_and_si128(v1, low_byte));
+    d_hi = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+
+    acc_lo[0] = _mm_xor_si128(acc_lo[0], d_lo);
+    acc_hi[0] = _mm_xor_si128(acc_hi[0], d_hi);
+    for (c = 1; c < num_components; c++) {
+      mult_vec16(&acc_lo[c], &acc_hi[c], h->vec_tbl[c - 1]);
+      acc_lo[c] = _mm_xor_si128(acc_lo[c], d_lo);
+      acc_hi[c] = _mm_xor_si128(acc_hi[c], d_hi);
+    }
   }
 
-  return 0;
+  for (c = 0; c < num_components; c++) {
+    _mm_storeu_si128((__m128i *) out_lo, acc_lo[c]);
+    _mm_storeu_si128((__m128i *) out_hi, acc_hi[c]);
+    for (r = 0; r < ALG_SIG_LANES; r++) {
+      lane[r] = out_lo[r] | (out_hi[r] << 8);
+    }
+    sig[c] = fold_lanes(h, c, lane);
+  }
 }
 
-static
-int compute_w16_alg_sig_64(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig)
-{
-  int bit_mask;
-  int adj_len = len / 2;
-  int i;
-  unsigned short *_buf = (unsigned short *)buf;
-  unsigned short sig_buf[4];
-
-  if (len == 0) {
-    bzero(sig, 8);
-    return 0;
-  }
+#else /* !ALG_SIG_SSSE3 */
 
-  switch (len % 2) {
-      case 1:
-          bit_mask = 0x00ff;
-          break;
-      default:
-          bit_mask = 0xffff;
-          break;
-  }
+static void alg_sig_w8(const alg_sig_t *h, const unsigned char *buf, int len,
+                       int num_components, int *sig)
+{
+  int c, i;
 
-  if (len % 2 > 0) {
-      adj_len++;
+  /* Plain Horner's rule */
+  for (c = 0; c < num_components; c++) {
+    sig[c] = 0;
   }
-
-  // Account for buffer not being uint16_t aligned
-  sig_buf[0] = (_buf[adj_len - 1] & bit_mask);
-  sig_buf[1] = (_buf[adj_len - 1] & bit_mask);
-  sig_buf[2] = (_buf[adj_len - 1] & bit_mask);
-  sig_buf[3] = (_buf[adj_len - 1] & bit_mask);
-
-  /**
-   * This is the loop to optimize.  It is currently optimized enough : using Horner's alg.,
-   * shortened mult. tables, and other tricks.
-   */
-  for (i = adj_len - 2; i >= 0; i--) {
-      sig_buf[0] ^= _buf[i];
-      sig_buf[1] = (_buf[i] ^ (alg_sig_handle->tbl1_l[(sig_buf[1] >> 8) & 0x00ff] ^ alg_sig_handle->tbl1_r[sig_buf[1] & 0x00ff]));
-      sig_buf[2] = (_buf[i] ^ (alg_sig_handle->tbl2_l[(sig_buf[2] >> 8) & 0x00ff] ^ alg_sig_handle->tbl2_r[sig_buf[2] & 0x00ff]));
-      sig_buf[3] = (_buf[i] ^ (alg_sig_handle->tbl3_l[(sig_buf[3] >> 8) & 0x00ff] ^ alg_sig_handle->tbl3_r[sig_buf[3] & 0x00ff]));
+  for (i = len - 1; i >= 0; i--) {
+    sig[0] ^= buf[i];
+    for (c = 1; c < num_components; c++) {
+      sig[c] = buf[i] ^ mult_alpha(h, c, sig[c]);
+    }
   }
-
-  sig[0] = (char) (sig_buf[0] & 0x000ff);
-  sig[1] = (char) ((sig_buf[0] >> 8) & 0x000ff);
-  sig[2] = (char) (sig_buf[1] & 0x00ff);
-  sig[3] = (char) ((sig_buf[1] >> 8) & 0x00ff);
-  sig[4] = (char) (sig_buf[2] & 0x00ff);
-  sig[5] = (char) ((sig_buf[2] >> 8) & 0x00ff);
-  sig[6] = (char) (sig_buf[3] & 0x00ff);
-  sig[7] = (char) ((sig_buf[3] >> 8) & 0x00ff);
-  return 0;
 }
 
-static
-int compute_w16_alg_sig_32(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig)
+static void alg_sig_w16(const alg_sig_t *h, const unsigned char *buf, int len,
+                        int num_components, int *sig)
 {
-  int bit_mask;
-  int adj_len = len / 2;
-  int i;
-  unsigned short *_buf = (unsigned short *)buf;
-  unsigned short sig_buf[2];
-
-  if (len == 0) {
-    bzero(sig, 8);
-    return 0;
-  }
+  int c, i;
 
-  switch (len % 2) {
-      case 1:
-          bit_mask = 0x00ff;
-          break;
-      default:
-          bit_mask = 0xffff;
-          break;
+  /* Horner's rule over little-endian 16-bit symbols */
+  for (c = 0; c < num_components; c++) {
+    sig[c] = 0;
   }
-
-  if (len % 2 > 0) {
-      adj_len++;
-  }
-
-  // Account for buffer not being uint16_t aligned
-  sig_buf[0] = (_buf[adj_len - 1] & bit_mask);
-  sig_buf[1] = (_buf[adj_len - 1] & bit_mask);
-
-  /**
-   * This is the loop to optimize.  It is currently optimized enough : using Horner's alg.,
-   * shortened mult. tables, and other tricks.
-   */
-  for (i = adj_len - 2; i >= 0; i--) {
-      sig_buf[0] ^= _buf[i];
-      sig_buf[1] = (_buf[i] ^ (alg_sig_handle->tbl1_l[(sig_buf[1] >> 8) & 0x00ff] ^ alg_sig_handle->tbl1_r[sig_buf[1] & 0x00ff]));
+  for (i = ((len + 1) & ~1) - 2; i >= 0; i -= 2) {
+    int d = buf[i] | ((i + 1 < len) ? buf[i + 1] << 8 : 0);
+    sig[0] ^= d;
+    for (c = 1; c < num_components; c++) {
+      sig[c] = d ^ mult_alpha(h, c, sig[c]);
+    }
   }
-
-  sig[0] = (char) (sig_buf[0] & 0x000ff);
-  sig[1] = (char) ((sig_buf[0] >> 8) & 0x000ff);
-  sig[2] = (char) (sig_buf[1] & 0x00ff);
-  sig[3] = (char) ((sig_buf[1] >> 8) & 0x00ff);
-  return 0;
 }
 
-static
-int compute_alg_sig_32(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig)
+#endif /* ALG_SIG_SSSE3 */
+
+int compute_alg_sig(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig)
 {
+  int num_components = alg_sig_handle->sig_len / alg_sig_handle->gf_w;
+  int comp[4];
+  int c;
+
   if (alg_sig_handle->gf_w == 8) {
-    return compute_w8_alg_sig_32(alg_sig_handle, buf, len, sig);
+    alg_sig_w8(alg_sig_handle, (unsigned char *) buf, len,
+               num_components, comp);
+    for (c = 0; c < num_components; c++) {
+      sig[c] = (char) comp[c];
+    }
   } else if (alg_sig_handle->gf_w == 16) {
-    return compute_w16_alg_sig_32(alg_sig_handle, buf, len, sig);
+    alg_sig_w16(alg_sig_handle, (unsigned char *) buf, len,
+                num_components, comp);
+    for (c = 0; c < num_components; c++) {
+      sig[2 * c] = (char) (comp[c] & 0xff);
+      sig[2 * c + 1] = (char) (comp[c] >> 8);
+    }
+  } else {
+    return -1;
   }
-  return -1;
+  return 0;
 }
 
-static
-int compute_alg_sig_64(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig)
+static pthread_once_t alg_sig32_once = PTHREAD_ONCE_INIT;
+static alg_sig_t *alg_sig32_handle;
+
+static void alg_sig32_init(void)
 {
-  if (alg_sig_handle->gf_w == 16) {
-    return compute_w16_alg_sig_64(alg_sig_handle, buf, len, sig);
-  }
-  return -1;
+  alg_sig32_handle = init_alg_sig(32, 8);
 }
 
-int compute_alg_sig(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig)
+uint32_t liberasurecode_alg_sig32(const void *buf, int len)
 {
-  if (alg_sig_handle->sig_len == 32) {
-    return compute_alg_sig_32(alg_sig_handle, buf, len, sig);
-  } else if (alg_sig_handle->sig_len == 64) {
-    return compute_alg_sig_64(alg_sig_handle, buf, len, sig);
+  unsigned char sig[4];
+
+  pthread_once(&alg_sig32_once, alg_sig32_init);
+  if (NULL == alg_sig32_handle) {
+    return 0;
   }
-  return -1;
+  compute_alg_sig(alg_sig32_handle, (char *) buf, len, (char *) sig);
+  return (uint32_t) sig[0] | ((uint32_t) sig[1] << 8) |
+         ((uint32_t) sig[2] << 16) | ((uint32_t) sig[3] << 24);
 }
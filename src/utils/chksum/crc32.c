@@ -41,6 +41,17 @@
  */
 
 #include <sys/param.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#if defined(INTEL_PCLMUL) && defined(__x86_64__)
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define CRC32_CLMUL
+#endif
 
 static int crc32_tab[] = {
   0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -88,17 +99,187 @@ static int crc32_tab[] = {
   0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+/*
+ * The "alternative" CRC below shifts the (signed) crc arithmetically, so
+ * bit 31 is smeared over the top byte on every step.  That is still linear
+ * over GF(2), so it can be sliced like a normal CRC: crc32_alt_slice[k][v]
+ * is byte v followed by k zero bytes.  The one difference is the top byte
+ * of the incoming crc, whose sign bit does not behave like data; its effect
+ * over a full 16-byte slice is kept separately in crc32_alt_top.
+ */
+#define CRC32_ALT_SLICE 16
+
+static pthread_once_t crc32_alt_once = PTHREAD_ONCE_INIT;
+static uint32_t crc32_alt_slice[CRC32_ALT_SLICE][256];
+static uint32_t crc32_alt_top[256];
+
+static inline uint32_t
+crc32_alt_step(uint32_t crc, unsigned char c)
+{
+  return (uint32_t) crc32_tab[(crc ^ c) & 0xFF] ^ (crc >> 8) ^
+         ((crc & 0x80000000) ? 0xFF000000 : 0);
+}
+
+static void
+crc32_alt_init(void)
+{
+  uint32_t crc;
+  int i, k;
+
+  for (i = 0; i < 256; i++) {
+    crc32_alt_slice[0][i] = (uint32_t) crc32_tab[i];
+    for (k = 1; k < CRC32_ALT_SLICE; k++) {
+      crc32_alt_slice[k][i] = crc32_alt_step(crc32_alt_slice[k - 1][i], 0);
+    }
+    crc = (uint32_t) i << 24;
+    for (k = 0; k < CRC32_ALT_SLICE; k++) {
+      crc = crc32_alt_step(crc, 0);
+    }
+    crc32_alt_top[i] = crc;
+  }
+}
+
 int
 liberasurecode_crc32_alt(int crc, const void *buf, size_t size)
 {
-  const char *p;
+  const unsigned char *p = buf;
+  uint32_t c = (uint32_t) crc ^ ~0U;
 
-  p = buf;
-  crc = crc ^ ~0U;
+  pthread_once(&crc32_alt_once, crc32_alt_init);
 
+  while (size >= CRC32_ALT_SLICE) {
+    c = crc32_alt_slice[15][(c ^ p[0]) & 0xFF] ^
+        crc32_alt_slice[14][((c >> 8) ^ p[1]) & 0xFF] ^
+        crc32_alt_slice[13][((c >> 16) ^ p[2]) & 0xFF] ^
+        crc32_alt_top[c >> 24] ^
+        crc32_alt_slice[12][p[3]] ^
+        crc32_alt_slice[11][p[4]] ^
+        crc32_alt_slice[10][p[5]] ^
+        crc32_alt_slice[9][p[6]] ^
+        crc32_alt_slice[8][p[7]] ^
+        crc32_alt_slice[7][p[8]] ^
+        crc32_alt_slice[6][p[9]] ^
+        crc32_alt_slice[5][p[10]] ^
+        crc32_alt_slice[4][p[11]] ^
+        crc32_alt_slice[3][p[12]] ^
+        crc32_alt_slice[2][p[13]] ^
+        crc32_alt_slice[1][p[14]] ^
+        crc32_alt_slice[0][p[15]];
+    p += CRC32_ALT_SLICE;
+    size -= CRC32_ALT_SLICE;
+  }
   while (size--)
-    crc = crc32_tab[(crc ^ *p++) & 0xFF] ^
-            ((((crc >> 8) & 0x00FFFFFF) ^ 0x00800000) - 0x00800000);
+    c = crc32_alt_step(c, *p++);
+
+  return (int) (c ^ ~0U);
+}
+
+#ifdef CRC32_CLMUL
+/*
+ * Fold 64-byte blocks with carry-less multiplies and Barrett-reduce the
+ * result ("Fast CRC Computation for Generic Polynomials Using PCLMULQDQ",
+ * Intel, 2009).  crc is the raw (pre-inverted) register; len must be a
+ * multiple of 16 and at least 64.
+ */
+static uint32_t
+crc32_clmul(uint32_t crc, const unsigned char *p, size_t len)
+{
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x1, x2, x3, x4, t1, t2, t3, t4;
+
+  x1 = _mm_loadu_si128((const __m128i *) (p + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *) (p + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *) (p + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *) (p + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+  p += 64;
+  len -= 64;
+
+  /* Four independent 128-bit lanes, each folded forward 512 bits */
+  while (len >= 64) {
+    t1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    t2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    t3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    t4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, t1),
+                       _mm_loadu_si128((const __m128i *) (p + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, t2),
+                       _mm_loadu_si128((const __m128i *) (p + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, t3),
+                       _mm_loadu_si128((const __m128i *) (p + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, t4),
+                       _mm_loadu_si128((const __m128i *) (p + 0x30)));
+    p += 64;
+    len -= 64;
+  }
+
+  /* Fold the four lanes into one, then any remaining 16-byte blocks */
+  t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), t1);
+  t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), t1);
+  t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), t1);
+
+  while (len >= 16) {
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *) p)),
+                       t1);
+    p += 16;
+    len -= 16;
+  }
+
+  /* 128 -> 64 bits */
+  t1 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t1);
+  t1 = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00);
+  x1 = _mm_xor_si128(x1, t1);
+
+  /* Barrett reduction to 32 bits */
+  t1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+  t1 = _mm_clmulepi64_si128(_mm_and_si128(t1, mask32), poly, 0x00);
+  x1 = _mm_xor_si128(x1, t1);
+
+  return (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif
+
+/*
+ * Same result as zlib's crc32(); with PCLMULQDQ the bulk of the buffer is
+ * folded in-tree and zlib only sees the last few bytes.
+ */
+uint32_t
+liberasurecode_crc32(uint32_t crc, const void *buf, size_t size)
+{
+  const unsigned char *p = buf;
+
+#ifdef CRC32_CLMUL
+  if (size >= 64) {
+    size_t chunk = size & ~(size_t) 15;
+
+    crc = ~crc32_clmul(~crc, p, chunk);
+    p += chunk;
+    size -= chunk;
+  }
+#endif
 
-  return crc ^ ~0U;
+  while (size > UINT_MAX) {
+    crc = crc32(crc, p, UINT_MAX);
+    p += UINT_MAX;
+    size -= UINT_MAX;
+  }
+  return crc32(crc, p, (uInt) size);
 }
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CRC-32C (Castagnoli polynomial 0x1EDC6F41, reflected 0x82F63B78).
+ *
+ * With SSE4.2 the crc32 instruction is used on three independent streams
+ * at once to hide its 3-cycle latency; the three partial CRCs are then
+ * combined by multiplying by x^(8 * stream length) mod P, with PCLMULQDQ
+ * when available.  Otherwise a portable slicing-by-8 table walk is used.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "crc32c.h"
+
+#if defined(INTEL_SSE42) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_HW
+#if defined(INTEL_PCLMUL)
+#include <wmmintrin.h>
+#define CRC32C_CLMUL
+#endif
+#endif
+
+#define CRC32C_POLY 0x82f63b78
+
+/* Bytes per stream for the interleaved hardware loops */
+#define CRC32C_LONG   8192
+#define CRC32C_SHORT  256
+
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+#ifdef CRC32C_HW
+
+#ifdef CRC32C_CLMUL
+/*
+ * x^(8 * CRC32C_LONG) and x^(8 * CRC32C_SHORT) mod P, less the 33 bits
+ * picked up by the clmul + crc32 reduction
+ */
+static uint64_t crc32c_long_k;
+static uint64_t crc32c_short_k;
+#else
+/* x^(8 * CRC32C_LONG) and x^(8 * CRC32C_SHORT) mod P */
+static uint32_t crc32c_long_k;
+static uint32_t crc32c_short_k;
+#endif
+
+/* x^n mod P, in the reflected bit order (bit 31 is x^0) */
+static uint32_t crc32c_xpow(unsigned int n)
+{
+    uint32_t p = 1U << 31;
+
+    while (n--) {
+        p = (p & 1) ? (p >> 1) ^ CRC32C_POLY : p >> 1;
+    }
+    return p;
+}
+
+#ifndef CRC32C_CLMUL
+/* a * b mod P, in the reflected bit order */
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1U << 31;
+    uint32_t p = 0;
+
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+#endif
+
+static void crc32c_init(void)
+{
+#ifdef CRC32C_CLMUL
+    crc32c_long_k = crc32c_xpow(8 * CRC32C_LONG - 33);
+    crc32c_short_k = crc32c_xpow(8 * CRC32C_SHORT - 33);
+#else
+    crc32c_long_k = crc32c_xpow(8 * CRC32C_LONG);
+    crc32c_short_k = crc32c_xpow(8 * CRC32C_SHORT);
+#endif
+}
+
+/* Advance crc over len zero bytes, given k = x^(8 * len) mod P */
+#ifdef CRC32C_CLMUL
+static inline uint32_t crc32c_shift(uint32_t crc, uint64_t clmul_k)
+{
+    __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc),
+                                        _mm_cvtsi64_si128(clmul_k), 0);
+
+    return (uint32_t) _mm_crc32_u64(0, _mm_cvtsi128_si64(prod));
+}
+#define CRC32C_LONG_SHIFT(crc)  crc32c_shift(crc, crc32c_long_k)
+#define CRC32C_SHORT_SHIFT(crc) crc32c_shift(crc, crc32c_short_k)
+#else
+#define CRC32C_LONG_SHIFT(crc)  crc32c_multmodp(crc32c_long_k, crc)
+#define CRC32C_SHORT_SHIFT(crc) crc32c_multmodp(crc32c_short_k, crc)
+#endif
+
+static inline uint64_t load64(const unsigned char *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Three streams of stream_len bytes each, starting at *p */
+#define CRC32C_INTERLEAVED(stream_len, SHIFT)                                 \
+    while (len >= 3 * (stream_len)) {                                         \
+        const unsigned char *end = p + (stream_len);                          \
+        uint64_t crc1 = 0, crc2 = 0;                                          \
+        do {                                                                  \
+            crc0 = _mm_crc32_u64(crc0, load64(p));                            \
+            crc1 = _mm_crc32_u64(crc1, load64(p + (stream_len)));             \
+            crc2 = _mm_crc32_u64(crc2, load64(p + 2 * (stream_len)));         \
+            p += 8;                                                           \
+        } while (p < end);                                                    \
+        crc0 = SHIFT((uint32_t) crc0) ^ crc1;                                 \
+        crc0 = SHIFT((uint32_t) crc0) ^ crc2;                                 \
+        p += 2 * (stream_len);                                                \
+        len -= 3 * (stream_len);                                              \
+    }
+
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len)
+{
+    uint64_t crc0 = crc;
+
+    while (len && ((uintptr_t) p & 7)) {
+        crc0 = _mm_crc32_u8((uint32_t) crc0, *p++);
+        len--;
+    }
+
+    CRC32C_INTERLEAVED(CRC32C_LONG, CRC32C_LONG_SHIFT)
+    CRC32C_INTERLEAVED(CRC32C_SHORT, CRC32C_SHORT_SHIFT)
+
+    while (len >= 8) {
+        crc0 = _mm_crc32_u64(crc0, load64(p));
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc0 = _mm_crc32_u8((uint32_t) crc0, *p++);
+    }
+    return (uint32_t) crc0;
+}
+
+#else /* !CRC32C_HW */
+
+static uint32_t crc32c_table[8][256];
+
+static void crc32c_init(void)
+{
+    uint32_t crc;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[0][i] = crc;
+    }
+    for (i = 0; i < 256; i++) {
+        crc = crc32c_table[0][i];
+        for (j = 1; j < 8; j++) {
+            crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+            crc32c_table[j][i] = crc;
+        }
+    }
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len)
+{
+    while (len >= 8) {
+        crc ^= (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+               ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+        crc = crc32c_table[7][crc & 0xff] ^
+              crc32c_table[6][(crc >> 8) & 0xff] ^
+              crc32c_table[5][(crc >> 16) & 0xff] ^
+              crc32c_table[4][crc >> 24] ^
+              crc32c_table[3][p[4]] ^
+              crc32c_table[2][p[5]] ^
+              crc32c_table[1][p[6]] ^
+              crc32c_table[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#endif /* CRC32C_HW */
+
+uint32_t liberasurecode_crc32c(uint32_t crc, const void *buf, size_t size)
+{
+    pthread_once(&crc32c_once, crc32c_init);
+
+#ifdef CRC32C_HW
+    return ~crc32c_hw(~crc, buf, size);
+#else
+    return ~crc32c_sw(~crc, buf, size);
+#endif
+}
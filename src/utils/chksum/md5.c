@@ -39,7 +39,7 @@
 
 #include <string.h>
 
-#include "md5.h"
+#include "md5_private.h"
 
 /*
  * The basic MD5 functions.
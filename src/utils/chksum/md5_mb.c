@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Multi-buffer MD5.  An encoded stripe is k + m buffers of the same
+ * length, so rather than hash them one after another the SSE2 path runs
+ * four of them in lockstep, one per 32-bit lane: each 64-byte block is
+ * loaded from the four buffers and transposed so that vector j holds
+ * message word j of every lane.  Short groups are padded out with a
+ * repeat of the first buffer whose digest is thrown away.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "md5_private.h"
+#include "md5_mb.h"
+
+#if defined(INTEL_SSE2)
+#include <emmintrin.h>
+#define MD5_MB_SSE2
+#endif
+
+#ifdef MD5_MB_SSE2
+
+#define MD5_MB_LANES 4
+#define MD5_BLOCK_LEN 64
+
+#define MD5_F(x, y, z) \
+    _mm_xor_si128((z), _mm_and_si128((x), _mm_xor_si128((y), (z))))
+#define MD5_G(x, y, z) \
+    _mm_xor_si128((y), _mm_and_si128((z), _mm_xor_si128((x), (y))))
+#define MD5_H(x, y, z) \
+    _mm_xor_si128(_mm_xor_si128((x), (y)), (z))
+#define MD5_I(x, y, z) \
+    _mm_xor_si128((y), _mm_or_si128((x), _mm_xor_si128((z), ones)))
+
+#define MD5_STEP(f, a, b, c, d, x, t, s)                                      \
+    (a) = _mm_add_epi32((a), _mm_add_epi32(f((b), (c), (d)),                  \
+            _mm_add_epi32(w[(x)], _mm_set1_epi32((int) (t)))));               \
+    (a) = _mm_or_si128(_mm_slli_epi32((a), (s)),                              \
+                       _mm_srli_epi32((a), 32 - (s)));                        \
+    (a) = _mm_add_epi32((a), (b));
+
+/* Load one 64-byte block from each lane as 16 vectors of message words */
+static inline void md5_mb_load(__m128i *w, const unsigned char **p)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        __m128i r0 = _mm_loadu_si128((const __m128i *) (p[0] + 16 * i));
+        __m128i r1 = _mm_loadu_si128((const __m128i *) (p[1] + 16 * i));
+        __m128i r2 = _mm_loadu_si128((const __m128i *) (p[2] + 16 * i));
+        __m128i r3 = _mm_loadu_si128((const __m128i *) (p[3] + 16 * i));
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+        w[4 * i + 0] = _mm_unpacklo_epi64(t0, t1);
+        w[4 * i + 1] = _mm_unpackhi_epi64(t0, t1);
+        w[4 * i + 2] = _mm_unpacklo_epi64(t2, t3);
+        w[4 * i + 3] = _mm_unpackhi_epi64(t2, t3);
+    }
+}
+
+static void md5_mb_block(__m128i *state, const unsigned char **p)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+    __m128i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m128i w[16];
+
+    md5_mb_load(w, p);
+
+    MD5_STEP(MD5_F, a, b, c, d, 0, 0xd76aa478, 7)
+    MD5_STEP(MD5_F, d, a, b, c, 1, 0xe8c7b756, 12)
+    MD5_STEP(MD5_F, c, d, a, b, 2, 0x242070db, 17)
+    MD5_STEP(MD5_F, b, c, d, a, 3, 0xc1bdceee, 22)
+    MD5_STEP(MD5_F, a, b, c, d, 4, 0xf57c0faf, 7)
+    MD5_STEP(MD5_F, d, a, b, c, 5, 0x4787c62a, 12)
+    MD5_STEP(MD5_F, c, d, a, b, 6, 0xa8304613, 17)
+    MD5_STEP(MD5_F, b, c, d, a, 7, 0xfd469501, 22)
+    MD5_STEP(MD5_F, a, b, c, d, 8, 0x698098d8, 7)
+    MD5_STEP(MD5_F, d, a, b, c, 9, 0x8b44f7af, 12)
+    MD5_STEP(MD5_F, c, d, a, b, 10, 0xffff5bb1, 17)
+    MD5_STEP(MD5_F, b, c, d, a, 11, 0x895cd7be, 22)
+    MD5_STEP(MD5_F, a, b, c, d, 12, 0x6b901122, 7)
+    MD5_STEP(MD5_F, d, a, b, c, 13, 0xfd987193, 12)
+    MD5_STEP(MD5_F, c, d, a, b, 14, 0xa679438e, 17)
+    MD5_STEP(MD5_F, b, c, d, a, 15, 0x49b40821, 22)
+
+    MD5_STEP(MD5_G, a, b, c, d, 1, 0xf61e2562, 5)
+    MD5_STEP(MD5_G, d, a, b, c, 6, 0xc040b340, 9)
+    MD5_STEP(MD5_G, c, d, a, b, 11, 0x265e5a51, 14)
+    MD5_STEP(MD5_G, b, c, d, a, 0, 0xe9b6c7aa, 20)
+    MD5_STEP(MD5_G, a, b, c, d, 5, 0xd62f105d, 5)
+    MD5_STEP(MD5_G, d, a, b, c, 10, 0x02441453, 9)
+    MD5_STEP(MD5_G, c, d, a, b, 15, 0xd8a1e681, 14)
+    MD5_STEP(MD5_G, b, c, d, a, 4, 0xe7d3fbc8, 20)
+    MD5_STEP(MD5_G, a, b, c, d, 9, 0x21e1cde6, 5)
+    MD5_STEP(MD5_G, d, a, b, c, 14, 0xc33707d6, 9)
+    MD5_STEP(MD5_G, c, d, a, b, 3, 0xf4d50d87, 14)
+    MD5_STEP(MD5_G, b, c, d, a, 8, 0x455a14ed, 20)
+    MD5_STEP(MD5_G, a, b, c, d, 13, 0xa9e3e905, 5)
+    MD5_STEP(MD5_G, d, a, b, c, 2, 0xfcefa3f8, 9)
+    MD5_STEP(MD5_G, c, d, a, b, 7, 0x676f02d9, 14)
+    MD5_STEP(MD5_G, b, c, d, a, 12, 0x8d2a4c8a, 20)
+
+    MD5_STEP(MD5_H, a, b, c, d, 5, 0xfffa3942, 4)
+    MD5_STEP(MD5_H, d, a, b, c, 8, 0x8771f681, 11)
+    MD5_STEP(MD5_H, c, d, a, b, 11, 0x6d9d6122, 16)
+    MD5_STEP(MD5_H, b, c, d, a, 14, 0xfde5380c, 23)
+    MD5_STEP(MD5_H, a, b, c, d, 1, 0xa4beea44, 4)
+    MD5_STEP(MD5_H, d, a, b, c, 4, 0x4bdecfa9, 11)
+    MD5_STEP(MD5_H, c, d, a, b, 7, 0xf6bb4b60, 16)
+    MD5_STEP(MD5_H, b, c, d, a, 10, 0xbebfbc70, 23)
+    MD5_STEP(MD5_H, a, b, c, d, 13, 0x289b7ec6, 4)
+    MD5_STEP(MD5_H, d, a, b, c, 0, 0xeaa127fa, 11)
+    MD5_STEP(MD5_H, c, d, a, b, 3, 0xd4ef3085, 16)
+    MD5_STEP(MD5_H, b, c, d, a, 6, 0x04881d05, 23)
+    MD5_STEP(MD5_H, a, b, c, d, 9, 0xd9d4d039, 4)
+    MD5_STEP(MD5_H, d, a, b, c, 12, 0xe6db99e5, 11)
+    MD5_STEP(MD5_H, c, d, a, b, 15, 0x1fa27cf8, 16)
+    MD5_STEP(MD5_H, b, c, d, a, 2, 0xc4ac5665, 23)
+
+    MD5_STEP(MD5_I, a, b, c, d, 0, 0xf4292244, 6)
+    MD5_STEP(MD5_I, d, a, b, c, 7, 0x432aff97, 10)
+    MD5_STEP(MD5_I, c, d, a, b, 14, 0xab9423a7, 15)
+    MD5_STEP(MD5_I, b, c, d, a, 5, 0xfc93a039, 21)
+    MD5_STEP(MD5_I, a, b, c, d, 12, 0x655b59c3, 6)
+    MD5_STEP(MD5_I, d, a, b, c, 3, 0x8f0ccc92, 10)
+    MD5_STEP(MD5_I, c, d, a, b, 10, 0xffeff47d, 15)
+    MD5_STEP(MD5_I, b, c, d, a, 1, 0x85845dd1, 21)
+    MD5_STEP(MD5_I, a, b, c, d, 8, 0x6fa87e4f, 6)
+    MD5_STEP(MD5_I, d, a, b, c, 15, 0xfe2ce6e0, 10)
+    MD5_STEP(MD5_I, c, d, a, b, 6, 0xa3014314, 15)
+    MD5_STEP(MD5_I, b, c, d, a, 13, 0x4e0811a1, 21)
+    MD5_STEP(MD5_I, a, b, c, d, 4, 0xf7537e82, 6)
+    MD5_STEP(MD5_I, d, a, b, c, 11, 0xbd3af235, 10)
+    MD5_STEP(MD5_I, c, d, a, b, 2, 0x2ad7d2bb, 15)
+    MD5_STEP(MD5_I, b, c, d, a, 9, 0xeb86d391, 21)
+
+    state[0] = _mm_add_epi32(state[0], a);
+    state[1] = _mm_add_epi32(state[1], b);
+    state[2] = _mm_add_epi32(state[2], c);
+    state[3] = _mm_add_epi32(state[3], d);
+}
+
+/* Hash up to MD5_MB_LANES buffers of len bytes in parallel */
+static void md5_mb_lanes(const char * const *bufs, int num_bufs, size_t len,
+        unsigned char digests[][MD5_DIGEST_LEN])
+{
+    unsigned char tail[MD5_MB_LANES][2 * MD5_BLOCK_LEN];
+    const unsigned char *p[MD5_MB_LANES];
+    uint32_t words[4][MD5_MB_LANES];
+    __m128i state[4];
+    size_t nblocks = len / MD5_BLOCK_LEN;
+    size_t rem = len % MD5_BLOCK_LEN;
+    size_t tail_len = (rem < MD5_BLOCK_LEN - 8) ? MD5_BLOCK_LEN :
+                                                  2 * MD5_BLOCK_LEN;
+    uint64_t bits = (uint64_t) len << 3;
+    size_t i;
+    int j, lane;
+
+    state[0] = _mm_set1_epi32(0x67452301);
+    state[1] = _mm_set1_epi32((int) 0xefcdab89);
+    state[2] = _mm_set1_epi32((int) 0x98badcfe);
+    state[3] = _mm_set1_epi32(0x10325476);
+
+    for (lane = 0; lane < MD5_MB_LANES; lane++) {
+        p[lane] = (const unsigned char *) bufs[lane < num_bufs ? lane : 0];
+    }
+    for (i = 0; i < nblocks; i++) {
+        md5_mb_block(state, p);
+        for (lane = 0; lane < MD5_MB_LANES; lane++) {
+            p[lane] += MD5_BLOCK_LEN;
+        }
+    }
+
+    /* Whatever is left, the 0x80 terminator and the bit length */
+    for (lane = 0; lane < MD5_MB_LANES; lane++) {
+        memcpy(tail[lane], p[lane], rem);
+        tail[lane][rem] = 0x80;
+        memset(tail[lane] + rem + 1, 0, tail_len - rem - 1 - 8);
+        for (j = 0; j < 8; j++) {
+            tail[lane][tail_len - 8 + j] = (unsigned char) (bits >> (8 * j));
+        }
+        p[lane] = tail[lane];
+    }
+    for (i = 0; i < tail_len; i += MD5_BLOCK_LEN) {
+        md5_mb_block(state, p);
+        for (lane = 0; lane < MD5_MB_LANES; lane++) {
+            p[lane] += MD5_BLOCK_LEN;
+        }
+    }
+
+    for (j = 0; j < 4; j++) {
+        _mm_storeu_si128((__m128i *) words[j], state[j]);
+    }
+    for (lane = 0; lane < num_bufs; lane++) {
+        for (j = 0; j < MD5_DIGEST_LEN; j++) {
+            digests[lane][j] =
+                (unsigned char) (words[j / 4][lane] >> (8 * (j % 4)));
+        }
+    }
+}
+
+void liberasurecode_md5_mb(const char * const *bufs, int num_bufs,
+        size_t len, unsigned char digests[][MD5_DIGEST_LEN])
+{
+    int i, n;
+
+    for (i = 0; i < num_bufs; i += MD5_MB_LANES) {
+        n = num_bufs - i < MD5_MB_LANES ? num_bufs - i : MD5_MB_LANES;
+        md5_mb_lanes(bufs + i, n, len, digests + i);
+    }
+}
+
+#else /* !MD5_MB_SSE2 */
+
+void liberasurecode_md5_mb(const char * const *bufs, int num_bufs,
+        size_t len, unsigned char digests[][MD5_DIGEST_LEN])
+{
+    MD5_CTX ctx;
+    int i;
+
+    for (i = 0; i < num_bufs; i++) {
+        MD5_Init(&ctx);
+        MD5_Update(&ctx, (void *) bufs[i], len);
+        MD5_Final(digests[i], &ctx);
+    }
+}
+
+#endif /* MD5_MB_SSE2 */
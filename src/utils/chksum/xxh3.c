@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * XXH3-64 (xxHash 0.8), default secret, seed 0.
+ *
+ * Inputs up to 240 bytes go through the scalar short-input paths.  Longer
+ * inputs are consumed in 64-byte stripes by eight 64-bit accumulators;
+ * with SSE2 each stripe is processed four lanes at a time with pmuludq,
+ * otherwise with plain 32x32->64 multiplies.
+ */
+
+#include <string.h>
+
+#include "xxh3.h"
+
+#if defined(INTEL_SSE2)
+#include <emmintrin.h>
+#define XXH3_SSE2
+#endif
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH3_SECRET_SIZE        192
+#define XXH3_STRIPE_LEN         64
+#define XXH3_SECRET_CONSUME     8
+#define XXH3_STRIPES_PER_BLOCK  \
+    ((XXH3_SECRET_SIZE - XXH3_STRIPE_LEN) / XXH3_SECRET_CONSUME)
+#define XXH3_BLOCK_LEN          (XXH3_STRIPE_LEN * XXH3_STRIPES_PER_BLOCK)
+#define XXH3_MIDSIZE_MAX        240
+#define XXH3_MIDSIZE_START      3
+#define XXH3_MIDSIZE_LAST       (136 - 17)
+
+static const unsigned char xxh3_secret[XXH3_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe,
+    0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78,
+    0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e,
+    0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e,
+    0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f,
+    0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3,
+    0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49,
+    0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28,
+    0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/* xxHash is defined on little-endian loads */
+static inline uint32_t read32(const unsigned char *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+           ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint64_t read64(const unsigned char *p)
+{
+    return (uint64_t) read32(p) | ((uint64_t) read32(p + 4) << 32);
+}
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t bswap64(uint64_t x)
+{
+    return __builtin_bswap64(x);
+}
+
+/* 64x64->128 multiply, folded to 64 bits by xoring the two halves */
+static inline uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 product = (unsigned __int128) lhs * rhs;
+
+    return (uint64_t) product ^ (uint64_t) (product >> 64);
+#else
+    uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+    uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+    uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+    uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+
+    return lower ^ upper;
+#endif
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XXH_PRIME_MX2;
+    h ^= h >> 28;
+    return h;
+}
+
+static uint64_t xxh3_len_0to16(const unsigned char *in, size_t len)
+{
+    const unsigned char *s = xxh3_secret;
+
+    if (len > 8) {
+        uint64_t lo = read64(in) ^ (read64(s + 24) ^ read64(s + 32));
+        uint64_t hi = read64(in + len - 8) ^ (read64(s + 40) ^ read64(s + 48));
+        uint64_t acc = len + bswap64(lo) + hi + mul128_fold64(lo, hi);
+
+        return xxh3_avalanche(acc);
+    }
+    if (len >= 4) {
+        uint64_t input64 = read32(in + len - 4) + ((uint64_t) read32(in) << 32);
+        uint64_t bitflip = read64(s + 8) ^ read64(s + 16);
+
+        return xxh3_rrmxmx(input64 ^ bitflip, len);
+    }
+    if (len > 0) {
+        uint32_t combined = ((uint32_t) in[0] << 16) |
+                            ((uint32_t) in[len >> 1] << 24) |
+                            (uint32_t) in[len - 1] | ((uint32_t) len << 8);
+        uint64_t bitflip = read32(s) ^ read32(s + 4);
+
+        return xxh64_avalanche((uint64_t) combined ^ bitflip);
+    }
+    return xxh64_avalanche(read64(s + 56) ^ read64(s + 64));
+}
+
+static inline uint64_t xxh3_mix16(const unsigned char *in,
+                                  const unsigned char *s)
+{
+    return mul128_fold64(read64(in) ^ read64(s), read64(in + 8) ^ read64(s + 8));
+}
+
+static uint64_t xxh3_len_17to128(const unsigned char *in, size_t len)
+{
+    const unsigned char *s = xxh3_secret;
+    uint64_t acc = len * XXH_PRIME64_1;
+
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += xxh3_mix16(in + 48, s + 96);
+                acc += xxh3_mix16(in + len - 64, s + 112);
+            }
+            acc += xxh3_mix16(in + 32, s + 64);
+            acc += xxh3_mix16(in + len - 48, s + 80);
+        }
+        acc += xxh3_mix16(in + 16, s + 32);
+        acc += xxh3_mix16(in + len - 32, s + 48);
+    }
+    acc += xxh3_mix16(in, s);
+    acc += xxh3_mix16(in + len - 16, s + 16);
+
+    return xxh3_avalanche(acc);
+}
+
+static uint64_t xxh3_len_129to240(const unsigned char *in, size_t len)
+{
+    const unsigned char *s = xxh3_secret;
+    uint64_t acc = len * XXH_PRIME64_1;
+    uint64_t acc_end;
+    size_t i;
+
+    for (i = 0; i < 8; i++) {
+        acc += xxh3_mix16(in + 16 * i, s + 16 * i);
+    }
+    acc = xxh3_avalanche(acc);
+
+    acc_end = xxh3_mix16(in + len - 16, s + XXH3_MIDSIZE_LAST);
+    for (i = 8; i < len / 16; i++) {
+        acc_end += xxh3_mix16(in + 16 * i, s + 16 * (i - 8) + XXH3_MIDSIZE_START);
+    }
+    return xxh3_avalanche(acc + acc_end);
+}
+
+#ifdef XXH3_SSE2
+
+static inline void xxh3_accumulate_512(uint64_t *acc, const unsigned char *in,
+                                       const unsigned char *s)
+{
+    __m128i *xacc = (__m128i *) acc;
+    int i;
+
+    for (i = 0; i < XXH3_STRIPE_LEN / 16; i++) {
+        __m128i acc_vec = _mm_loadu_si128(xacc + i);
+        __m128i data_vec = _mm_loadu_si128((const __m128i *) (in + 16 * i));
+        __m128i key_vec = _mm_loadu_si128((const __m128i *) (s + 16 * i));
+        __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+        __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+        __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+
+        acc_vec = _mm_add_epi64(acc_vec, _mm_add_epi64(product, data_swap));
+        _mm_storeu_si128(xacc + i, acc_vec);
+    }
+}
+
+static inline void xxh3_scramble(uint64_t *acc, const unsigned char *s)
+{
+    const __m128i prime32 = _mm_set1_epi32((int) XXH_PRIME32_1);
+    __m128i *xacc = (__m128i *) acc;
+    int i;
+
+    for (i = 0; i < XXH3_STRIPE_LEN / 16; i++) {
+        __m128i key_vec = _mm_loadu_si128((const __m128i *) (s + 16 * i));
+        __m128i acc_vec = _mm_loadu_si128(xacc + i);
+        __m128i data_key;
+        __m128i data_key_hi;
+        __m128i prod_lo;
+        __m128i prod_hi;
+
+        acc_vec = _mm_xor_si128(acc_vec, _mm_srli_epi64(acc_vec, 47));
+        data_key = _mm_xor_si128(acc_vec, key_vec);
+        data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+        prod_lo = _mm_mul_epu32(data_key, prime32);
+        prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+        _mm_storeu_si128(xacc + i, _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+    }
+}
+
+#else /* !XXH3_SSE2 */
+
+static inline void xxh3_accumulate_512(uint64_t *acc, const unsigned char *in,
+                                       const unsigned char *s)
+{
+    int i;
+
+    for (i = 0; i < XXH3_STRIPE_LEN / 8; i++) {
+        uint64_t data_val = read64(in + 8 * i);
+        uint64_t data_key = data_val ^ read64(s + 8 * i);
+
+        acc[i ^ 1] += data_val;
+        acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+    }
+}
+
+static inline void xxh3_scramble(uint64_t *acc, const unsigned char *s)
+{
+    int i;
+
+    for (i = 0; i < XXH3_STRIPE_LEN / 8; i++) {
+        uint64_t a = acc[i];
+
+        a ^= a >> 47;
+        a ^= read64(s + 8 * i);
+        a *= XXH_PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+#endif /* XXH3_SSE2 */
+
+static void xxh3_accumulate(uint64_t *acc, const unsigned char *in,
+                            size_t nb_stripes)
+{
+    size_t n;
+
+    for (n = 0; n < nb_stripes; n++) {
+        xxh3_accumulate_512(acc, in + n * XXH3_STRIPE_LEN,
+                            xxh3_secret + n * XXH3_SECRET_CONSUME);
+    }
+}
+
+static uint64_t xxh3_hash_long(const unsigned char *in, size_t len)
+{
+    uint64_t acc[8] = {
+        XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+        XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1
+    };
+    const unsigned char *s = xxh3_secret;
+    size_t nb_blocks = (len - 1) / XXH3_BLOCK_LEN;
+    size_t nb_stripes;
+    uint64_t result;
+    size_t n;
+    int i;
+
+    for (n = 0; n < nb_blocks; n++) {
+        xxh3_accumulate(acc, in + n * XXH3_BLOCK_LEN, XXH3_STRIPES_PER_BLOCK);
+        xxh3_scramble(acc, s + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN);
+    }
+
+    /* Partial last block, then the final (possibly overlapping) stripe */
+    nb_stripes = ((len - 1) - XXH3_BLOCK_LEN * nb_blocks) / XXH3_STRIPE_LEN;
+    xxh3_accumulate(acc, in + nb_blocks * XXH3_BLOCK_LEN, nb_stripes);
+    xxh3_accumulate_512(acc, in + len - XXH3_STRIPE_LEN,
+                        s + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN - 7);
+
+    result = len * XXH_PRIME64_1;
+    for (i = 0; i < 4; i++) {
+        result += mul128_fold64(acc[2 * i] ^ read64(s + 11 + 16 * i),
+                                acc[2 * i + 1] ^ read64(s + 11 + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+uint64_t liberasurecode_xxh3_64(const void *buf, size_t size)
+{
+    const unsigned char *in = buf;
+
+    if (size <= 16) {
+        return xxh3_len_0to16(in, size);
+    }
+    if (size <= 128) {
+        return xxh3_len_17to128(in, size);
+    }
+    if (size <= XXH3_MIDSIZE_MAX) {
+        return xxh3_len_129to240(in, size);
+    }
+    return xxh3_hash_long(in, size);
+}
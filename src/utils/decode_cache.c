@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2026, liberasurecode authors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "erasurecode_decode_cache.h"
+#include "erasurecode_helpers.h"
+
+int ec_decode_cache_init(ec_decode_cache_t *cache, int capacity,
+        ec_decode_cache_build_fn build_entry,
+        ec_decode_cache_free_fn free_entry, void *desc)
+{
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        return -1;
+    }
+    SLIST_INIT(&cache->entries);
+    cache->size = 0;
+    cache->capacity = capacity;
+    cache->build_entry = build_entry;
+    cache->free_entry = free_entry;
+    cache->desc = desc;
+    return 0;
+}
+
+void ec_decode_cache_destroy(ec_decode_cache_t *cache)
+{
+    while (!SLIST_EMPTY(&cache->entries)) {
+        struct ec_decode_cache_entry *entry = SLIST_FIRST(&cache->entries);
+        SLIST_REMOVE_HEAD(&cache->entries, link);
+        cache->free_entry(entry);
+    }
+    cache->size = 0;
+    pthread_mutex_destroy(&cache->lock);
+}
+
+/* Find the entry for a pattern and take a reference on it; lock held */
+static struct ec_decode_cache_entry *lookup(ec_decode_cache_t *cache,
+        uint64_t missing_bm, uint64_t target_bm)
+{
+    struct ec_decode_cache_entry *entry;
+
+    SLIST_FOREACH(entry, &cache->entries, link) {
+        if (entry->missing_bm == missing_bm &&
+            entry->target_bm == target_bm) {
+            break;
+        }
+    }
+    if (NULL != entry) {
+        if (entry != SLIST_FIRST(&cache->entries)) {
+            SLIST_REMOVE(&cache->entries, entry, ec_decode_cache_entry, link);
+            SLIST_INSERT_HEAD(&cache->entries, entry, link);
+        }
+        entry->refcount++;
+    }
+    return entry;
+}
+
+struct ec_decode_cache_entry *ec_decode_cache_get(ec_decode_cache_t *cache,
+        int *missing_idxs, uint64_t target_bm)
+{
+    uint64_t missing_bm = convert_list_to_bitmap(missing_idxs);
+    struct ec_decode_cache_entry *entry = NULL;
+    struct ec_decode_cache_entry *built = NULL;
+    struct ec_decode_cache_entry *evicted = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = lookup(cache, missing_bm, target_bm);
+    pthread_mutex_unlock(&cache->lock);
+
+    if (NULL != entry) {
+        return entry;
+    }
+
+    built = cache->build_entry(cache->desc, missing_idxs, missing_bm,
+                               target_bm);
+    if (NULL == built) {
+        return NULL;
+    }
+    built->missing_bm = missing_bm;
+    built->target_bm = target_bm;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = lookup(cache, missing_bm, target_bm);
+    if (NULL == entry) {
+        entry = built;
+        built = NULL;
+        if (cache->size == cache->capacity) {
+            /* Evict the least recently used entry (the tail) */
+            evicted = SLIST_FIRST(&cache->entries);
+            while (NULL != SLIST_NEXT(evicted, link)) {
+                evicted = SLIST_NEXT(evicted, link);
+            }
+            SLIST_REMOVE(&cache->entries, evicted, ec_decode_cache_entry,
+                         link);
+            cache->size--;
+            if (--evicted->refcount > 0) {
+                evicted = NULL;
+            }
+        }
+        SLIST_INSERT_HEAD(&cache->entries, entry, link);
+        cache->size++;
+        entry->refcount = 2;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (NULL != built) {
+        cache->free_entry(built);
+    }
+    if (NULL != evicted) {
+        cache->free_entry(evicted);
+    }
+
+    return entry;
+}
+
+void ec_decode_cache_put(ec_decode_cache_t *cache,
+        struct ec_decode_cache_entry *entry)
+{
+    int refcount;
+
+    pthread_mutex_lock(&cache->lock);
+    refcount = --entry->refcount;
+    pthread_mutex_unlock(&cache->lock);
+
+    if (refcount == 0) {
+        cache->free_entry(entry);
+    }
+}
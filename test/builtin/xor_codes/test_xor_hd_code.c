@@ -59,6 +59,40 @@ int check_buffer(unsigned char *buf, int size, int seed)
   return 0;
 }
 
+/*
+ * Compare each parity against the result of XORing its data
+ * fragments in one at a time
+ */
+int check_parity(xor_code_t *code_desc, char **data, char **parity, int size)
+{
+  int i, j, err;
+  int ret = 0;
+  char *expected = NULL;
+
+  err = posix_memalign((void **) &expected, 16, size);
+  if (err != 0 || !expected) {
+    fprintf(stderr, "Could not allocate memory for expected parity\n");
+    exit(1);
+  }
+
+  for (j=0; j < code_desc->m; j++) {
+    memset(expected, 0, size);
+    for (i=0; i < code_desc->k; i++) {
+      if (is_data_in_parity(i, code_desc->parity_bms[j])) {
+        xor_bufs_and_store(data[i], expected, size);
+      }
+    }
+    if (memcmp(expected, parity[j], size) != 0) {
+      fprintf(stderr, "Parity %d does not match (size=%d)!\n", j, size);
+      ret = -1;
+      break;
+    }
+  }
+
+  free(expected);
+  return ret;
+}
+
 int test_hd_code(xor_code_t *code_desc, int num_failure_combs, int failure_combs[][4])
 {
   int i, j, err;
@@ -115,7 +149,16 @@ int test_hd_code(xor_code_t *code_desc, int num_failure_combs, int failure_combs
     memset(parity[i], 0, blocksize);
   }
 
+  /* Odd sizes exercise the unaligned tail of the XOR kernels */
+  code_desc->encode(code_desc, data, parity, blocksize - 7);
+  if (check_parity(code_desc, data, parity, blocksize - 7) < 0) {
+    exit(2);
+  }
+
   code_desc->encode(code_desc, data, parity, blocksize);
+  if (check_parity(code_desc, data, parity, blocksize) < 0) {
+    exit(2);
+  }
   
   for (i=0; i < num_failure_combs; i++) {
     int missing_idx_0 = failure_combs[i][0];
@@ -190,6 +233,10 @@ int test_hd_code(xor_code_t *code_desc, int num_failure_combs, int failure_combs
       fprintf(stderr, "Decode did not work: %d (%d %d %d)!\n", missing_idxs[2], missing_idxs[0], missing_idxs[1], missing_idxs[2]);
       exit(2);
     }
+    if (check_parity(code_desc, data, parity, blocksize) < 0) {
+      fprintf(stderr, "Decode did not rebuild parity: (%d %d %d)!\n", missing_idxs[0], missing_idxs[1], missing_idxs[2]);
+      exit(2);
+    }
   }
 
   start_time = clock();
@@ -345,15 +392,121 @@ int run_test(int k, int m, int hd)
     default:
       ret = -1; 
   }
-  free(code_desc);
+  free_xor_hd_code(code_desc);
   return ret; 
 }
 
+/*
+ * The generated codes are too wide for the precomputed failure lists, so
+ * test every single failure plus a random sample of multiple failures
+ */
+int run_generated_test(int k, int m, int hd)
+{
+  int n = k + m;
+  int num_samples = 200;
+  int num_combs = 0;
+  int (*combs)[4];
+  int ret, i, j, r;
+  xor_code_t *code_desc = init_xor_hd_code(k, m, hd);
+
+  fprintf(stderr, "Running generated (%d, %d, %d):\n", k, m, hd);
+
+  if (NULL == code_desc) {
+    fprintf(stderr, "Could not create generated (%d, %d, %d) code\n", k, m, hd);
+    return -1;
+  }
+
+  combs = malloc(sizeof(*combs) * (n + num_samples * (hd - 2)));
+  if (NULL == combs) {
+    fprintf(stderr, "Could not allocate memory for failure combinations\n");
+    exit(2);
+  }
+
+  for (i=0; i < n; i++) {
+    combs[num_combs][0] = i;
+    combs[num_combs][1] = combs[num_combs][2] = combs[num_combs][3] = -1;
+    num_combs++;
+  }
+
+  for (r=2; r < hd; r++) {
+    for (i=0; i < num_samples; i++) {
+      combs[num_combs][0] = combs[num_combs][1] = combs[num_combs][2] = combs[num_combs][3] = -1;
+      j = 0;
+      while (j < r) {
+        int idx = rand() % n;
+        int dup = 0, l;
+        for (l=0; l < j; l++) {
+          if (combs[num_combs][l] == idx) {
+            dup = 1;
+          }
+        }
+        if (!dup) {
+          combs[num_combs][j++] = idx;
+        }
+      }
+      num_combs++;
+    }
+  }
+
+  ret = test_hd_code(code_desc, num_combs, combs);
+
+  free(combs);
+  free_xor_hd_code(code_desc);
+  return ret;
+}
+
+/*
+ * Exercise each fast_memcpy path (memcpy and streaming) with unaligned
+ * buffers and odd lengths
+ */
+int test_fast_memcpy()
+{
+  int sizes[] = { 1, 4095, FAST_MEMCPY_NT_THRESHOLD + 13,
+                  16 * FAST_MEMCPY_NT_THRESHOLD + 77 };
+  int max_size = 16 * FAST_MEMCPY_NT_THRESHOLD + 77 + 16;
+  char *src = malloc(max_size);
+  char *dst = malloc(max_size);
+  int ret = 0;
+  int i, j;
+
+  if (NULL == src || NULL == dst) {
+    fprintf(stderr, "Could not allocate memory for fast_memcpy test\n");
+    exit(2);
+  }
+
+  for (i=0; i < max_size; i++) {
+    src[i] = rand() & 0xff;
+  }
+
+  for (i=0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for (j=0; j < 3; j++) {
+      memset(dst, 0, max_size);
+      fast_memcpy(dst + j * 5, src + j * 3, sizes[i]);
+      if (memcmp(dst + j * 5, src + j * 3, sizes[i]) != 0 ||
+          dst[j * 5 + sizes[i]] != 0 || (j > 0 && dst[j * 5 - 1] != 0)) {
+        fprintf(stderr, "fast_memcpy failed for size %d, offset %d\n", sizes[i], j);
+        ret = -1;
+        goto out;
+      }
+    }
+  }
+
+out:
+  free(src);
+  free(dst);
+  return ret;
+}
+
 int main()
 {
   int ret = 0;
   int i;
 
+  ret = test_fast_memcpy();
+  if (ret != 0) {
+    return ret;
+  }
+
   ret = run_test(3, 3, 3);
   if (ret != 0) {
     return ret;
@@ -385,6 +538,18 @@ int main()
       return ret;
     }
   }
+
+  {
+    int gen_codes[][3] = { {16, 6, 3}, {32, 6, 3}, {57, 6, 3}, {26, 5, 3},
+                           {57, 7, 3}, {11, 5, 4}, {26, 6, 4}, {40, 7, 4},
+                           {57, 7, 4} };
+    for (i=0; i < sizeof(gen_codes) / sizeof(gen_codes[0]); i++) {
+      ret = run_generated_test(gen_codes[i][0], gen_codes[i][1], gen_codes[i][2]);
+      if (ret != 0) {
+        return ret;
+      }
+    }
+  }
   exit(0);
 }
 
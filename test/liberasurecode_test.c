@@ -27,7 +27,11 @@
  */
 
 #include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <time.h>
 #include <zlib.h>
 #include "erasurecode.h"
 #include "erasurecode_helpers.h"
@@ -35,6 +39,10 @@
 #include "erasurecode_preprocessing.h"
 #include "erasurecode_backend.h"
 #include "alg_sig.h"
+#include "crc32c.h"
+#include "md5_private.h"
+#include "md5_mb.h"
+#include "xxh3.h"
 #define NULL_BACKEND "null"
 #define FLAT_XOR_HD_BACKEND "flat_xor_hd"
 #define JERASURE_RS_VAND_BACKEND "jerasure_rs_vand"
@@ -71,7 +79,16 @@ struct ec_args flat_xor_hd_args = {
     .ct = CHKSUM_NONE,
 };
 
-struct ec_args *flat_xor_test_args[] = { &flat_xor_hd_args, NULL };
+struct ec_args flat_xor_hd_wide_args = {
+    .k = 40,
+    .m = 7,
+    .hd = 4,
+    .ct = CHKSUM_NONE,
+};
+
+struct ec_args *flat_xor_test_args[] = { &flat_xor_hd_args,
+                                         &flat_xor_hd_wide_args,
+                                         NULL };
 
 struct ec_args jerasure_rs_vand_args = {
     .k = 10,
@@ -143,10 +160,30 @@ struct ec_args jerasure_rs_cauchy_1010_args = {
     .ct = CHKSUM_NONE,
 };
 
+struct ec_args jerasure_rs_cauchy_packetsize_args = {
+    .k = 6,
+    .m = 3,
+    .w = 8,
+    .hd = 4,
+    .priv_args1.jerasure_cauchy_args.packetsize = 64,
+    .ct = CHKSUM_NONE,
+};
+
+struct ec_args jerasure_rs_cauchy_auto_packetsize_args = {
+    .k = 4,
+    .m = 2,
+    .w = 8,
+    .hd = 3,
+    .priv_args1.jerasure_cauchy_args.packetsize = EC_CAUCHY_PACKETSIZE_AUTO,
+    .ct = CHKSUM_NONE,
+};
+
 struct ec_args *jerasure_rs_cauchy_test_args[] = { &jerasure_rs_cauchy_args,
                                                    &jerasure_rs_cauchy_44_args,
                                                    &jerasure_rs_cauchy_48_args,
                                                    &jerasure_rs_cauchy_1010_args,
+                                                   &jerasure_rs_cauchy_packetsize_args,
+                                                   &jerasure_rs_cauchy_auto_packetsize_args,
                                                    NULL };
 
 struct ec_args isa_l_args = {
@@ -472,9 +509,25 @@ static void validate_fragment_checksum(struct ec_args *args,
     uint32_t size = metadata->size;
     char *flag;
     switch (args->ct) {
-        case CHKSUM_MD5:
-            assert(false); //currently only have support crc32
-            break;
+        case CHKSUM_MD5: {
+            unsigned char digest[MD5_DIGEST_LEN];
+            bool mismatch = false;
+            MD5_CTX ctx;
+            int i;
+
+            MD5_Init(&ctx);
+            MD5_Update(&ctx, fragment_data, size);
+            MD5_Final(digest, &ctx);
+            /* stored as little-endian words */
+            for (i = 0; i < MD5_DIGEST_LEN; i++) {
+                if ((uint8_t) (metadata->chksum[i / 4] >> (8 * (i % 4))) !=
+                        digest[i]) {
+                    mismatch = true;
+                }
+            }
+            assert(mismatch == metadata->chksum_mismatch);
+            return;
+        }
         case CHKSUM_CRC32:
             flag = getenv("LIBERASURECODE_WRITE_LEGACY_CRC");
             if (flag && !(flag[0] == '\0' || (flag[0] == '0' && flag[1] == '\0'))) {
@@ -483,6 +536,49 @@ static void validate_fragment_checksum(struct ec_args *args,
                 computed = crc32(0, (unsigned char *) fragment_data, size);
             }
             break;
+        case CHKSUM_CRC32C:
+            computed = liberasurecode_crc32c(0, fragment_data, size);
+            break;
+        case CHKSUM_ALG_SIG:
+            computed = liberasurecode_alg_sig32(fragment_data, size);
+            break;
+        case CHKSUM_CRC32C_CHUNKED: {
+            /* the table sits at the end of the backend metadata */
+            int table_size = get_chksum_table_size(args->ct, size);
+            unsigned char *table = (unsigned char *) fragment_data + size +
+                metadata->frag_backend_metadata_size - table_size;
+            uint32_t offset;
+            bool mismatch = false;
+
+            assert(metadata->frag_backend_metadata_size >= table_size);
+            for (offset = 0; offset < size;
+                 offset += LIBERASURECODE_CHKSUM_CHUNK_SIZE) {
+                uint32_t n = size - offset;
+                uint32_t crc;
+                if (n > LIBERASURECODE_CHKSUM_CHUNK_SIZE) {
+                    n = LIBERASURECODE_CHKSUM_CHUNK_SIZE;
+                }
+                crc = liberasurecode_crc32c(0, fragment_data + offset, n);
+                if (table[0] != (crc & 0xff) ||
+                    table[1] != ((crc >> 8) & 0xff) ||
+                    table[2] != ((crc >> 16) & 0xff) ||
+                    table[3] != (crc >> 24)) {
+                    mismatch = true;
+                }
+                table += 4;
+            }
+            computed = liberasurecode_crc32c(0, table - table_size,
+                                             table_size);
+            assert((mismatch || chksum != computed) ==
+                   metadata->chksum_mismatch);
+            return;
+        }
+        case CHKSUM_XXH3: {
+            uint64_t stored = chksum | ((uint64_t) metadata->chksum[1] << 32);
+            uint64_t hash = liberasurecode_xxh3_64(fragment_data, size);
+            assert((stored != hash) == metadata->chksum_mismatch);
+            return;
+        }
         case CHKSUM_NONE:
             assert(metadata->chksum_mismatch == 0);
             break;
@@ -510,6 +606,193 @@ static void test_create_and_destroy_backend(
     assert(0 == liberasurecode_instance_destroy(desc));
 }
 
+/*
+ * Enough instances to span more than one chunk of the descriptor table;
+ * descriptors of destroyed instances must not reach their successors
+ */
+static void test_many_instances(ec_backend_id_t be_id, struct ec_args *args)
+{
+    int num_instances = 300;
+    int descs[300];
+    int size, i, j;
+
+    descs[0] = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == descs[0]) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(descs[0] > 0);
+    size = liberasurecode_get_fragment_size(descs[0], 1000);
+    assert(size > 0);
+
+    for (i = 1; i < num_instances; i++) {
+        descs[i] = liberasurecode_instance_create(be_id, args);
+        assert(descs[i] > 0);
+        for (j = 0; j < i; j++) {
+            assert(descs[i] != descs[j]);
+        }
+        assert(size == liberasurecode_get_fragment_size(descs[i], 1000));
+    }
+
+    for (i = 0; i < num_instances; i += 2) {
+        assert(0 == liberasurecode_instance_destroy(descs[i]));
+    }
+    for (i = 0; i < num_instances; i++) {
+        if (i % 2 == 0) {
+            assert(-EBACKENDNOTAVAIL ==
+                   liberasurecode_get_fragment_size(descs[i], 1000));
+            assert(-EBACKENDNOTAVAIL ==
+                   liberasurecode_instance_destroy(descs[i]));
+        } else {
+            assert(size == liberasurecode_get_fragment_size(descs[i], 1000));
+        }
+    }
+
+    /* The freed slots are reused, under new descriptors */
+    for (i = 0; i < num_instances; i += 2) {
+        int desc = liberasurecode_instance_create(be_id, args);
+        assert(desc > 0);
+        for (j = 0; j < num_instances; j++) {
+            assert(desc != descs[j]);
+        }
+        assert(-EBACKENDNOTAVAIL ==
+               liberasurecode_get_fragment_size(descs[i], 1000));
+        descs[i] = desc;
+    }
+
+    for (i = 0; i < num_instances; i++) {
+        assert(0 == liberasurecode_instance_destroy(descs[i]));
+    }
+}
+
+/*
+ * A destroyed instance's descriptor does not come back for a long while,
+ * even when every create lands on a just-freed slot
+ */
+static void test_stale_desc_not_reused()
+{
+    int num_cycles = 40000;
+    int stale_desc, desc, i;
+
+    stale_desc = liberasurecode_instance_create(EC_BACKEND_FLAT_XOR_HD,
+                                                &flat_xor_hd_args);
+    assert(stale_desc > 0);
+    assert(0 == liberasurecode_instance_destroy(stale_desc));
+
+    for (i = 0; i < num_cycles; i++) {
+        desc = liberasurecode_instance_create(EC_BACKEND_FLAT_XOR_HD,
+                                              &flat_xor_hd_args);
+        assert(desc > 0);
+        assert(desc != stale_desc);
+        assert(-EBACKENDNOTAVAIL ==
+               liberasurecode_get_fragment_size(stale_desc, 1000));
+        assert(0 == liberasurecode_instance_destroy(desc));
+    }
+}
+
+struct instance_user_args {
+    int desc;
+    int size;
+    volatile int calls;
+};
+
+static void *instance_user(void *arg)
+{
+    struct instance_user_args *user = (struct instance_user_args *) arg;
+    int rc;
+
+    for (;;) {
+        rc = liberasurecode_get_fragment_size(user->desc, 4096);
+        if (rc < 0) {
+            break;
+        }
+        assert(rc == user->size);
+        user->calls++;
+    }
+    assert(-EBACKENDNOTAVAIL == rc);
+    return NULL;
+}
+
+/*
+ * Destroy an instance while other threads are using it: they see it
+ * either whole or gone
+ */
+static void test_destroy_while_in_use(ec_backend_id_t be_id,
+                                      struct ec_args *args)
+{
+    struct instance_user_args users[4];
+    pthread_t threads[4];
+    int desc, size, i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+    size = liberasurecode_get_fragment_size(desc, 4096);
+    assert(size > 0);
+
+    for (i = 0; i < 4; i++) {
+        users[i].desc = desc;
+        users[i].size = size;
+        users[i].calls = 0;
+        assert(0 == pthread_create(&threads[i], NULL, instance_user,
+                                   &users[i]));
+    }
+    for (i = 0; i < 4; i++) {
+        while (users[i].calls < 100) {
+            sched_yield();
+        }
+    }
+
+    assert(0 == liberasurecode_instance_destroy(desc));
+    for (i = 0; i < 4; i++) {
+        assert(0 == pthread_join(threads[i], NULL));
+    }
+    assert(-EBACKENDNOTAVAIL == liberasurecode_instance_destroy(desc));
+}
+
+static void *hold_instance(void *arg)
+{
+    ec_backend_t instance = (ec_backend_t) arg;
+    struct timespec hold = { 0, 300 * 1000 * 1000 };
+
+    nanosleep(&hold, NULL);
+    liberasurecode_backend_instance_put(instance);
+    return NULL;
+}
+
+/*
+ * Destroy sleeps while an outstanding reference drains, rather than
+ * spinning on a core
+ */
+static void test_destroy_waits_for_reference()
+{
+    struct timespec start, end;
+    ec_backend_t instance;
+    pthread_t holder;
+    long cpu_ms;
+    int desc;
+
+    desc = liberasurecode_instance_create(EC_BACKEND_FLAT_XOR_HD,
+                                          &flat_xor_hd_args);
+    assert(desc > 0);
+    instance = liberasurecode_backend_instance_get(desc);
+    assert(instance != NULL);
+    assert(0 == pthread_create(&holder, NULL, hold_instance, instance));
+
+    assert(0 == clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start));
+    assert(0 == liberasurecode_instance_destroy(desc));
+    assert(0 == clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end));
+    assert(0 == pthread_join(holder, NULL));
+
+    cpu_ms = (end.tv_sec - start.tv_sec) * 1000 +
+             (end.tv_nsec - start.tv_nsec) / (1000 * 1000);
+    assert(cpu_ms < 100);
+    assert(-EBACKENDNOTAVAIL == liberasurecode_get_fragment_size(desc, 1000));
+}
+
 static void test_backend_available(ec_backend_id_t be_id) {
     assert(1 == liberasurecode_backend_available(be_id));
 }
@@ -1365,6 +1648,72 @@ static void test_write_legacy_fragment_metadata(const ec_backend_id_t be_id, str
     test_get_fragment_metadata(be_id, args);
 }
 
+/*
+ * CHKSUM_MD5 fragments written before 1.7.0 carry no digest; they read
+ * back without a checksum mismatch and still decode with metadata checks
+ */
+static void test_read_legacy_md5_fragment(const ec_backend_id_t be_id,
+                                          struct ec_args *args)
+{
+    int i, rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    fragment_metadata_t metadata;
+    fragment_header_t *header;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    /* Rewrite the data fragments the way 1.6.2 wrote them */
+    for (i = 0; i < args->k; i++) {
+        header = (fragment_header_t *) encoded_data[i];
+        memset(header->meta.chksum, 0, sizeof(header->meta.chksum));
+        header->libec_version = _VERSION(1,6,2);
+        header->metadata_chksum = liberasurecode_crc32(0, &header->meta,
+                sizeof(fragment_metadata_t));
+
+        rc = liberasurecode_get_fragment_metadata(encoded_data[i], &metadata);
+        assert(0 == rc);
+        assert(CHKSUM_MD5 == metadata.chksum_type);
+        assert(0 == metadata.chksum_mismatch);
+    }
+
+    rc = liberasurecode_decode(desc, encoded_data, args->k,
+            encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(0 == memcmp(decoded_data, orig_data, orig_data_size));
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    /* A current fragment with no digest is still caught */
+    header = (fragment_header_t *) encoded_parity[0];
+    memset(header->meta.chksum, 0, sizeof(header->meta.chksum));
+    header->metadata_chksum = liberasurecode_crc32(0, &header->meta,
+            sizeof(fragment_metadata_t));
+    rc = liberasurecode_get_fragment_metadata(encoded_parity[0], &metadata);
+    assert(0 == rc);
+    assert(1 == metadata.chksum_mismatch);
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
 static void test_decode_with_missing_data(const ec_backend_id_t be_id,
                                           struct ec_args *args)
 {
@@ -1538,6 +1887,109 @@ static void test_isa_l_rs_vand_decode_reconstruct_specific_error_case()
     free(skips);
 }
 
+/*
+ * Decode and reconstruct with every pair of missing fragments, twice, so
+ * that more patterns are used than the backend's decode cache holds and
+ * evicted entries have to be rebuilt
+ */
+static void decode_cache_test_impl(ec_backend_id_t be_id)
+{
+    struct ec_args cache_args = {
+        .k = 6,
+        .m = 4,
+    };
+    int n = cache_args.k + cache_args.m;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 64 * 1024;
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    int num_avail_frags = -1;
+    char **avail_frags = NULL;
+    char *decoded_data = NULL;
+    char *out_frag = NULL;
+    uint64_t decoded_data_len = 0;
+    int *skips = NULL;
+    int pass, i, j;
+
+    desc = liberasurecode_instance_create(be_id, &cache_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        free(orig_data);
+        return;
+    }
+    assert(desc > 0);
+
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    out_frag = malloc(sizeof(char) * encoded_fragment_len);
+    assert(out_frag != NULL);
+
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < n; i++) {
+            for (j = i + 1; j < n; j++) {
+                skips = create_skips_array(&cache_args, i);
+                assert(skips != NULL);
+                skips[j] = 1;
+                num_avail_frags = create_frags_array(&avail_frags,
+                        encoded_data, encoded_parity, &cache_args, skips);
+                assert(num_avail_frags == n - 2);
+
+                rc = liberasurecode_decode(desc, avail_frags, num_avail_frags,
+                        encoded_fragment_len, 1,
+                        &decoded_data, &decoded_data_len);
+                assert(rc == 0);
+                assert(decoded_data_len == orig_data_size);
+                assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+                liberasurecode_decode_cleanup(desc, decoded_data);
+
+                rc = liberasurecode_reconstruct_fragment(desc, avail_frags,
+                        num_avail_frags, encoded_fragment_len, j, out_frag);
+                assert(rc == 0);
+                assert(memcmp(out_frag, j < cache_args.k ? encoded_data[j] :
+                              encoded_parity[j - cache_args.k],
+                              encoded_fragment_len) == 0);
+
+                free(avail_frags);
+                free(skips);
+            }
+        }
+    }
+
+    free(out_frag);
+    rc = liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(rc == 0);
+    assert(0 == liberasurecode_instance_destroy(desc));
+    free(orig_data);
+}
+
+static void test_isa_l_rs_vand_decode_cache()
+{
+    decode_cache_test_impl(EC_BACKEND_ISA_L_RS_VAND);
+}
+
+static void test_isa_l_rs_cauchy_decode_cache()
+{
+    decode_cache_test_impl(EC_BACKEND_ISA_L_RS_CAUCHY);
+}
+
+static void test_jerasure_rs_vand_decode_cache()
+{
+    decode_cache_test_impl(EC_BACKEND_JERASURE_RS_VAND);
+}
+
+static void test_jerasure_rs_cauchy_decode_cache()
+{
+    decode_cache_test_impl(EC_BACKEND_JERASURE_RS_CAUCHY);
+}
+
 static void test_jerasure_rs_cauchy_init_failure()
 {
     struct ec_args bad_args = {
@@ -1557,6 +2009,106 @@ static void test_jerasure_rs_cauchy_init_failure()
     assert(-EBACKENDINITERR == desc);
 }
 
+/*
+ * Check the packetsize chosen in auto mode against the padding bound, and
+ * that objects of each size still decode with two fragments missing
+ */
+static void test_jerasure_rs_cauchy_auto_packetsize()
+{
+    struct ec_args *args = &jerasure_rs_cauchy_auto_packetsize_args;
+    struct ec_args bad_args = {
+        .k = 4,
+        .m = 2,
+        .w = 8,
+        .priv_args1.jerasure_cauchy_args.packetsize = sizeof(long) + 1,
+    };
+    int sizes[] = { 1, 100, 4000, 10000, 65536 + 17, 1024 * 1024 };
+    int rc = 0;
+    int desc = -1;
+    int null_desc = -1;
+    int i, j;
+
+    desc = liberasurecode_instance_create(EC_BACKEND_JERASURE_RS_CAUCHY, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        int packetsize = liberasurecode_get_packetsize(desc, sizes[i]);
+        int aligned = liberasurecode_get_aligned_data_size(desc, sizes[i]);
+        char *orig_data = create_buffer(sizes[i], 'x');
+        char **encoded_data = NULL, **encoded_parity = NULL;
+        uint64_t encoded_fragment_len = 0;
+        char **avail_frags = NULL;
+        int num_avail_frags = -1;
+        char *decoded_data = NULL;
+        uint64_t decoded_data_len = 0;
+        int *skips = NULL;
+
+        assert(packetsize >= sizeof(long));
+        assert(packetsize <= EC_CAUCHY_DEFAULT_PACKETSIZE);
+        assert(packetsize % sizeof(long) == 0);
+        assert(aligned >= sizes[i]);
+        assert(aligned % (args->k * args->w * packetsize) == 0);
+        if (packetsize > sizeof(long)) {
+            assert(aligned - sizes[i] <=
+                   sizes[i] / EC_CAUCHY_AUTO_PADDING_DIVISOR);
+        }
+
+        for (j = 0; j < sizes[i]; j++) {
+            orig_data[j] = rand() & 0xff;
+        }
+        rc = liberasurecode_encode(desc, orig_data, sizes[i],
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(rc == 0);
+        assert(encoded_fragment_len ==
+               sizeof(fragment_header_t) + aligned / args->k);
+
+        skips = create_skips_array(args, 0);
+        assert(skips != NULL);
+        skips[args->k] = 1;
+        num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                encoded_parity, args, skips);
+        rc = liberasurecode_decode(desc, avail_frags, num_avail_frags,
+                encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+        assert(rc == 0);
+        assert(decoded_data_len == sizes[i]);
+        assert(memcmp(decoded_data, orig_data, sizes[i]) == 0);
+
+        liberasurecode_decode_cleanup(desc, decoded_data);
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+        free(avail_frags);
+        free(skips);
+        free(orig_data);
+    }
+
+    /* large objects keep the default packetsize */
+    assert(liberasurecode_get_packetsize(desc, 1024 * 1024) ==
+           EC_CAUCHY_DEFAULT_PACKETSIZE);
+    assert(0 == liberasurecode_instance_destroy(desc));
+
+    desc = liberasurecode_instance_create(EC_BACKEND_JERASURE_RS_CAUCHY,
+            &jerasure_rs_cauchy_packetsize_args);
+    assert(desc > 0);
+    assert(liberasurecode_get_packetsize(desc, 1) == 64);
+    assert(liberasurecode_get_packetsize(desc, 1024 * 1024) == 64);
+    assert(liberasurecode_get_aligned_data_size(desc, 1) ==
+           jerasure_rs_cauchy_packetsize_args.k *
+           jerasure_rs_cauchy_packetsize_args.w * 64);
+    assert(0 == liberasurecode_instance_destroy(desc));
+
+    desc = liberasurecode_instance_create(EC_BACKEND_JERASURE_RS_CAUCHY,
+            &bad_args);
+    assert(-EBACKENDINITERR == desc);
+
+    null_desc = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    assert(null_desc > 0);
+    assert(liberasurecode_get_packetsize(null_desc, 1) == -EINVALIDPARAMS);
+    assert(0 == liberasurecode_instance_destroy(null_desc));
+}
+
 static void test_flat_xor_hd3_init_failure()
 {
     struct ec_args bad_args[] = {
@@ -1588,37 +2140,1243 @@ static void test_simple_encode_decode(const ec_backend_id_t be_id,
     free(skip);
 }
 
-static void test_jerasure_rs_vand_simple_encode_decode_over32()
+/*
+ * Overwrite the first data fragment and patch the parity with
+ * liberasurecode_encode_update(); the stripe must then match a fresh
+ * encode of the modified object, byte for byte
+ */
+static void test_encode_update(const ec_backend_id_t be_id,
+                               struct ec_args *args)
 {
-    struct ec_args over32_args = {
-        .k = 30,
-        .m = 20,
-    };
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024;
+    char *orig_data = NULL;
+    char *new_payload = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **expected_data = NULL, **expected_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    uint64_t expected_fragment_len = 0;
+    fragment_metadata_t metadata;
+    int i;
 
-    int *skip = create_skips_array(&over32_args, 1);
-    assert(skip != NULL);
-    // should return an error
-    encode_decode_test_impl(EC_BACKEND_JERASURE_RS_VAND,
-                            &over32_args, skip);
-    free(skip);
-}
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
 
-static void test_simple_reconstruct(const ec_backend_id_t be_id,
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    rc = liberasurecode_get_fragment_metadata(encoded_data[0], &metadata);
+    assert(0 == rc);
+    assert(metadata.size <= orig_data_size);
+
+    new_payload = malloc(metadata.size);
+    assert(new_payload != NULL);
+    for (i = 0; i < metadata.size; i++) {
+        new_payload[i] = rand() & 0xff;
+    }
+
+    /* Wrong payload length and missing parity are rejected */
+    rc = liberasurecode_encode_update(desc, encoded_data[0], new_payload,
+            metadata.size - 1, encoded_parity, args->m);
+    assert(rc != 0);
+    rc = liberasurecode_encode_update(desc, encoded_data[0], new_payload,
+            metadata.size, encoded_parity, args->m - 1);
+    assert(rc != 0);
+
+    rc = liberasurecode_encode_update(desc, encoded_data[0], new_payload,
+            metadata.size, encoded_parity, args->m);
+    if (-EECMETHODNOTIMPL == rc) {
+        goto out;
+    }
+    assert(0 == rc);
+
+    memcpy(orig_data, new_payload, metadata.size);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &expected_data, &expected_parity, &expected_fragment_len);
+    assert(0 == rc);
+    assert(expected_fragment_len == encoded_fragment_len);
+
+    for (i = 0; i < args->k; i++) {
+        assert(memcmp(encoded_data[i], expected_data[i],
+                      encoded_fragment_len) == 0);
+    }
+    for (i = 0; i < args->m; i++) {
+        assert(memcmp(encoded_parity[i], expected_parity[i],
+                      encoded_fragment_len) == 0);
+    }
+
+    liberasurecode_encode_cleanup(desc, expected_data, expected_parity);
+out:
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(new_payload);
+    free(orig_data);
+}
+
+/*
+ * Scrub a clean stripe, then one with a flipped byte in a parity fragment
+ * and one with a flipped byte in a data fragment
+ */
+static void test_scrub_stripe(const ec_backend_id_t be_id,
+                              struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1000003;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *stripe[EC_MAX_FRAGMENTS];
+    int bad_idxs[EC_MAX_FRAGMENTS];
+    int num_bad = -1;
+    uint64_t encoded_fragment_len = 0;
+    char *payload;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    /* in reverse order, to check the fragments get sorted */
+    for (i = 0; i < args->k + args->m; i++) {
+        stripe[args->k + args->m - 1 - i] =
+            i < args->k ? encoded_data[i] : encoded_parity[i - args->k];
+    }
+
+    rc = liberasurecode_scrub_stripe(desc, stripe, args->k + args->m,
+                                     bad_idxs, &num_bad);
+    if (-EECMETHODNOTIMPL == rc) {
+        goto out;
+    }
+    assert(0 == rc);
+    assert(0 == num_bad);
+
+    rc = liberasurecode_scrub_stripe(desc, stripe, args->k + args->m - 1,
+                                     bad_idxs, &num_bad);
+    assert(-EINVALIDPARAMS == rc);
+
+    /* A bad parity is always pinned down */
+    payload = get_data_ptr_from_fragment(encoded_parity[args->m - 1]);
+    payload[12345] ^= 0x20;
+    rc = liberasurecode_scrub_stripe(desc, stripe, args->k + args->m,
+                                     bad_idxs, &num_bad);
+    assert(0 == rc);
+    assert(1 == num_bad);
+    assert(args->k + args->m - 1 == bad_idxs[0]);
+    payload[12345] ^= 0x20;
+
+    /*
+     * A bad data fragment is found by its checksum; without one, some
+     * parity disagrees
+     */
+    payload = get_data_ptr_from_fragment(encoded_data[1]);
+    payload[777] ^= 0x01;
+    rc = liberasurecode_scrub_stripe(desc, stripe, args->k + args->m,
+                                     bad_idxs, &num_bad);
+    assert(0 == rc);
+    assert(num_bad >= 1);
+    if (args->ct == CHKSUM_NONE) {
+        for (i = 0; i < num_bad; i++) {
+            assert(bad_idxs[i] >= args->k);
+        }
+    } else {
+        assert(1 == num_bad);
+        assert(1 == bad_idxs[0]);
+    }
+    payload[777] ^= 0x01;
+
+    rc = liberasurecode_scrub_stripe(desc, stripe, args->k + args->m,
+                                     bad_idxs, &num_bad);
+    assert(0 == rc);
+    assert(0 == num_bad);
+
+out:
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/*
+ * Feed the data fragments to an accumulating encode in reverse order; the
+ * result must match liberasurecode_encode() byte for byte
+ */
+static void test_encode_accumulate(const ec_backend_id_t be_id,
+                                   struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1000003;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **expected_data = NULL, **expected_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    uint64_t expected_fragment_len = 0;
+    uint64_t data_len_per_fragment = 0;
+    ec_encode_accumulator_t acc = NULL;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &expected_data, &expected_parity, &expected_fragment_len);
+    assert(0 == rc);
+
+    rc = liberasurecode_encode_accumulate_init(desc, orig_data_size,
+            &data_len_per_fragment, &acc);
+    assert(0 == rc);
+    assert(data_len_per_fragment * args->k >= orig_data_size);
+
+    for (i = args->k - 1; i >= 0; i--) {
+        uint64_t start = data_len_per_fragment * i;
+        uint64_t len = 0;
+
+        if (start < orig_data_size) {
+            len = orig_data_size - start;
+            if (len > data_len_per_fragment) {
+                len = data_len_per_fragment;
+            }
+        }
+        if (len > 0) {
+            /* Wrong length is rejected */
+            rc = liberasurecode_encode_accumulate(acc, i, orig_data + start,
+                                                  len - 1);
+            assert(-EINVALIDPARAMS == rc);
+        }
+        rc = liberasurecode_encode_accumulate(acc, i, orig_data + start, len);
+        assert(0 == rc);
+        if (i == args->k - 1) {
+            /* Adding a fragment twice is rejected */
+            rc = liberasurecode_encode_accumulate(acc, i, orig_data + start,
+                                                  len);
+            assert(-EINVALIDPARAMS == rc);
+        }
+        if (i > 0) {
+            rc = liberasurecode_encode_accumulate_finalize(acc,
+                    &encoded_data, &encoded_parity, &encoded_fragment_len);
+            assert(-EINSUFFFRAGS == rc);
+        }
+    }
+
+    rc = liberasurecode_encode_accumulate_finalize(acc,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    assert(expected_fragment_len == encoded_fragment_len);
+
+    for (i = 0; i < args->k; i++) {
+        assert(memcmp(encoded_data[i], expected_data[i],
+                      encoded_fragment_len) == 0);
+    }
+    for (i = 0; i < args->m; i++) {
+        assert(memcmp(encoded_parity[i], expected_parity[i],
+                      encoded_fragment_len) == 0);
+    }
+
+    /* An abandoned encode releases its fragments */
+    rc = liberasurecode_encode_accumulate_init(desc, orig_data_size,
+            &data_len_per_fragment, &acc);
+    assert(0 == rc);
+    rc = liberasurecode_encode_accumulate(acc, 0, orig_data,
+                                          data_len_per_fragment);
+    assert(0 == rc);
+    assert(0 == liberasurecode_encode_accumulate_abort(acc));
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_encode_cleanup(desc, expected_data, expected_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/*
+ * Accumulating an encode tracks data fragments beyond the 64th
+ */
+static void test_liberasurecode_rs_vand_encode_accumulate_over64()
+{
+    struct ec_args over64_args = {
+        .k = 70,
+        .m = 2,
+        .w = 16,
+        .hd = 3,
+        .ct = CHKSUM_CRC32,
+    };
+
+    test_encode_accumulate(EC_BACKEND_LIBERASURECODE_RS_VAND, &over64_args);
+}
+
+static void test_jerasure_rs_vand_simple_encode_decode_over32()
+{
+    struct ec_args over32_args = {
+        .k = 30,
+        .m = 20,
+    };
+
+    int *skip = create_skips_array(&over32_args, 1);
+    assert(skip != NULL);
+    // should return an error
+    encode_decode_test_impl(EC_BACKEND_JERASURE_RS_VAND,
+                            &over32_args, skip);
+    free(skip);
+}
+
+static void test_simple_reconstruct(const ec_backend_id_t be_id,
+                                    struct ec_args *args)
+{
+    int i = 0;
+    for (i = 0; i < args->k + args->m; i++) {
+        int *skip = create_skips_array(args,i);
+        assert(skip != NULL);
+        reconstruct_test_impl(be_id, args, skip);
+        free(skip);
+    }
+}
+
+static void test_fragments_needed(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    test_fragments_needed_impl(be_id, args);
+}
+
+/*
+ * Checksums computed during encode must match a checksum of the finished
+ * payload, including objects that end partway through an encode chunk
+ */
+static void test_encode_checksums(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    int sizes[] = { 1, 4095, 64 * 1024 + 7, 1024 * 1024 + 13 };
+    int num_fragments = args->k + args->m;
+    int rc = 0;
+    int desc = -1;
+    int i, j;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char *orig_data = create_buffer(sizes[i], 'x');
+        char **encoded_data = NULL, **encoded_parity = NULL;
+        uint64_t encoded_fragment_len = 0;
+
+        assert(orig_data != NULL);
+        for (j = 0; j < sizes[i]; j++) {
+            orig_data[j] = rand() & 0xff;
+        }
+
+        rc = liberasurecode_encode(desc, orig_data, sizes[i],
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(0 == rc);
+
+        for (j = 0; j < num_fragments; j++) {
+            char *frag = (j < args->k) ? encoded_data[j] :
+                                         encoded_parity[j - args->k];
+            fragment_metadata_t metadata;
+
+            rc = liberasurecode_get_fragment_metadata(frag, &metadata);
+            assert(0 == rc);
+            assert(metadata.chksum_type == args->ct);
+            assert(metadata.chksum_mismatch == 0);
+            validate_fragment_checksum(args, &metadata,
+                                       get_data_ptr_from_fragment(frag));
+        }
+
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+        free(orig_data);
+    }
+
+    assert(0 == liberasurecode_instance_destroy(desc));
+}
+
+/*
+ * Verify a stripe big enough to be spread over threads, with a damaged
+ * data payload, parity payload and header
+ */
+static void test_verify_fragments(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 16 * 1024 * 1024;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *fragments[EC_MAX_FRAGMENTS];
+    uint64_t invalid_bm[EC_MAX_FRAGMENTS / 64];
+    uint64_t encoded_fragment_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        fragments[i] = i < args->k ? encoded_data[i] :
+                                     encoded_parity[i - args->k];
+    }
+
+    rc = liberasurecode_verify_fragments(desc, fragments, num_fragments,
+                                         invalid_bm);
+    assert(0 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        assert(0 == (invalid_bm[i / 64] & (1ULL << (i % 64))));
+    }
+
+    get_data_ptr_from_fragment(fragments[0])[1000] ^= 0x01;
+    get_data_ptr_from_fragment(fragments[args->k])[7] ^= 0x80;
+    ((fragment_header_t *) fragments[num_fragments - 1])->meta.idx ^= 0x40;
+
+    rc = liberasurecode_verify_fragments(desc, fragments, num_fragments,
+                                         invalid_bm);
+    assert(3 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        int expected = (i == 0 || i == args->k || i == num_fragments - 1);
+        assert(expected == !!(invalid_bm[i / 64] & (1ULL << (i % 64))));
+    }
+    rc = liberasurecode_verify_fragments(desc, fragments, num_fragments,
+                                         NULL);
+    assert(3 == rc);
+
+    /* Same answer with the fragments spread over a thread pool */
+    assert(0 == liberasurecode_instance_set_threads(desc, 4, 0));
+    memset(invalid_bm, 0xff, sizeof(invalid_bm));
+    rc = liberasurecode_verify_fragments(desc, fragments, num_fragments,
+                                         invalid_bm);
+    assert(3 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        int expected = (i == 0 || i == args->k || i == num_fragments - 1);
+        assert(expected == !!(invalid_bm[i / 64] & (1ULL << (i % 64))));
+    }
+
+    /* Decode with metadata checks counts on the same verification */
+    rc = liberasurecode_decode(desc, fragments + 1, args->k,
+            encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(-EINSUFFFRAGS == rc);
+
+    rc = liberasurecode_verify_fragments(desc, NULL, num_fragments, NULL);
+    assert(-EINVALIDPARAMS == rc);
+    rc = liberasurecode_verify_fragments(-1, fragments, num_fragments, NULL);
+    assert(-EBACKENDNOTAVAIL == rc);
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/*
+ * Encoding on a thread pool gives the same fragments as encoding inline
+ */
+static void test_encode_threads(const ec_backend_id_t be_id,
+                                struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1, threaded_desc = -1;
+    int orig_data_size = 2 * 1024 * 1024 + 123;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **threaded_data = NULL, **threaded_parity = NULL;
+    uint64_t encoded_fragment_len = 0, threaded_fragment_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+    threaded_desc = liberasurecode_instance_create(be_id, args);
+    assert(threaded_desc > 0);
+
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_instance_set_threads(threaded_desc, -1, 0));
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_instance_set_threads(threaded_desc, 4, -1));
+    assert(-EBACKENDNOTAVAIL == liberasurecode_instance_set_threads(-1, 4, 0));
+    /* Small splits, so that this stripe is cut up */
+    assert(0 == liberasurecode_instance_set_threads(threaded_desc, 4,
+                                                    16 * 1024));
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    rc = liberasurecode_encode(threaded_desc, orig_data, orig_data_size,
+            &threaded_data, &threaded_parity, &threaded_fragment_len);
+    assert(0 == rc);
+
+    assert(encoded_fragment_len == threaded_fragment_len);
+    for (i = 0; i < args->k; i++) {
+        assert(0 == memcmp(encoded_data[i], threaded_data[i],
+                           encoded_fragment_len));
+    }
+    for (i = 0; i < args->m; i++) {
+        assert(0 == memcmp(encoded_parity[i], threaded_parity[i],
+                           encoded_fragment_len));
+    }
+
+    rc = liberasurecode_decode(threaded_desc, threaded_data, args->k,
+            threaded_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(0 == memcmp(decoded_data, orig_data, orig_data_size));
+    liberasurecode_decode_cleanup(threaded_desc, decoded_data);
+
+    /* And back to one thread */
+    assert(0 == liberasurecode_instance_set_threads(threaded_desc, 0, 0));
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_encode_cleanup(threaded_desc, threaded_data,
+                                  threaded_parity);
+    liberasurecode_instance_destroy(threaded_desc);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/*
+ * Degraded decode and reconstruct on a thread pool give back the
+ * original data and fragments
+ */
+static void test_decode_threads(const ec_backend_id_t be_id,
+                                struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 2 * 1024 * 1024 + 123;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *fragments[EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    char *out_fragment = NULL;
+    int lost[2] = { 0, args->k };
+    int i, j;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+    assert(0 == liberasurecode_instance_set_threads(desc, 4, 16 * 1024));
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    out_fragment = malloc(encoded_fragment_len);
+    assert(out_fragment != NULL);
+
+    /* Lose a data fragment, then a parity fragment */
+    for (j = 0; j < 2; j++) {
+        int num_avail = 0;
+        char *expected;
+
+        for (i = 0; i < num_fragments; i++) {
+            if (i != lost[j]) {
+                fragments[num_avail++] = i < args->k ? encoded_data[i] :
+                    encoded_parity[i - args->k];
+            }
+        }
+        expected = lost[j] < args->k ? encoded_data[lost[j]] :
+                                       encoded_parity[lost[j] - args->k];
+
+        rc = liberasurecode_decode(desc, fragments, num_avail,
+                encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+        assert(0 == rc);
+        assert(decoded_data_len == orig_data_size);
+        assert(0 == memcmp(decoded_data, orig_data, orig_data_size));
+        liberasurecode_decode_cleanup(desc, decoded_data);
+
+        rc = liberasurecode_reconstruct_fragment(desc, fragments, num_avail,
+                encoded_fragment_len, lost[j], out_fragment);
+        assert(0 == rc);
+        assert(0 == memcmp(get_data_ptr_from_fragment(out_fragment),
+                           get_data_ptr_from_fragment(expected),
+                           get_fragment_payload_size(expected)));
+    }
+
+    free(out_fragment);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+struct pool_swapper_args {
+    int desc;
+    volatile int stop;
+};
+
+static void *swap_pools(void *arg)
+{
+    struct pool_swapper_args *swapper = (struct pool_swapper_args *) arg;
+    int num_threads = 2;
+
+    while (!swapper->stop) {
+        assert(0 == liberasurecode_instance_set_threads(swapper->desc,
+                                                        num_threads,
+                                                        16 * 1024));
+        num_threads = (num_threads + 1) % 5;
+    }
+    return NULL;
+}
+
+/*
+ * Changing the thread pool while other threads encode and decode on the
+ * instance leaves their calls running on a pool that is still alive
+ */
+static void test_set_threads_while_in_use(const ec_backend_id_t be_id,
+                                          struct ec_args *args)
+{
+    struct pool_swapper_args swapper;
+    pthread_t thread;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 256 * 1024 + 123;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    swapper.desc = desc;
+    swapper.stop = 0;
+    assert(0 == pthread_create(&thread, NULL, swap_pools, &swapper));
+
+    for (i = 0; i < 50; i++) {
+        rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(0 == rc);
+        rc = liberasurecode_decode(desc, encoded_data, args->k,
+                encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+        assert(0 == rc);
+        assert(decoded_data_len == orig_data_size);
+        assert(0 == memcmp(decoded_data, orig_data, orig_data_size));
+        liberasurecode_decode_cleanup(desc, decoded_data);
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    }
+
+    swapper.stop = 1;
+    assert(0 == pthread_join(thread, NULL));
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+#define NUM_ASYNC_REQS 6
+
+/*
+ * Submit every request, reaping as the queue pushes back, then reap the
+ * rest; the eventfd is polled before each blocking reap
+ */
+static void async_run_all(ec_async_queue_t queue,
+                          struct ec_async_request *reqs, int num_reqs)
+{
+    struct ec_async_request *to_submit[NUM_ASYNC_REQS];
+    struct ec_async_request *done[NUM_ASYNC_REQS];
+    struct pollfd pfd;
+    int submitted = 0, reaped = 0;
+    int rc, i;
+
+    for (i = 0; i < num_reqs; i++) {
+        to_submit[i] = &reqs[i];
+    }
+    pfd.fd = liberasurecode_async_get_eventfd(queue);
+    pfd.events = POLLIN;
+    assert(pfd.fd >= 0);
+
+    while (reaped < num_reqs) {
+        if (submitted < num_reqs) {
+            rc = liberasurecode_async_submit(queue, to_submit + submitted,
+                                             num_reqs - submitted);
+            if (rc > 0) {
+                submitted += rc;
+                continue;
+            }
+            assert(-EAGAIN == rc);
+        }
+        assert(1 == poll(&pfd, 1, 60 * 1000));
+        rc = liberasurecode_async_reap(queue, done, NUM_ASYNC_REQS, 1);
+        assert(rc >= 1);
+        reaped += rc;
+    }
+    assert(submitted == num_reqs);
+
+    /* All reaped: the event is cleared and there is nothing to wait for */
+    assert(0 == poll(&pfd, 1, 0));
+    assert(0 == liberasurecode_async_reap(queue, done, NUM_ASYNC_REQS, 1));
+}
+
+/*
+ * Encode, decode and reconstruct through an async queue reaped by the
+ * caller, with a queue shallower than the number of requests
+ */
+static void test_async_reap(const ec_backend_id_t be_id,
+                            struct ec_args *args)
+{
+    int desc = -1;
+    ec_async_queue_t queue = NULL;
+    struct ec_async_request reqs[NUM_ASYNC_REQS];
+    char *orig_data[NUM_ASYNC_REQS];
+    char *fragments[NUM_ASYNC_REQS][EC_MAX_FRAGMENTS];
+    char **encoded_data[NUM_ASYNC_REQS], **encoded_parity[NUM_ASYNC_REQS];
+    uint64_t fragment_len[NUM_ASYNC_REQS];
+    int orig_data_size = 64 * 1024;
+    int i, j;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_async_create(desc, 0, 0, NULL, NULL, &queue));
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_async_create(desc, 2, -1, NULL, NULL, &queue));
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_async_create(desc, 2, 0, NULL, NULL, NULL));
+    assert(-EBACKENDNOTAVAIL ==
+           liberasurecode_async_create(-1, 2, 0, NULL, NULL, &queue));
+    assert(0 == liberasurecode_async_create(desc, 2, NUM_ASYNC_REQS - 2,
+                                            NULL, NULL, &queue));
+
+    memset(reqs, 0, sizeof(reqs));
+    for (i = 0; i < NUM_ASYNC_REQS; i++) {
+        orig_data[i] = create_buffer(orig_data_size + i, 'x');
+        assert(orig_data[i] != NULL);
+        for (j = 0; j < orig_data_size + i; j++) {
+            orig_data[i][j] = rand() & 0xff;
+        }
+        reqs[i].op = EC_ASYNC_ENCODE;
+        reqs[i].orig_data = orig_data[i];
+        reqs[i].orig_data_size = orig_data_size + i;
+    }
+    async_run_all(queue, reqs, NUM_ASYNC_REQS);
+
+    /* Decode each object without its first data fragment */
+    for (i = 0; i < NUM_ASYNC_REQS; i++) {
+        assert(0 == reqs[i].status);
+        encoded_data[i] = reqs[i].encoded_data;
+        encoded_parity[i] = reqs[i].encoded_parity;
+        fragment_len[i] = reqs[i].fragment_len;
+        for (j = 1; j < args->k; j++) {
+            fragments[i][j - 1] = encoded_data[i][j];
+        }
+        for (j = 0; j < args->m; j++) {
+            fragments[i][args->k - 1 + j] = encoded_parity[i][j];
+        }
+
+        memset(&reqs[i], 0, sizeof(reqs[i]));
+        reqs[i].op = EC_ASYNC_DECODE;
+        reqs[i].available_fragments = fragments[i];
+        reqs[i].num_fragments = args->k + args->m - 1;
+        reqs[i].fragment_len = fragment_len[i];
+        reqs[i].force_metadata_checks = 1;
+    }
+    async_run_all(queue, reqs, NUM_ASYNC_REQS);
+
+    for (i = 0; i < NUM_ASYNC_REQS; i++) {
+        assert(0 == reqs[i].status);
+        assert(reqs[i].out_data_len == orig_data_size + i);
+        assert(0 == memcmp(reqs[i].out_data, orig_data[i],
+                           orig_data_size + i));
+        liberasurecode_decode_cleanup(desc, reqs[i].out_data);
+
+        memset(&reqs[i], 0, sizeof(reqs[i]));
+        reqs[i].op = EC_ASYNC_RECONSTRUCT;
+        reqs[i].available_fragments = fragments[i];
+        reqs[i].num_fragments = args->k + args->m - 1;
+        reqs[i].fragment_len = fragment_len[i];
+        reqs[i].destination_idx = 0;
+        reqs[i].out_fragment = malloc(fragment_len[i]);
+        assert(reqs[i].out_fragment != NULL);
+    }
+    async_run_all(queue, reqs, NUM_ASYNC_REQS);
+
+    for (i = 0; i < NUM_ASYNC_REQS; i++) {
+        assert(0 == reqs[i].status);
+        assert(0 == memcmp(get_data_ptr_from_fragment(reqs[i].out_fragment),
+                    get_data_ptr_from_fragment(encoded_data[i][0]),
+                    get_fragment_payload_size(encoded_data[i][0])));
+        free(reqs[i].out_fragment);
+        liberasurecode_encode_cleanup(desc, encoded_data[i],
+                                      encoded_parity[i]);
+        free(orig_data[i]);
+    }
+
+    assert(0 == liberasurecode_async_destroy(queue));
+    liberasurecode_instance_destroy(desc);
+}
+
+struct async_callback_state {
+    pthread_mutex_t lock;
+    int calls;
+};
+
+static void async_count_callback(struct ec_async_request *req, void *arg)
+{
+    struct async_callback_state *state = arg;
+
+    assert(req->user_data == arg);
+    pthread_mutex_lock(&state->lock);
+    state->calls++;
+    pthread_mutex_unlock(&state->lock);
+}
+
+/*
+ * Completions go to the callback, and destroying the queue finishes
+ * what was submitted
+ */
+static void test_async_callback(const ec_backend_id_t be_id,
+                                struct ec_args *args)
+{
+    int desc = -1;
+    ec_async_queue_t queue = NULL;
+    struct ec_async_request reqs[NUM_ASYNC_REQS];
+    struct ec_async_request *to_submit[NUM_ASYNC_REQS];
+    struct async_callback_state state;
+    int orig_data_size = 32 * 1024;
+    char *orig_data = NULL;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    pthread_mutex_init(&state.lock, NULL);
+    state.calls = 0;
+    assert(0 == liberasurecode_async_create(desc, 3, 0,
+                async_count_callback, &state, &queue));
+    assert(-EINVALIDPARAMS == liberasurecode_async_get_eventfd(queue));
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_async_reap(queue, to_submit, NUM_ASYNC_REQS, 0));
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    memset(reqs, 0, sizeof(reqs));
+    for (i = 0; i < NUM_ASYNC_REQS; i++) {
+        reqs[i].op = EC_ASYNC_ENCODE;
+        reqs[i].user_data = &state;
+        reqs[i].orig_data = orig_data;
+        reqs[i].orig_data_size = orig_data_size;
+        to_submit[i] = &reqs[i];
+    }
+    reqs[0].op = EC_ASYNC_RECONSTRUCT + 1;
+    assert(-EINVALIDPARAMS ==
+           liberasurecode_async_submit(queue, to_submit, NUM_ASYNC_REQS));
+    reqs[0].op = EC_ASYNC_ENCODE;
+
+    assert(NUM_ASYNC_REQS ==
+           liberasurecode_async_submit(queue, to_submit, NUM_ASYNC_REQS));
+    assert(0 == liberasurecode_async_destroy(queue));
+    assert(NUM_ASYNC_REQS == state.calls);
+
+    for (i = 0; i < NUM_ASYNC_REQS; i++) {
+        assert(0 == reqs[i].status);
+        assert(0 == memcmp(get_data_ptr_from_fragment(reqs[i].encoded_data[0]),
+                           orig_data,
+                           get_fragment_payload_size(reqs[i].encoded_data[0])));
+        liberasurecode_encode_cleanup(desc, reqs[i].encoded_data,
+                                      reqs[i].encoded_parity);
+    }
+
+    pthread_mutex_destroy(&state.lock);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/*
+ * Decode with lazy metadata checks: damaged surplus fragments are never
+ * used, and a damaged data fragment is replaced by a verified one
+ */
+static void test_decode_lazy_checks(const ec_backend_id_t be_id,
                                     struct ec_args *args)
 {
-    int i = 0;
-    for (i = 0; i < args->k + args->m; i++) {
-        int *skip = create_skips_array(args,i);
-        assert(skip != NULL);
-        reconstruct_test_impl(be_id, args, skip);
-        free(skip);
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 7;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *fragments[EC_MAX_FRAGMENTS], *partial[EC_MAX_FRAGMENTS];
+    char *many[2 * EC_MAX_FRAGMENTS];
+    uint64_t encoded_fragment_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    /* Parity first, so the data fragments have to be picked out */
+    for (i = 0; i < num_fragments; i++) {
+        fragments[i] = i < args->m ? encoded_parity[i] :
+                                     encoded_data[i - args->m];
+    }
+
+    /* Every parity fragment damaged: the data fragments are enough */
+    for (i = 0; i < args->m; i++) {
+        get_data_ptr_from_fragment(encoded_parity[i])[3] ^= 0x10;
+    }
+    rc = liberasurecode_decode(desc, fragments, num_fragments,
+            encoded_fragment_len, LIBERASURECODE_METADATA_CHECKS_LAZY,
+            &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(0 == memcmp(decoded_data, orig_data, orig_data_size));
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    /* ... but not once a data fragment is damaged as well */
+    get_data_ptr_from_fragment(encoded_data[0])[100] ^= 0x01;
+    rc = liberasurecode_decode(desc, fragments, num_fragments,
+            encoded_fragment_len, LIBERASURECODE_METADATA_CHECKS_LAZY,
+            &decoded_data, &decoded_data_len);
+    assert(-EINSUFFFRAGS == rc);
+
+    /*
+     * Any other non-zero value still checks every fragment (without data
+     * fragment 1, so that the data cannot just be stitched together)
+     */
+    for (i = 0; i < num_fragments - 1; i++) {
+        partial[i] = fragments[i < args->m + 1 ? i : i + 1];
+    }
+    rc = liberasurecode_decode(desc, partial, num_fragments - 1,
+            encoded_fragment_len, -1, &decoded_data, &decoded_data_len);
+    assert(-EINSUFFFRAGS == rc);
+
+    /* With the parity intact again, it stands in for the damaged data */
+    for (i = 0; i < args->m; i++) {
+        get_data_ptr_from_fragment(encoded_parity[i])[3] ^= 0x10;
+    }
+    rc = liberasurecode_decode(desc, fragments, num_fragments,
+            encoded_fragment_len, LIBERASURECODE_METADATA_CHECKS_LAZY,
+            &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(0 == memcmp(decoded_data, orig_data, orig_data_size));
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    /* More fragments than EC_MAX_FRAGMENTS, all of them checked */
+    for (i = 0; i < 2 * EC_MAX_FRAGMENTS; i++) {
+        many[i] = fragments[i % num_fragments];
+    }
+    rc = liberasurecode_decode(desc, many, 2 * EC_MAX_FRAGMENTS,
+            encoded_fragment_len, LIBERASURECODE_METADATA_CHECKS_LAZY,
+            &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(0 == memcmp(decoded_data, orig_data, orig_data_size));
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/*
+ * Verify ranges of CHKSUM_CRC32C_CHUNKED fragments from the header, the
+ * checksum table and just the chunks covering the range
+ */
+static void test_verify_fragment_range(const ec_backend_id_t be_id,
+                                       struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 8 * 1024 * 1024 + 13;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char *avail_frags[EC_MAX_FRAGMENTS];
+    char *out_fragment = NULL;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    uint64_t encoded_fragment_len = 0;
+    uint64_t read_offset, read_len, table_offset, table_len;
+    fragment_metadata_t metadata;
+    char *frag, *payload, *table;
+    int i;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = rand() & 0xff;
+    }
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    frag = encoded_data[0];
+    payload = get_data_ptr_from_fragment(frag);
+    rc = liberasurecode_get_fragment_metadata(frag, &metadata);
+    assert(0 == rc);
+    assert(0 == metadata.chksum_mismatch);
+    assert(metadata.size > 2 * LIBERASURECODE_CHKSUM_CHUNK_SIZE);
+    assert(encoded_fragment_len == sizeof(fragment_header_t) +
+           metadata.size + metadata.frag_backend_metadata_size);
+
+    /* A few bytes in the second chunk need just that chunk */
+    rc = liberasurecode_get_fragment_read_range(frag,
+            LIBERASURECODE_CHKSUM_CHUNK_SIZE + 100, 10,
+            &read_offset, &read_len, &table_offset, &table_len);
+    assert(0 == rc);
+    assert(LIBERASURECODE_CHKSUM_CHUNK_SIZE == read_offset);
+    assert(LIBERASURECODE_CHKSUM_CHUNK_SIZE == read_len);
+    assert(table_len == 4 * ((metadata.size +
+            LIBERASURECODE_CHKSUM_CHUNK_SIZE - 1) /
+            LIBERASURECODE_CHKSUM_CHUNK_SIZE));
+    assert(table_offset + table_len ==
+           metadata.size + metadata.frag_backend_metadata_size);
+    table = payload + table_offset;
+
+    rc = liberasurecode_verify_fragment_range(frag, table, read_offset,
+            payload + read_offset, read_len);
+    assert(0 == rc);
+
+    /* The tail of the payload ends in a partial chunk */
+    rc = liberasurecode_get_fragment_read_range(frag, metadata.size - 1, 1,
+            &read_offset, &read_len, &table_offset, &table_len);
+    assert(0 == rc);
+    assert(read_offset + read_len == metadata.size);
+    rc = liberasurecode_verify_fragment_range(frag, table, read_offset,
+            payload + read_offset, read_len);
+    assert(0 == rc);
+    rc = liberasurecode_verify_fragment_range(frag, table, 0,
+            payload, metadata.size);
+    assert(0 == rc);
+
+    /* Ranges must be made of whole chunks within the payload */
+    rc = liberasurecode_verify_fragment_range(frag, table, 100,
+            payload + 100, LIBERASURECODE_CHKSUM_CHUNK_SIZE);
+    assert(-EINVALIDPARAMS == rc);
+    rc = liberasurecode_verify_fragment_range(frag, table, 0,
+            payload, LIBERASURECODE_CHKSUM_CHUNK_SIZE - 1);
+    assert(-EINVALIDPARAMS == rc);
+    rc = liberasurecode_get_fragment_read_range(frag, metadata.size, 1,
+            &read_offset, &read_len, &table_offset, &table_len);
+    assert(-EINVALIDPARAMS == rc);
+
+    /* Damage in the second chunk only fails ranges that include it */
+    payload[LIBERASURECODE_CHKSUM_CHUNK_SIZE + 5] ^= 0x10;
+    rc = liberasurecode_verify_fragment_range(frag, table,
+            LIBERASURECODE_CHKSUM_CHUNK_SIZE,
+            payload + LIBERASURECODE_CHKSUM_CHUNK_SIZE,
+            LIBERASURECODE_CHKSUM_CHUNK_SIZE);
+    assert(-EBADCHKSUM == rc);
+    rc = liberasurecode_verify_fragment_range(frag, table, 0,
+            payload, LIBERASURECODE_CHKSUM_CHUNK_SIZE);
+    assert(0 == rc);
+    rc = liberasurecode_get_fragment_metadata(frag, &metadata);
+    assert(0 == rc);
+    assert(1 == metadata.chksum_mismatch);
+    payload[LIBERASURECODE_CHKSUM_CHUNK_SIZE + 5] ^= 0x10;
+
+    /* A damaged table fails everything */
+    table[1] ^= 0x01;
+    rc = liberasurecode_verify_fragment_range(frag, table, 0,
+            payload, LIBERASURECODE_CHKSUM_CHUNK_SIZE);
+    assert(-EBADCHKSUM == rc);
+    table[1] ^= 0x01;
+
+    /* Reconstruction rebuilds the table too */
+    for (i = 1; i < args->k + args->m; i++) {
+        avail_frags[i - 1] = i < args->k ? encoded_data[i] :
+                                           encoded_parity[i - args->k];
     }
+    out_fragment = malloc(encoded_fragment_len);
+    assert(out_fragment != NULL);
+    rc = liberasurecode_reconstruct_fragment(desc, avail_frags,
+            args->k + args->m - 1, encoded_fragment_len, 0, out_fragment);
+    assert(0 == rc);
+    assert(memcmp(out_fragment, frag, encoded_fragment_len) == 0);
+
+    rc = liberasurecode_decode(desc, avail_frags, args->k + args->m - 1,
+            encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+    assert(0 == rc);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    /* Fragments without a table are rejected */
+    set_checksum(CHKSUM_CRC32C, frag, metadata.size);
+    ((fragment_header_t *) frag)->metadata_chksum = liberasurecode_crc32(0,
+            &((fragment_header_t *) frag)->meta, sizeof(fragment_metadata_t));
+    assert(!is_invalid_fragment_header((fragment_header_t *) frag));
+    rc = liberasurecode_get_fragment_read_range(frag, 0, 1,
+            &read_offset, &read_len, &table_offset, &table_len);
+    assert(-EBADHEADER == rc);
+
+    free(out_fragment);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
 }
 
-static void test_fragments_needed(const ec_backend_id_t be_id,
-                                  struct ec_args *args)
+/*
+ * liberasurecode_encode_with_digest() gives the same fragments as a plain
+ * encode, plus the MD5 of the whole object
+ */
+static void test_encode_with_digest(const ec_backend_id_t be_id,
+                                    struct ec_args *args)
 {
-    test_fragments_needed_impl(be_id, args);
+    int sizes[] = { 0, 1, 4095, 64 * 1024 + 7, 1024 * 1024 + 13 };
+    int num_fragments = args->k + args->m;
+    unsigned char digest[LIBERASURECODE_DIGEST_LEN];
+    unsigned char expected[LIBERASURECODE_DIGEST_LEN];
+    int rc = 0;
+    int desc = -1;
+    int i, j;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char *orig_data = create_buffer(sizes[i] + 1, 'x');
+        char **encoded_data = NULL, **encoded_parity = NULL;
+        char **digest_data = NULL, **digest_parity = NULL;
+        uint64_t encoded_fragment_len = 0, digest_fragment_len = 0;
+        MD5_CTX ctx;
+
+        assert(orig_data != NULL);
+        for (j = 0; j < sizes[i]; j++) {
+            orig_data[j] = rand() & 0xff;
+        }
+
+        rc = liberasurecode_encode(desc, orig_data, sizes[i],
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(0 == rc);
+        rc = liberasurecode_encode_with_digest(desc, orig_data, sizes[i],
+                &digest_data, &digest_parity, &digest_fragment_len, digest);
+        assert(0 == rc);
+
+        MD5_Init(&ctx);
+        MD5_Update(&ctx, orig_data, sizes[i]);
+        MD5_Final(expected, &ctx);
+        assert(0 == memcmp(digest, expected, LIBERASURECODE_DIGEST_LEN));
+
+        assert(encoded_fragment_len == digest_fragment_len);
+        for (j = 0; j < num_fragments; j++) {
+            char *frag = (j < args->k) ? encoded_data[j] :
+                                         encoded_parity[j - args->k];
+            char *dfrag = (j < args->k) ? digest_data[j] :
+                                          digest_parity[j - args->k];
+            assert(0 == memcmp(frag, dfrag, encoded_fragment_len));
+        }
+
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+        liberasurecode_encode_cleanup(desc, digest_data, digest_parity);
+        free(orig_data);
+    }
+
+    rc = liberasurecode_encode_with_digest(desc, "x", 1, NULL, NULL, NULL,
+                                           NULL);
+    assert(-EINVALIDPARAMS == rc);
+
+    assert(0 == liberasurecode_instance_destroy(desc));
 }
 
 static void test_verify_stripe_metadata(const ec_backend_id_t be_id,
@@ -1783,6 +3541,175 @@ static void test_verify_stripe_metadata_frag_idx_invalid(
     verify_fragment_metadata_mismatch_impl(be_id, args, FRAGIDX_OUT_OF_RANGE);
 }
 
+/* Bit-at-a-time CRC-32C to check the optimized implementation against */
+static uint32_t crc32c_bitwise(uint32_t crc, const unsigned char *p, size_t len)
+{
+    int i;
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static void test_crc32c()
+{
+    /* lengths around the interleaved stream sizes */
+    size_t lens[] = { 0, 1, 7, 8, 9, 767, 768, 769, 1000, 24575, 24576,
+                      24577, 3 * 24576 + 3 * 256 + 13, 200000 };
+    size_t max_len = 200000;
+    unsigned char *buf = malloc(max_len + 8);
+    uint32_t crc;
+    int i, off;
+
+    assert(buf != NULL);
+    for (i = 0; i < max_len + 8; i++) {
+        buf[i] = rand() & 0xff;
+    }
+
+    assert(liberasurecode_crc32c(0, "123456789", 9) == 0xe3069283);
+
+    for (off = 0; off < 8; off++) {
+        for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+            assert(liberasurecode_crc32c(0, buf + off, lens[i]) ==
+                   crc32c_bitwise(0, buf + off, lens[i]));
+        }
+    }
+
+    /* a running CRC over several calls matches a single call */
+    crc = liberasurecode_crc32c(0, buf, 1000);
+    crc = liberasurecode_crc32c(crc, buf + 1000, 100000);
+    crc = liberasurecode_crc32c(crc, buf + 101000, max_len - 101000);
+    assert(crc == liberasurecode_crc32c(0, buf, max_len));
+
+    free(buf);
+}
+
+/* Byte-at-a-time version of the legacy crc32_alt, sign smear and all */
+static int crc32_alt_bytewise(int crc, const unsigned char *p, size_t len)
+{
+    uint32_t c = (uint32_t) crc ^ ~0U;
+    uint32_t t;
+    int i;
+
+    while (len--) {
+        t = (c ^ *p++) & 0xff;
+        for (i = 0; i < 8; i++) {
+            t = (t & 1) ? (t >> 1) ^ 0xedb88320 : t >> 1;
+        }
+        c = t ^ (c >> 8) ^ ((c & 0x80000000) ? 0xff000000 : 0);
+    }
+    return (int) (c ^ ~0U);
+}
+
+static void test_crc32()
+{
+    /* lengths around the 16-byte fold and 64-byte block sizes */
+    size_t lens[] = { 0, 1, 15, 16, 17, 63, 64, 65, 79, 80, 127, 128,
+                      129, 1000, 4096, 65536 + 7 };
+    size_t max_len = 65536 + 7;
+    unsigned char *buf = malloc(max_len + 16);
+    uint32_t seed;
+    int i, off;
+
+    assert(buf != NULL);
+    for (i = 0; i < max_len + 16; i++) {
+        buf[i] = rand() & 0xff;
+    }
+
+    for (off = 0; off < 16; off++) {
+        for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+            seed = (uint32_t) rand();
+            assert(liberasurecode_crc32(seed, buf + off, lens[i]) ==
+                   crc32(seed, buf + off, lens[i]));
+            assert(liberasurecode_crc32_alt(seed, buf + off, lens[i]) ==
+                   crc32_alt_bytewise(seed, buf + off, lens[i]));
+        }
+    }
+
+    free(buf);
+}
+
+static void test_md5_mb()
+{
+    /* lengths around the one- and two-block padding cases */
+    size_t lens[] = { 0, 1, 55, 56, 63, 64, 65, 119, 120, 1000, 65536 + 3 };
+    size_t max_len = 65536 + 3;
+    int num_bufs = 11;
+    unsigned char digests[11][MD5_DIGEST_LEN];
+    unsigned char expected[MD5_DIGEST_LEN];
+    const char *bufs[11];
+    const char *abc = "abc";
+    char *mem = malloc(num_bufs * (max_len + 1));
+    MD5_CTX ctx;
+    int i, j, n;
+
+    assert(mem != NULL);
+    for (i = 0; i < num_bufs * (max_len + 1); i++) {
+        mem[i] = rand() & 0xff;
+    }
+    for (i = 0; i < num_bufs; i++) {
+        /* deliberately misaligned */
+        bufs[i] = mem + i * (max_len + 1) + (i & 1);
+    }
+
+    liberasurecode_md5_mb(&abc, 1, 3, digests);
+    assert(memcmp(digests[0], "\x90\x01\x50\x98\x3c\xd2\x4f\xb0"
+                              "\xd6\x96\x3f\x7d\x28\xe1\x7f\x72",
+                  MD5_DIGEST_LEN) == 0);
+
+    for (n = 1; n <= num_bufs; n++) {
+        for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+            liberasurecode_md5_mb(bufs, n, lens[i], digests);
+            for (j = 0; j < n; j++) {
+                MD5_Init(&ctx);
+                MD5_Update(&ctx, (void *) bufs[j], lens[i]);
+                MD5_Final(expected, &ctx);
+                assert(memcmp(digests[j], expected, MD5_DIGEST_LEN) == 0);
+            }
+        }
+    }
+
+    free(mem);
+}
+
+static void test_xxh3()
+{
+    /* reference values from xxHash 0.8 XXH3_64bits() */
+    struct {
+        size_t len;
+        uint64_t hash;
+    } vectors[] = {
+        { 0,    0x2d06800538d394c2ULL },
+        { 3,    0x15f7093b173d005cULL },
+        { 9,    0xcbe393399f17ffbdULL },
+        { 17,   0x208bde5ee2bed407ULL },
+        { 129,  0xf8f76713f2bb60faULL },
+        { 241,  0x0b3b630948ce4a00ULL },
+        { 1024, 0x23bc880ebf0d29c6ULL },
+        { 4099, 0x8289fd6cadd0c49eULL },
+    };
+    unsigned char buf[4099 + 7];
+    int i, off;
+
+    assert(liberasurecode_xxh3_64("abc", 3) == 0x78af5f94892f3950ULL);
+
+    /* and the same at every alignment */
+    for (off = 0; off < 8; off++) {
+        for (i = 0; i < 4099; i++) {
+            buf[off + i] = (unsigned char) (i * 31 + 7);
+        }
+        for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+            assert(liberasurecode_xxh3_64(buf + off, vectors[i].len) ==
+                   vectors[i].hash);
+        }
+    }
+}
+
 static void test_metadata_crcs_le()
 {
     // We've observed headers like this in the wild, using our busted crc32
@@ -1869,6 +3796,8 @@ static void test_metadata_crcs_be()
 /* Block of common tests for the "real" backends */
 #define TEST_SUITE(backend) \
     TEST(test_create_and_destroy_backend,               backend, CHKSUM_NONE), \
+    TEST(test_many_instances,                           backend, CHKSUM_NONE), \
+    TEST(test_destroy_while_in_use,                     backend, CHKSUM_NONE), \
     TEST(test_simple_encode_decode,                     backend, CHKSUM_NONE), \
     TEST(test_decode_with_missing_data,                 backend, CHKSUM_NONE), \
     TEST(test_decode_with_missing_parity,               backend, CHKSUM_NONE), \
@@ -1879,13 +3808,47 @@ static void test_metadata_crcs_be()
     TEST(test_fragments_needed,                         backend, CHKSUM_NONE), \
     TEST(test_get_fragment_metadata,                    backend, CHKSUM_NONE), \
     TEST(test_get_fragment_metadata,                    backend, CHKSUM_CRC32), \
+    TEST(test_get_fragment_metadata,                    backend, CHKSUM_CRC32C), \
+    TEST(test_get_fragment_metadata,                    backend, CHKSUM_XXH3), \
+    TEST(test_get_fragment_metadata,                    backend, CHKSUM_MD5), \
+    TEST(test_get_fragment_metadata,                    backend, CHKSUM_ALG_SIG), \
+    TEST(test_get_fragment_metadata,                    backend, CHKSUM_CRC32C_CHUNKED), \
     TEST(test_write_legacy_fragment_metadata,           backend, CHKSUM_CRC32), \
+    TEST(test_read_legacy_md5_fragment,                 backend, CHKSUM_MD5), \
     TEST(test_verify_stripe_metadata,                   backend, CHKSUM_CRC32), \
+    TEST(test_verify_stripe_metadata,                   backend, CHKSUM_CRC32C), \
+    TEST(test_verify_stripe_metadata,                   backend, CHKSUM_XXH3), \
+    TEST(test_verify_stripe_metadata,                   backend, CHKSUM_MD5), \
+    TEST(test_verify_stripe_metadata,                   backend, CHKSUM_ALG_SIG), \
+    TEST(test_verify_stripe_metadata,                   backend, CHKSUM_CRC32C_CHUNKED), \
     TEST(test_verify_stripe_metadata_libec_mismatch,    backend, CHKSUM_CRC32), \
     TEST(test_verify_stripe_metadata_magic_mismatch,    backend, CHKSUM_CRC32), \
     TEST(test_verify_stripe_metadata_be_id_mismatch,    backend, CHKSUM_CRC32), \
     TEST(test_verify_stripe_metadata_be_ver_mismatch,   backend, CHKSUM_CRC32), \
-    TEST(test_verify_stripe_metadata_frag_idx_invalid,  backend, CHKSUM_CRC32)
+    TEST(test_verify_stripe_metadata_frag_idx_invalid,  backend, CHKSUM_CRC32), \
+    TEST(test_encode_checksums,                         backend, CHKSUM_CRC32), \
+    TEST(test_encode_checksums,                         backend, CHKSUM_CRC32C), \
+    TEST(test_encode_checksums,                         backend, CHKSUM_MD5), \
+    TEST(test_encode_checksums,                         backend, CHKSUM_ALG_SIG), \
+    TEST(test_encode_checksums,                         backend, CHKSUM_CRC32C_CHUNKED), \
+    TEST(test_verify_fragment_range,                    backend, CHKSUM_CRC32C_CHUNKED), \
+    TEST(test_verify_fragments,                         backend, CHKSUM_CRC32), \
+    TEST(test_verify_fragments,                         backend, CHKSUM_MD5), \
+    TEST(test_decode_lazy_checks,                       backend, CHKSUM_CRC32), \
+    TEST(test_decode_lazy_checks,                       backend, CHKSUM_CRC32C), \
+    TEST(test_encode_threads,                           backend, CHKSUM_NONE), \
+    TEST(test_encode_threads,                           backend, CHKSUM_CRC32), \
+    TEST(test_decode_threads,                           backend, CHKSUM_CRC32), \
+    TEST(test_set_threads_while_in_use,                 backend, CHKSUM_CRC32), \
+    TEST(test_async_reap,                               backend, CHKSUM_CRC32), \
+    TEST(test_async_callback,                           backend, CHKSUM_NONE), \
+    TEST(test_encode_with_digest,                       backend, CHKSUM_NONE), \
+    TEST(test_encode_with_digest,                       backend, CHKSUM_CRC32), \
+    TEST(test_encode_update,                            backend, CHKSUM_CRC32), \
+    TEST(test_scrub_stripe,                             backend, CHKSUM_NONE), \
+    TEST(test_scrub_stripe,                             backend, CHKSUM_CRC32), \
+    TEST(test_scrub_stripe,                             backend, CHKSUM_ALG_SIG), \
+    TEST(test_encode_accumulate,                        backend, CHKSUM_CRC32)
 
 struct testcase testcases[] = {
     TEST(test_backend_available_invalid_args, EC_BACKENDS_MAX, 0),
@@ -1902,6 +3865,10 @@ struct testcase testcases[] = {
     TEST(test_fragments_needed_invalid_args, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_get_fragment_partition, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST(test_liberasurecode_get_version, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST(test_crc32, EC_BACKENDS_MAX, 0),
+    TEST(test_crc32c, EC_BACKENDS_MAX, 0),
+    TEST(test_md5_mb, EC_BACKENDS_MAX, 0),
+    TEST(test_xxh3, EC_BACKENDS_MAX, 0),
     TEST(test_metadata_crcs_le, EC_BACKENDS_MAX, 0),
     TEST(test_metadata_crcs_be, EC_BACKENDS_MAX, 0),
     // NULL backend test
@@ -1913,21 +3880,29 @@ struct testcase testcases[] = {
     // Flat XOR backend tests
     TEST_SUITE(EC_BACKEND_FLAT_XOR_HD),
     TEST(test_flat_xor_hd3_init_failure, EC_BACKENDS_MAX, 0),
+    TEST(test_stale_desc_not_reused, EC_BACKENDS_MAX, 0),
+    TEST(test_destroy_waits_for_reference, EC_BACKENDS_MAX, 0),
     // Jerasure RS Vand backend tests
     TEST_SUITE(EC_BACKEND_JERASURE_RS_VAND),
     TEST(test_jerasure_rs_vand_simple_encode_decode_over32, EC_BACKENDS_MAX, 0),
+    TEST(test_jerasure_rs_vand_decode_cache, EC_BACKENDS_MAX, 0),
     // Jerasure RS Cauchy backend tests
     TEST_SUITE(EC_BACKEND_JERASURE_RS_CAUCHY),
     TEST(test_jerasure_rs_cauchy_init_failure, EC_BACKENDS_MAX, 0),
+    TEST(test_jerasure_rs_cauchy_decode_cache, EC_BACKENDS_MAX, 0),
+    TEST(test_jerasure_rs_cauchy_auto_packetsize, EC_BACKENDS_MAX, 0),
     // ISA-L rs_vand tests
     TEST_SUITE(EC_BACKEND_ISA_L_RS_VAND),
     TEST(test_isa_l_rs_vand_decode_reconstruct_specific_error_case, EC_BACKENDS_MAX, 0),
+    TEST(test_isa_l_rs_vand_decode_cache, EC_BACKENDS_MAX, 0),
     // ISA-L rs cauchy tests
     TEST_SUITE(EC_BACKEND_ISA_L_RS_CAUCHY),
+    TEST(test_isa_l_rs_cauchy_decode_cache, EC_BACKENDS_MAX, 0),
     // shss tests
     TEST_SUITE(EC_BACKEND_SHSS),
     // Internal RS Vand backend tests
     TEST_SUITE(EC_BACKEND_LIBERASURECODE_RS_VAND),
+    TEST(test_liberasurecode_rs_vand_encode_accumulate_over64, EC_BACKENDS_MAX, 0),
     // libphazr backend tests
     TEST_SUITE(EC_BACKEND_LIBPHAZR),
     { NULL, NULL, 0, 0, false },
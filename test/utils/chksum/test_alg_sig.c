@@ -23,6 +23,7 @@
  */
 
 #include "alg_sig.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -80,6 +81,146 @@ int check_parity_of_sigs(char **sigs, int num_data, int size)
   return ret;
 }
 
+static int gf_mult_ref(int x, int y, int w)
+{
+  int poly = (w == 8) ? 0x11d : 0x1100b;
+  int prod = 0;
+
+  while (y) {
+    if (y & 1) {
+      prod ^= x;
+    }
+    y >>= 1;
+    x <<= 1;
+    if (x & (1 << w)) {
+      x ^= poly;
+    }
+  }
+  return prod;
+}
+
+/* sig component c = sum(d_i * 2^(c * i)), by Horner's rule one symbol at a time */
+static void compute_sig_ref(int gf_w, int sig_len, unsigned char *buf, int len,
+                            unsigned char *sig)
+{
+  int num_syms = (gf_w == 8) ? len : (len + 1) / 2;
+  int c, i, d, s;
+
+  for (c = 0; c < sig_len / gf_w; c++) {
+    s = 0;
+    for (i = num_syms - 1; i >= 0; i--) {
+      if (gf_w == 8) {
+        d = buf[i];
+      } else {
+        d = buf[2 * i] | ((2 * i + 1 < len) ? buf[2 * i + 1] << 8 : 0);
+      }
+      s = d ^ gf_mult_ref(s, 1 << c, gf_w);
+    }
+    if (gf_w == 8) {
+      sig[c] = s;
+    } else {
+      sig[2 * c] = s & 0xff;
+      sig[2 * c + 1] = s >> 8;
+    }
+  }
+}
+
+static int reference_test(int sig_len, int gf_w)
+{
+  int max_len = 2100;
+  unsigned char *buf = (unsigned char*)malloc(max_len + 8);
+  unsigned char sig[MAX_SIG_LEN], ref[MAX_SIG_LEN];
+  int len, off;
+  int ret = 0;
+
+  alg_sig_t* sig_handle = init_alg_sig(sig_len, gf_w);
+  if (NULL == sig_handle) {
+    free(buf);
+    return 1;
+  }
+  fill_random_buffer((char *) buf, max_len + 8);
+
+  /* every length around the vector block sizes, at every alignment */
+  for (len = 0; len <= max_len && 0 == ret; len++) {
+    for (off = 0; off < 8; off++) {
+      bzero(sig, MAX_SIG_LEN);
+      bzero(ref, MAX_SIG_LEN);
+      compute_alg_sig(sig_handle, (char *) buf + off, len, (char *) sig);
+      compute_sig_ref(gf_w, sig_len, buf + off, len, ref);
+      if (memcmp(sig, ref, MAX_SIG_LEN) != 0) {
+        fprintf(stderr, "Signature mismatch: len %d, offset %d\n", len, off);
+        ret = 1;
+        break;
+      }
+    }
+  }
+
+  /* the fragment checksum is the GF(2^8) 32-bit signature */
+  if (0 == ret && gf_w == 8 && sig_len == 32) {
+    compute_alg_sig(sig_handle, (char *) buf, max_len, (char *) sig);
+    if (liberasurecode_alg_sig32(buf, max_len) !=
+        ((uint32_t) sig[0] | ((uint32_t) sig[1] << 8) |
+         ((uint32_t) sig[2] << 16) | ((uint32_t) sig[3] << 24))) {
+      fprintf(stderr, "liberasurecode_alg_sig32 mismatch\n");
+      ret = 1;
+    }
+  }
+
+  destroy_alg_sig(sig_handle);
+  free(buf);
+  return ret;
+}
+
+/*
+ * Parity p = sum(k_j * d_j) over GF(2^8), as an RS code computes it; the
+ * signatures must satisfy the same equation component by component.
+ */
+static int rs_parity_test_8_32()
+{
+  int blocksize = 4099;
+  int num_data = 10;
+  unsigned char *data[10];
+  unsigned char *parity;
+  unsigned char sigs[10][MAX_SIG_LEN], parity_sig[MAX_SIG_LEN];
+  int coeff[10];
+  int i, j, c, expected;
+  int ret = 0;
+
+  alg_sig_t* sig_handle = init_alg_sig(32, 8);
+  if (NULL == sig_handle) {
+    return 1;
+  }
+  parity = (unsigned char*)calloc(1, blocksize);
+  for (i = 0; i < num_data; i++) {
+    data[i] = (unsigned char*)malloc(blocksize);
+    fill_random_buffer((char *) data[i], blocksize);
+    coeff[i] = 1 + rand() % 255;
+    for (j = 0; j < blocksize; j++) {
+      parity[j] ^= gf_mult_ref(data[i][j], coeff[i], 8);
+    }
+    compute_alg_sig(sig_handle, (char *) data[i], blocksize, (char *) sigs[i]);
+  }
+  compute_alg_sig(sig_handle, (char *) parity, blocksize, (char *) parity_sig);
+
+  for (c = 0; c < 4; c++) {
+    expected = 0;
+    for (i = 0; i < num_data; i++) {
+      expected ^= gf_mult_ref(sigs[i][c], coeff[i], 8);
+    }
+    if (expected != parity_sig[c]) {
+      fprintf(stderr, "Parity signature mismatch in component %d\n", c);
+      ret = 1;
+    }
+  }
+
+  for (i = 0; i < num_data; i++) {
+    free(data[i]);
+  }
+  free(parity);
+  destroy_alg_sig(sig_handle);
+  return ret;
+}
+
 static int basic_xor_test_8_32()
 {
   int blocksize = 65536;
@@ -256,6 +397,27 @@ int main(int argc, char**argv)
     num_failed++;
   }
 
+  ret = reference_test(32, 8);
+  if (ret) {
+    fprintf(stderr, "reference_test(32, 8) has failed!\n");
+    num_failed++;
+  }
+  ret = reference_test(32, 16);
+  if (ret) {
+    fprintf(stderr, "reference_test(32, 16) has failed!\n");
+    num_failed++;
+  }
+  ret = reference_test(64, 16);
+  if (ret) {
+    fprintf(stderr, "reference_test(64, 16) has failed!\n");
+    num_failed++;
+  }
+  ret = rs_parity_test_8_32();
+  if (ret) {
+    fprintf(stderr, "rs_parity_test_8_32 has failed!\n");
+    num_failed++;
+  }
+
   if (num_failed == 0) {
     fprintf(stderr, "Tests pass!!!\n");
   }